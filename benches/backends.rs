@@ -0,0 +1,189 @@
+//! Criterion benchmarks comparing the three backends on representative
+//! workloads: recursion, string building, property access, and closure
+//! churn. Workloads are scaled-up versions of the programs in `fixtures/`
+//! and `examples/`; the harness mirrors `tests/cross_backend_tests.rs`.
+//!
+//! The `llvm-lli` benches run the compiled IR in a `lli` subprocess, so they
+//! include process and JIT startup; they are skipped when `lli` or the
+//! runtime object is unavailable. See `benches/README.md` for how to record
+//! and compare baselines.
+
+use std::path::PathBuf;
+use std::process::Command;
+
+use criterion::{Criterion, black_box, criterion_group, criterion_main};
+use vibe_lox::interpreter::Interpreter;
+use vibe_lox::interpreter::resolver::Resolver;
+use vibe_lox::parser::Parser;
+use vibe_lox::scanner;
+use vibe_lox::vm::chunk::Chunk;
+use vibe_lox::vm::compile_to_chunk;
+use vibe_lox::vm::vm::Vm;
+
+/// Recursion: fixtures/fib.lox, deepened so the call overhead dominates.
+const FIB: &str = r#"
+fun fib(n) {
+  if (n <= 1) return n;
+  return fib(n - 1) + fib(n - 2);
+}
+print fib(18);
+"#;
+
+/// String building: the concat patterns of fixtures/strings.lox in a loop.
+const STRING_BUILD: &str = r#"
+var s = "";
+for (var i = 0; i < 500; i = i + 1) {
+  s = s + "xy";
+}
+print s != "";
+"#;
+
+/// Property access: the class shapes of examples/classes.lox, hammered in
+/// a field read/write loop.
+const PROPERTY_LOOP: &str = r#"
+class Point {
+  init(x, y) {
+    this.x = x;
+    this.y = y;
+  }
+}
+var p = Point(0, 0);
+var total = 0;
+for (var i = 0; i < 2000; i = i + 1) {
+  p.x = p.x + 1;
+  total = total + p.x + p.y;
+}
+print total;
+"#;
+
+/// Closure churn: fixtures/counter.lox allocated and invoked repeatedly.
+const CLOSURE_CHURN: &str = r#"
+fun makeCounter() {
+  var i = 0;
+  fun count() {
+    i = i + 1;
+    return i;
+  }
+  return count;
+}
+var total = 0;
+for (var j = 0; j < 500; j = j + 1) {
+  var c = makeCounter();
+  total = total + c() + c() + c();
+}
+print total;
+"#;
+
+const WORKLOADS: &[(&str, &str)] = &[
+    ("fib", FIB),
+    ("string_build", STRING_BUILD),
+    ("property_loop", PROPERTY_LOOP),
+    ("closure_churn", CLOSURE_CHURN),
+];
+
+/// Run a Lox source through the tree-walk interpreter, returning output lines.
+fn run_interpreter(source: &str) -> Vec<String> {
+    let tokens = scanner::scan(source).expect("scan should succeed");
+    let program = Parser::new(tokens).parse().expect("parse should succeed");
+    let locals = Resolver::new()
+        .resolve(&program)
+        .expect("resolve should succeed");
+    let mut interp = Interpreter::new_capturing();
+    interp
+        .interpret(&program, locals)
+        .expect("interpret should succeed");
+    interp.output().to_vec()
+}
+
+/// Run a precompiled chunk through the bytecode VM, returning output lines.
+/// The chunk is compiled once per workload so this measures `Vm::run`, not
+/// the bytecode compiler.
+fn run_vm(chunk: &Chunk) -> Vec<String> {
+    let mut vm = Vm::new_capturing();
+    vm.interpret(chunk.clone())
+        .expect("interpret should succeed");
+    vm.output().to_vec()
+}
+
+/// A workload compiled to LLVM IR, ready to run via lli.
+struct LlvmWorkload {
+    ll_file: PathBuf,
+    runtime_obj: PathBuf,
+}
+
+/// Compile a workload to LLVM IR once, or `None` when lli or the runtime
+/// object isn't available (e.g. a machine without LLVM tooling).
+fn prepare_llvm(name: &str, source: &str) -> Option<LlvmWorkload> {
+    let runtime_obj = PathBuf::from(env!("CARGO_MANIFEST_DIR")).join("runtime/lox_runtime.o");
+    if !runtime_obj.exists() {
+        return None;
+    }
+    if Command::new("lli").arg("--version").output().is_err() {
+        return None;
+    }
+
+    let dir = std::env::temp_dir();
+    let lox_file = dir.join(format!("vibe_lox_bench_{name}.lox"));
+    let ll_file = dir.join(format!("vibe_lox_bench_{name}.ll"));
+    std::fs::write(&lox_file, source).expect("write bench source");
+
+    let status = Command::new(env!("CARGO_BIN_EXE_vibe-lox"))
+        .args(["--compile-llvm", "-o"])
+        .arg(&ll_file)
+        .arg(&lox_file)
+        .status()
+        .expect("run vibe-lox --compile-llvm");
+    if !status.success() {
+        return None;
+    }
+    Some(LlvmWorkload {
+        ll_file,
+        runtime_obj,
+    })
+}
+
+/// Run compiled IR via lli, returning output lines.
+fn run_lli(workload: &LlvmWorkload) -> Vec<String> {
+    let output = Command::new("lli")
+        .args([
+            "--extra-object",
+            workload
+                .runtime_obj
+                .to_str()
+                .expect("runtime path is UTF-8"),
+            workload.ll_file.to_str().expect("ll path is UTF-8"),
+        ])
+        .output()
+        .expect("run lli");
+    assert!(
+        output.status.success(),
+        "lli failed: {}",
+        String::from_utf8_lossy(&output.stderr)
+    );
+    let stdout = String::from_utf8(output.stdout).expect("lli output is valid UTF-8");
+    stdout.lines().map(String::from).collect()
+}
+
+fn bench_backends(c: &mut Criterion) {
+    for (name, source) in WORKLOADS {
+        let mut group = c.benchmark_group(*name);
+
+        group.bench_function("interpreter", |b| {
+            b.iter(|| black_box(run_interpreter(source)))
+        });
+
+        let chunk = compile_to_chunk(source).expect("compile to bytecode should succeed");
+        group.bench_function("vm", |b| b.iter(|| black_box(run_vm(&chunk))));
+
+        if let Some(workload) = prepare_llvm(name, source) {
+            // Each iteration spawns lli, so keep the sample count low.
+            group.sample_size(10);
+            group.bench_function("llvm-lli", |b| b.iter(|| black_box(run_lli(&workload))));
+        }
+
+        group.finish();
+    }
+}
+
+criterion_group!(benches, bench_backends);
+criterion_main!(benches);
@@ -25,4 +25,25 @@ fn main() {
     }
 
     println!("cargo:rustc-env=LOX_RUNTIME_OBJ={}", obj_output.display());
+
+    // Additionally compile the runtime to LLVM bitcode when clang is
+    // available, so `--compile` can link it into the module and inline its
+    // hot helpers across the C/Lox boundary. Best-effort: without clang the
+    // runtime is linked as a plain object file, as before.
+    let bc_output = runtime_dir.join("lox_runtime.bc");
+    let clang = env::var("CLANG").unwrap_or_else(|_| "clang".to_string());
+    let bc_built = Command::new(&clang)
+        .args(["-O2", "-fPIC", "-emit-llvm", "-c", "-o"])
+        .arg(&bc_output)
+        .arg(&source)
+        .status()
+        .map(|status| status.success())
+        .unwrap_or(false);
+
+    let bc_env = if bc_built {
+        bc_output.display().to_string()
+    } else {
+        String::new()
+    };
+    println!("cargo:rustc-env=LOX_RUNTIME_BC={bc_env}");
 }
@@ -3,35 +3,365 @@
 #include "lox_runtime.h"
 
 #include <math.h>
+#include <setjmp.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
-/* Simple global variable store using a linear search table.
- * Adequate for the small number of globals in typical Lox programs.
+/* Global variable store: an open-addressing hash table (FNV-1a, linear
+ * probing, power-of-two capacity) of pointers to heap-allocated entries.
+ * Entries are allocated once and never move, so the slot pointers handed
+ * out by lox_global_slot stay valid across table growth. Compiled code
+ * caches those pointers, paying for the name lookup once per name.
  */
 
-#define MAX_GLOBALS 256
-
 typedef struct {
-  char name[128];
+  char *name;
   int64_t name_len;
+  uint64_t hash;
   LoxValue value;
-  int occupied;
 } GlobalEntry;
 
-static GlobalEntry globals[MAX_GLOBALS];
-static int global_count = 0;
+static GlobalEntry **global_table = NULL;
+static size_t global_capacity = 0; /* always a power of two */
+static size_t global_count = 0;
+
+static uint64_t hash_name(const char *name, int64_t name_len) {
+  /* FNV-1a */
+  uint64_t hash = 14695981039346656037ULL;
+  for (int64_t i = 0; i < name_len; i++) {
+    hash ^= (uint8_t)name[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+/* Find the bucket holding `name`, or the empty bucket where it belongs. */
+static GlobalEntry **probe_global(GlobalEntry **table, size_t capacity,
+                                  uint64_t hash, const char *name,
+                                  int64_t name_len) {
+  size_t index = (size_t)hash & (capacity - 1);
+  for (;;) {
+    GlobalEntry *entry = table[index];
+    if (entry == NULL) {
+      return &table[index];
+    }
+    if (entry->hash == hash && entry->name_len == name_len &&
+        memcmp(entry->name, name, (size_t)name_len) == 0) {
+      return &table[index];
+    }
+    index = (index + 1) & (capacity - 1);
+  }
+}
+
+static void grow_global_table(void) {
+  size_t new_capacity = global_capacity == 0 ? 64 : global_capacity * 2;
+  GlobalEntry **new_table = calloc(new_capacity, sizeof(GlobalEntry *));
+  if (new_table == NULL) {
+    fprintf(stderr, "Error: out of memory growing global table\n");
+    exit(70);
+  }
+  for (size_t i = 0; i < global_capacity; i++) {
+    GlobalEntry *entry = global_table[i];
+    if (entry != NULL) {
+      *probe_global(new_table, new_capacity, entry->hash, entry->name,
+                    entry->name_len) = entry;
+    }
+  }
+  free(global_table);
+  global_table = new_table;
+  global_capacity = new_capacity;
+}
 
 static GlobalEntry *find_global(const char *name, int64_t name_len) {
-  for (int i = 0; i < global_count; i++) {
-    if (globals[i].occupied && globals[i].name_len == name_len &&
-        memcmp(globals[i].name, name, (size_t)name_len) == 0) {
-      return &globals[i];
+  if (global_count == 0) {
+    return NULL;
+  }
+  return *probe_global(global_table, global_capacity,
+                       hash_name(name, name_len), name, name_len);
+}
+
+struct LoxShape {
+  struct LoxShape *parent; /* NULL only for the root */
+  char *field_name;        /* field this shape added */
+  int64_t field_name_len;
+  int32_t field_count; /* total fields; this field's offset + 1 */
+  int32_t transition_capacity;
+  int32_t transition_count;
+  struct LoxShape **transitions; /* children, by added field name */
+};
+
+/* ---- Garbage collector ----
+ *
+ * Mark-sweep with a Boehm-style conservative root scan. Every Lox heap
+ * allocation (strings, closures, cells, classes, instances) carries a
+ * GcObject header and registers its payload address in a hash set. During
+ * collection the roots are the global table plus every pointer-sized word
+ * on the native stack (registers are spilled there via setjmp); a word
+ * counts as a root only if it exactly matches a registered payload
+ * address, so stale or interior values are ignored. Compiled code only
+ * has to call lox_gc_init once at the top of main to record the stack
+ * base — no per-frame shadow-stack bookkeeping.
+ */
+
+enum {
+  GC_STRING = 0,
+  GC_CLOSURE = 1,
+  GC_CELL = 2,
+  GC_CLASS = 3,
+  GC_INSTANCE = 4,
+  GC_BUFFER = 5,
+};
+
+typedef struct GcObject {
+  struct GcObject *next;
+  size_t size; /* payload size, excluding this header */
+  uint8_t kind;
+  uint8_t marked;
+} GcObject;
+
+#define GC_PAYLOAD(obj) ((void *)((char *)(obj) + sizeof(GcObject)))
+#define GC_HEADER(ptr) ((GcObject *)((char *)(ptr) - sizeof(GcObject)))
+
+#define GC_MIN_THRESHOLD (1024u * 1024u)
+
+static GcObject *gc_objects = NULL;
+static void *gc_stack_bottom = NULL;
+static size_t gc_bytes_live = 0;
+static size_t gc_next_collect = GC_MIN_THRESHOLD;
+
+/* Registered payload addresses, for the conservative scan's membership
+ * test. Open addressing; rebuilt from survivors after each sweep. */
+static void **gc_registry = NULL;
+static size_t gc_registry_capacity = 0; /* always a power of two */
+static size_t gc_registry_count = 0;
+
+static struct {
+  size_t allocations;
+  size_t bytes_allocated;
+  size_t collections;
+  size_t objects_freed;
+  size_t peak_bytes;
+} gc_stats;
+
+static uint64_t hash_pointer(const void *ptr) {
+  /* Multiplicative mix; heap addresses share low alignment bits. */
+  uint64_t h = (uint64_t)(uintptr_t)ptr;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  return h;
+}
+
+static void gc_registry_put(void **table, size_t capacity, void *ptr) {
+  size_t index = (size_t)hash_pointer(ptr) & (capacity - 1);
+  while (table[index] != NULL) {
+    index = (index + 1) & (capacity - 1);
+  }
+  table[index] = ptr;
+}
+
+static int gc_registry_contains(const void *ptr) {
+  if (gc_registry_count == 0) {
+    return 0;
+  }
+  size_t index = (size_t)hash_pointer(ptr) & (gc_registry_capacity - 1);
+  while (gc_registry[index] != NULL) {
+    if (gc_registry[index] == ptr) {
+      return 1;
     }
+    index = (index + 1) & (gc_registry_capacity - 1);
+  }
+  return 0;
+}
+
+static void gc_registry_grow(void) {
+  size_t new_capacity = gc_registry_capacity == 0 ? 256 : gc_registry_capacity * 2;
+  void **new_table = calloc(new_capacity, sizeof(void *));
+  if (new_table == NULL) {
+    fprintf(stderr, "Error: out of memory growing GC registry\n");
+    exit(70);
+  }
+  for (GcObject *obj = gc_objects; obj != NULL; obj = obj->next) {
+    gc_registry_put(new_table, new_capacity, GC_PAYLOAD(obj));
+  }
+  free(gc_registry);
+  gc_registry = new_table;
+  gc_registry_capacity = new_capacity;
+}
+
+static void gc_mark_value(LoxValue value);
+
+static void gc_mark_payload(void *payload) {
+  if (payload == NULL || !gc_registry_contains(payload)) {
+    return; /* static data, runtime-internal, or a false positive */
+  }
+  GcObject *obj = GC_HEADER(payload);
+  if (obj->marked) {
+    return;
+  }
+  obj->marked = 1;
+  switch (obj->kind) {
+  case GC_CLOSURE: {
+    LoxClosure *closure = payload;
+    for (int32_t i = 0; i < closure->env_count; i++) {
+      if (closure->env != NULL) {
+        gc_mark_payload(closure->env[i]); /* captured cell */
+      }
+    }
+    break;
+  }
+  case GC_CELL:
+    gc_mark_value(*(LoxValue *)payload);
+    break;
+  case GC_CLASS: {
+    LoxClassDesc *klass = payload;
+    gc_mark_payload(klass->superclass);
+    for (int32_t i = 0; i < klass->method_count; i++) {
+      gc_mark_payload(klass->methods[i].closure);
+    }
+    break;
+  }
+  case GC_INSTANCE: {
+    LoxInstance *inst = payload;
+    gc_mark_payload(inst->klass);
+    for (int32_t i = 0; i < inst->shape->field_count; i++) {
+      gc_mark_value(inst->values[i]);
+    }
+    break;
+  }
+  case GC_STRING:
+    gc_mark_payload(((LoxString *)payload)->buffer);
+    break;
+  default:
+    break; /* buffers have no children */
+  }
+}
+
+static void gc_mark_value(LoxValue value) {
+  switch (value.tag) {
+  case TAG_STRING:
+  case TAG_FUNCTION:
+  case TAG_CLASS:
+  case TAG_INSTANCE:
+    gc_mark_payload((void *)(intptr_t)value.payload);
+    break;
+  default:
+    break;
+  }
+}
+
+static void gc_scan_range(uintptr_t from, uintptr_t to) {
+  from &= ~(uintptr_t)(sizeof(void *) - 1);
+  for (uintptr_t addr = from; addr + sizeof(void *) <= to;
+       addr += sizeof(void *)) {
+    gc_mark_payload(*(void **)addr);
+  }
+}
+
+void lox_gc_collect(void) {
+  if (gc_stack_bottom == NULL) {
+    return; /* lox_gc_init hasn't run; nothing can be proven unreachable */
+  }
+  gc_stats.collections++;
+
+  /* Roots: defined globals ... */
+  for (size_t i = 0; i < global_capacity; i++) {
+    if (global_table[i] != NULL) {
+      gc_mark_value(global_table[i]->value);
+    }
+  }
+
+  /* ... plus the native stack, with registers spilled into it. */
+  jmp_buf registers;
+  setjmp(registers);
+  gc_scan_range((uintptr_t)&registers, (uintptr_t)gc_stack_bottom);
+
+  /* Sweep unmarked objects and rebuild the registry from survivors. */
+  memset(gc_registry, 0, gc_registry_capacity * sizeof(void *));
+  gc_registry_count = 0;
+  size_t live_bytes = 0;
+  GcObject **link = &gc_objects;
+  while (*link != NULL) {
+    GcObject *obj = *link;
+    if (obj->marked) {
+      obj->marked = 0;
+      live_bytes += obj->size;
+      gc_registry_put(gc_registry, gc_registry_capacity, GC_PAYLOAD(obj));
+      gc_registry_count++;
+      link = &obj->next;
+    } else {
+      *link = obj->next;
+      if (obj->kind == GC_CLOSURE) {
+        free(((LoxClosure *)GC_PAYLOAD(obj))->env);
+      } else if (obj->kind == GC_CLASS) {
+        free(((LoxClassDesc *)GC_PAYLOAD(obj))->methods);
+      } else if (obj->kind == GC_INSTANCE) {
+        free(((LoxInstance *)GC_PAYLOAD(obj))->values);
+      }
+      gc_stats.objects_freed++;
+      free(obj);
+    }
+  }
+  gc_bytes_live = live_bytes;
+  gc_next_collect =
+      live_bytes * 2 > GC_MIN_THRESHOLD ? live_bytes * 2 : GC_MIN_THRESHOLD;
+}
+
+/* Allocate a zeroed, collector-managed payload. Zeroing matters: a
+ * collection can run before the caller finishes initializing the object,
+ * and the tracer must not read garbage counts or pointers. */
+static void *gc_alloc(size_t size, uint8_t kind) {
+  if (gc_bytes_live + size > gc_next_collect) {
+    lox_gc_collect();
+  }
+  GcObject *obj = calloc(1, sizeof(GcObject) + size);
+  if (obj == NULL) {
+    lox_gc_collect();
+    obj = calloc(1, sizeof(GcObject) + size);
+    if (obj == NULL) {
+      fprintf(stderr, "Error: out of memory\n");
+      exit(70);
+    }
+  }
+  obj->size = size;
+  obj->kind = kind;
+  obj->next = gc_objects;
+  gc_objects = obj;
+
+  if (gc_registry_count + 1 > gc_registry_capacity - gc_registry_capacity / 4) {
+    gc_registry_grow();
+  }
+  gc_registry_put(gc_registry, gc_registry_capacity, GC_PAYLOAD(obj));
+  gc_registry_count++;
+
+  gc_bytes_live += size;
+  gc_stats.allocations++;
+  gc_stats.bytes_allocated += size;
+  if (gc_bytes_live > gc_stats.peak_bytes) {
+    gc_stats.peak_bytes = gc_bytes_live;
+  }
+  return GC_PAYLOAD(obj);
+}
+
+static void gc_print_stats(void) {
+  fprintf(stderr,
+          "gc: %zu allocations (%zu bytes total), %zu collections, "
+          "%zu objects freed, %zu bytes live at exit (peak %zu)\n",
+          gc_stats.allocations, gc_stats.bytes_allocated,
+          gc_stats.collections, gc_stats.objects_freed, gc_bytes_live,
+          gc_stats.peak_bytes);
+}
+
+void lox_gc_init(void *stack_anchor) {
+  /* The anchor is an alloca in main's frame. Scan a little past it so
+   * allocas the compiler placed above it in the same frame are covered;
+   * the extra words belong to libc's startup frames and are readable. */
+  gc_stack_bottom = (char *)stack_anchor + 1024;
+  if (getenv("LOX_GC_STATS") != NULL) {
+    atexit(gc_print_stats);
   }
-  return NULL;
 }
 
 static double payload_to_double(int64_t payload) {
@@ -59,8 +389,8 @@ void lox_print(LoxValue value) {
     break;
   }
   case TAG_STRING: {
-    const char *s = (const char *)(intptr_t)value.payload;
-    printf("%s\n", s);
+    const LoxString *s = (const LoxString *)(intptr_t)value.payload;
+    printf("%.*s\n", (int)s->len, s->data);
     break;
   }
   case TAG_FUNCTION: {
@@ -84,9 +414,37 @@ void lox_print(LoxValue value) {
   }
 }
 
+LoxValue *lox_global_slot(const char *name, int64_t name_len) {
+  /* Grow at 75% load, before probing, so insertion always finds a hole. */
+  if (global_count + 1 > global_capacity - global_capacity / 4) {
+    grow_global_table();
+  }
+  uint64_t hash = hash_name(name, name_len);
+  GlobalEntry **bucket =
+      probe_global(global_table, global_capacity, hash, name, name_len);
+  if (*bucket == NULL) {
+    GlobalEntry *entry = malloc(sizeof(GlobalEntry));
+    char *owned_name = malloc((size_t)name_len + 1);
+    if (entry == NULL || owned_name == NULL) {
+      fprintf(stderr, "Error: out of memory defining global\n");
+      exit(70);
+    }
+    memcpy(owned_name, name, (size_t)name_len);
+    owned_name[name_len] = '\0';
+    entry->name = owned_name;
+    entry->name_len = name_len;
+    entry->hash = hash;
+    entry->value.tag = TAG_UNDEFINED;
+    entry->value.payload = 0;
+    *bucket = entry;
+    global_count++;
+  }
+  return &(*bucket)->value;
+}
+
 LoxValue lox_global_get(const char *name, int64_t name_len) {
   GlobalEntry *entry = find_global(name, name_len);
-  if (entry) {
+  if (entry && entry->value.tag != TAG_UNDEFINED) {
     return entry->value;
   }
   fprintf(stderr, "Error: undefined variable '%.*s'\n", (int)name_len, name);
@@ -94,24 +452,7 @@ LoxValue lox_global_get(const char *name, int64_t name_len) {
 }
 
 void lox_global_set(const char *name, int64_t name_len, LoxValue value) {
-  GlobalEntry *entry = find_global(name, name_len);
-  if (entry) {
-    entry->value = value;
-    return;
-  }
-  if (global_count >= MAX_GLOBALS) {
-    fprintf(stderr, "Error: too many global variables\n");
-    exit(70);
-  }
-  GlobalEntry *new_entry = &globals[global_count++];
-  if (name_len >= (int64_t)sizeof(new_entry->name)) {
-    name_len = (int64_t)sizeof(new_entry->name) - 1;
-  }
-  memcpy(new_entry->name, name, (size_t)name_len);
-  new_entry->name[name_len] = '\0';
-  new_entry->name_len = name_len;
-  new_entry->value = value;
-  new_entry->occupied = 1;
+  *lox_global_slot(name, name_len) = value;
 }
 
 int8_t lox_value_truthy(LoxValue value) {
@@ -136,22 +477,23 @@ void lox_runtime_error(const char *message, int64_t message_len, int32_t line) {
 
 LoxClosure *lox_alloc_closure(void *fn_ptr, int32_t arity, const char *name,
                                LoxValue **env, int32_t env_count) {
-  LoxClosure *closure = malloc(sizeof(LoxClosure));
+  LoxClosure *closure = gc_alloc(sizeof(LoxClosure), GC_CLOSURE);
   closure->fn_ptr = fn_ptr;
   closure->arity = arity;
   closure->name = name;
-  closure->env_count = env_count;
   if (env_count > 0 && env != NULL) {
     closure->env = malloc(sizeof(LoxValue *) * (size_t)env_count);
     memcpy(closure->env, env, sizeof(LoxValue *) * (size_t)env_count);
   } else {
     closure->env = NULL;
   }
+  /* Published last: the tracer may see this closure mid-construction. */
+  closure->env_count = closure->env != NULL ? env_count : 0;
   return closure;
 }
 
 LoxCell *lox_alloc_cell(LoxValue initial) {
-  LoxCell *cell = malloc(sizeof(LoxCell));
+  LoxCell *cell = gc_alloc(sizeof(LoxCell), GC_CELL);
   *cell = initial;
   return cell;
 }
@@ -160,29 +502,144 @@ LoxValue lox_cell_get(LoxCell *cell) { return *cell; }
 
 void lox_cell_set(LoxCell *cell, LoxValue value) { *cell = value; }
 
+/* Allocate a string of `len` bytes backed by a fresh buffer of at least
+ * `capacity` bytes. The caller fills the bytes and the buffer's fill. */
+static LoxString *string_with_buffer(int64_t len, int64_t capacity) {
+  if (capacity < 32) {
+    capacity = 32;
+  }
+  LoxStringBuffer *buf =
+      gc_alloc(sizeof(LoxStringBuffer) + (size_t)capacity, GC_BUFFER);
+  buf->capacity = capacity;
+  LoxString *str = gc_alloc(sizeof(LoxString), GC_STRING);
+  str->len = len;
+  str->buffer = buf;
+  str->data = buf->bytes;
+  return str;
+}
+
 LoxValue lox_string_concat(LoxValue a, LoxValue b) {
-  const char *sa = (const char *)(intptr_t)a.payload;
-  const char *sb = (const char *)(intptr_t)b.payload;
-  size_t la = strlen(sa);
-  size_t lb = strlen(sb);
-  char *result = malloc(la + lb + 1);
-  memcpy(result, sa, la);
-  memcpy(result + la, sb, lb + 1);
+  const LoxString *sa = (const LoxString *)(intptr_t)a.payload;
+  const LoxString *sb = (const LoxString *)(intptr_t)b.payload;
+  int64_t total = sa->len + sb->len;
   LoxValue v;
   v.tag = TAG_STRING;
+
+  LoxStringBuffer *buf = sa->buffer;
+  if (buf != NULL && sa->data + sa->len == buf->bytes + buf->fill &&
+      buf->fill + sb->len <= buf->capacity) {
+    /* Fast path: the left operand is the newest string in its buffer, so
+     * only the right operand's bytes need copying. The result is a new
+     * header over the extended region; sa itself keeps its shorter len. */
+    memcpy(buf->bytes + buf->fill, sb->data, (size_t)sb->len);
+    buf->fill += sb->len;
+    LoxString *result = gc_alloc(sizeof(LoxString), GC_STRING);
+    result->len = total;
+    result->buffer = buf;
+    result->data = sa->data;
+    v.payload = (int64_t)(intptr_t)result;
+    return v;
+  }
+
+  /* Slow path: fresh buffer with headroom for further appends. */
+  LoxString *result = string_with_buffer(total, total * 2);
+  memcpy(result->buffer->bytes, sa->data, (size_t)sa->len);
+  memcpy(result->buffer->bytes + sa->len, sb->data, (size_t)sb->len);
+  result->buffer->fill = total;
   v.payload = (int64_t)(intptr_t)result;
   return v;
 }
 
 int8_t lox_string_equal(LoxValue a, LoxValue b) {
-  const char *sa = (const char *)(intptr_t)a.payload;
-  const char *sb = (const char *)(intptr_t)b.payload;
-  return strcmp(sa, sb) == 0 ? 1 : 0;
+  const LoxString *sa = (const LoxString *)(intptr_t)a.payload;
+  const LoxString *sb = (const LoxString *)(intptr_t)b.payload;
+  if (sa->len != sb->len) {
+    return 0;
+  }
+  return memcmp(sa->data, sb->data, (size_t)sa->len) == 0 ? 1 : 0;
+}
+
+/* ---- Shapes (hidden classes) ----
+ *
+ * A shape records one field name added on top of a parent shape, so a
+ * shape is the path of field additions an instance has gone through.
+ * Instances built the same way share a shape, each field name has a fixed
+ * offset (parent chain depth), and per-site caches in compiled code turn
+ * property access into a shape compare plus an indexed load. Shapes are
+ * immortal: there are only as many as there are distinct field-addition
+ * paths in the program.
+ */
+
+static LoxShape shape_root; /* zero: no parent, no fields */
+
+/* Find or create the child of `shape` that adds `name`. */
+static LoxShape *shape_transition(LoxShape *shape, const char *name,
+                                  int64_t name_len) {
+  for (int32_t i = 0; i < shape->transition_count; i++) {
+    LoxShape *child = shape->transitions[i];
+    if (child->field_name_len == name_len &&
+        memcmp(child->field_name, name, (size_t)name_len) == 0) {
+      return child;
+    }
+  }
+  LoxShape *child = calloc(1, sizeof(LoxShape));
+  char *owned_name = malloc((size_t)name_len + 1);
+  if (child == NULL || owned_name == NULL) {
+    fprintf(stderr, "Error: out of memory creating shape\n");
+    exit(70);
+  }
+  memcpy(owned_name, name, (size_t)name_len);
+  owned_name[name_len] = '\0';
+  child->parent = shape;
+  child->field_name = owned_name;
+  child->field_name_len = name_len;
+  child->field_count = shape->field_count + 1;
+  if (shape->transition_count == shape->transition_capacity) {
+    int32_t new_capacity =
+        shape->transition_capacity == 0 ? 4 : shape->transition_capacity * 2;
+    shape->transitions = realloc(
+        shape->transitions, sizeof(LoxShape *) * (size_t)new_capacity);
+    if (shape->transitions == NULL) {
+      fprintf(stderr, "Error: out of memory growing shape transitions\n");
+      exit(70);
+    }
+    shape->transition_capacity = new_capacity;
+  }
+  shape->transitions[shape->transition_count++] = child;
+  return child;
+}
+
+/* Offset of `name` under `shape`, or -1 if the shape has no such field. */
+static int32_t shape_field_offset(const LoxShape *shape, const char *name,
+                                  int64_t name_len) {
+  for (const LoxShape *s = shape; s->parent != NULL; s = s->parent) {
+    if (s->field_name_len == name_len &&
+        memcmp(s->field_name, name, (size_t)name_len) == 0) {
+      return s->field_count - 1;
+    }
+  }
+  return -1;
+}
+
+static void instance_ensure_capacity(LoxInstance *inst, int32_t needed) {
+  if (needed <= inst->capacity) {
+    return;
+  }
+  int32_t new_capacity = inst->capacity == 0 ? 4 : inst->capacity * 2;
+  if (new_capacity < needed) {
+    new_capacity = needed;
+  }
+  inst->values = realloc(inst->values, sizeof(LoxValue) * (size_t)new_capacity);
+  if (inst->values == NULL) {
+    fprintf(stderr, "Error: out of memory growing instance fields\n");
+    exit(70);
+  }
+  inst->capacity = new_capacity;
 }
 
 LoxClassDesc *lox_alloc_class(const char *name, LoxClassDesc *superclass,
                                int32_t method_count) {
-  LoxClassDesc *klass = malloc(sizeof(LoxClassDesc));
+  LoxClassDesc *klass = gc_alloc(sizeof(LoxClassDesc), GC_CLASS);
   klass->name = name;
   klass->superclass = superclass;
   klass->method_count = 0;
@@ -193,14 +650,15 @@ LoxClassDesc *lox_alloc_class(const char *name, LoxClassDesc *superclass,
 void lox_class_add_method(LoxClassDesc *klass, const char *name,
                            LoxClosure *closure) {
   klass->methods[klass->method_count].name = name;
+  klass->methods[klass->method_count].name_len = (int64_t)strlen(name);
   klass->methods[klass->method_count].closure = closure;
   klass->method_count++;
 }
 
 LoxValue lox_alloc_instance(LoxClassDesc *klass) {
-  LoxInstance *inst = malloc(sizeof(LoxInstance));
+  LoxInstance *inst = gc_alloc(sizeof(LoxInstance), GC_INSTANCE);
   inst->klass = klass;
-  inst->field_count = 0;
+  inst->shape = &shape_root;
   LoxValue v;
   v.tag = TAG_INSTANCE;
   v.payload = (int64_t)(intptr_t)inst;
@@ -212,9 +670,11 @@ static LoxInstance *extract_instance(LoxValue value) {
 }
 
 LoxClosure *lox_class_find_method(LoxClassDesc *klass, const char *name) {
+  int64_t name_len = (int64_t)strlen(name);
   for (LoxClassDesc *k = klass; k != NULL; k = k->superclass) {
     for (int i = 0; i < k->method_count; i++) {
-      if (strcmp(k->methods[i].name, name) == 0) {
+      if (k->methods[i].name_len == name_len &&
+          memcmp(k->methods[i].name, name, (size_t)name_len) == 0) {
         return k->methods[i].closure;
       }
     }
@@ -225,16 +685,18 @@ LoxClosure *lox_class_find_method(LoxClassDesc *klass, const char *name) {
 LoxValue lox_bind_method(LoxValue instance, LoxClosure *method) {
   /* Create a new closure with env[0] = cell containing the instance. */
   int new_env_count = method->env_count;
-  LoxClosure *bound = malloc(sizeof(LoxClosure));
+  LoxClosure *bound = gc_alloc(sizeof(LoxClosure), GC_CLOSURE);
   bound->fn_ptr = method->fn_ptr;
   bound->arity = method->arity;
   bound->name = method->name;
-  bound->env_count = new_env_count;
-  bound->env = malloc(sizeof(LoxValue *) * (size_t)new_env_count);
+  bound->env = calloc((size_t)new_env_count, sizeof(LoxValue *));
   if (method->env != NULL) {
     memcpy(bound->env, method->env, sizeof(LoxValue *) * (size_t)new_env_count);
   }
-  /* Replace env[0] with a new cell holding the instance. */
+  bound->env_count = new_env_count;
+  /* Replace env[0] with a new cell holding the instance. The allocation
+   * can collect, so `bound` must already be traceable — it is, via the
+   * caller's stack. */
   bound->env[0] = lox_alloc_cell(instance);
   LoxValue v;
   v.tag = TAG_FUNCTION;
@@ -242,18 +704,23 @@ LoxValue lox_bind_method(LoxValue instance, LoxClosure *method) {
   return v;
 }
 
-LoxValue lox_instance_get_property(LoxValue instance, const char *name,
-                                    int64_t name_len) {
+LoxValue lox_instance_get_property_cached(LoxValue instance, const char *name,
+                                           int64_t name_len,
+                                           LoxPropertyCache *cache) {
   LoxInstance *inst = extract_instance(instance);
-  /* Check fields first. */
-  for (int i = 0; i < inst->field_count; i++) {
-    if ((int64_t)strlen(inst->fields[i].name) == name_len &&
-        memcmp(inst->fields[i].name, name, (size_t)name_len) == 0) {
-      return inst->fields[i].value;
-    }
+  if (cache->shape == inst->shape && cache->shape != NULL &&
+      cache->transition == NULL) {
+    return inst->values[cache->offset];
+  }
+  int32_t offset = shape_field_offset(inst->shape, name, name_len);
+  if (offset >= 0) {
+    cache->shape = inst->shape;
+    cache->transition = NULL;
+    cache->offset = offset;
+    return inst->values[offset];
   }
-  /* Then check methods (with bind). */
-  /* We need a null-terminated copy for lox_class_find_method. */
+  /* Not a field: look up a method (needs a null-terminated copy). Bound
+   * methods are instance-specific, so they are never cached. */
   char name_buf[128];
   if (name_len >= (int64_t)sizeof(name_buf)) name_len = (int64_t)sizeof(name_buf) - 1;
   memcpy(name_buf, name, (size_t)name_len);
@@ -266,29 +733,50 @@ LoxValue lox_instance_get_property(LoxValue instance, const char *name,
   exit(70);
 }
 
-void lox_instance_set_field(LoxValue instance, const char *name,
-                             int64_t name_len, LoxValue value) {
+void lox_instance_set_field_cached(LoxValue instance, const char *name,
+                                    int64_t name_len, LoxValue value,
+                                    LoxPropertyCache *cache) {
   LoxInstance *inst = extract_instance(instance);
-  /* Update existing field if present. */
-  for (int i = 0; i < inst->field_count; i++) {
-    if ((int64_t)strlen(inst->fields[i].name) == name_len &&
-        memcmp(inst->fields[i].name, name, (size_t)name_len) == 0) {
-      inst->fields[i].value = value;
+  if (cache->shape == inst->shape && cache->shape != NULL) {
+    if (cache->transition == NULL) {
+      inst->values[cache->offset] = value;
       return;
     }
+    /* Cached transition: same starting shape, adding the same field. */
+    instance_ensure_capacity(inst, cache->transition->field_count);
+    inst->values[cache->offset] = value;
+    inst->shape = cache->transition;
+    return;
   }
-  /* Add new field. */
-  if (inst->field_count >= MAX_FIELDS) {
-    fprintf(stderr, "Error: too many fields on instance\n");
-    exit(70);
-  }
-  if (name_len >= (int64_t)sizeof(inst->fields[0].name)) {
-    name_len = (int64_t)sizeof(inst->fields[0].name) - 1;
+  int32_t offset = shape_field_offset(inst->shape, name, name_len);
+  if (offset >= 0) {
+    cache->shape = inst->shape;
+    cache->transition = NULL;
+    cache->offset = offset;
+    inst->values[offset] = value;
+    return;
   }
-  memcpy(inst->fields[inst->field_count].name, name, (size_t)name_len);
-  inst->fields[inst->field_count].name[name_len] = '\0';
-  inst->fields[inst->field_count].value = value;
-  inst->field_count++;
+  /* New field: move the instance to the transitioned shape. */
+  LoxShape *next = shape_transition(inst->shape, name, name_len);
+  instance_ensure_capacity(inst, next->field_count);
+  cache->shape = inst->shape;
+  cache->transition = next;
+  cache->offset = next->field_count - 1;
+  inst->values[next->field_count - 1] = value;
+  inst->shape = next;
+}
+
+/* Uncached compatibility wrappers: a throwaway cache always misses. */
+LoxValue lox_instance_get_property(LoxValue instance, const char *name,
+                                    int64_t name_len) {
+  LoxPropertyCache cache = {0};
+  return lox_instance_get_property_cached(instance, name, name_len, &cache);
+}
+
+void lox_instance_set_field(LoxValue instance, const char *name,
+                             int64_t name_len, LoxValue value) {
+  LoxPropertyCache cache = {0};
+  lox_instance_set_field_cached(instance, name, name_len, value, &cache);
 }
 
 LoxValue lox_clock(void) {
@@ -314,9 +802,14 @@ LoxValue lox_read_line(void) {
   while (nread > 0 && (buf[nread - 1] == '\n' || buf[nread - 1] == '\r')) {
     buf[--nread] = '\0';
   }
+  /* Copy into a collector-managed string; getline's buffer is plain malloc. */
+  LoxString *managed = string_with_buffer(nread, nread);
+  memcpy(managed->buffer->bytes, buf, (size_t)nread);
+  managed->buffer->fill = nread;
+  free(buf);
   LoxValue v;
   v.tag = TAG_STRING;
-  v.payload = (int64_t)(intptr_t)buf;
+  v.payload = (int64_t)(intptr_t)managed;
   return v;
 }
 
@@ -347,7 +840,13 @@ LoxValue lox_to_number(LoxValue value) {
   LoxValue nil_val = {TAG_NIL, 0};
   if (value.tag == TAG_NUMBER) return value;
   if (value.tag != TAG_STRING) return nil_val;
-  const char *s = (const char *)(intptr_t)value.payload;
+  const LoxString *str = (const LoxString *)(intptr_t)value.payload;
+  /* Bounded copy for a null-terminated parse; anything longer than the
+   * buffer can't be a plain DIGIT+ ("." DIGIT+)? literal worth accepting. */
+  char s[64];
+  if (str->len >= (int64_t)sizeof(s)) return nil_val;
+  memcpy(s, str->data, (size_t)str->len);
+  s[str->len] = '\0';
   double result;
   if (!parse_lox_number_str(s, &result)) return nil_val;
   LoxValue v;
@@ -10,7 +10,7 @@
  *   0 = nil
  *   1 = bool   (payload: 0 or 1)
  *   2 = number (payload: f64 bitcast to i64)
- *   3 = string (payload: pointer to null-terminated C string, cast to i64)
+ *   3 = string (payload: pointer to a LoxString header, cast to i64)
  *   4 = function/closure (payload: pointer to LoxClosure, cast to i64)
  *   5 = class (payload: pointer to LoxClassDesc, cast to i64)
  *   6 = instance (payload: pointer to LoxInstance, cast to i64)
@@ -27,6 +27,9 @@ typedef struct {
 #define TAG_FUNCTION 4
 #define TAG_CLASS    5
 #define TAG_INSTANCE 6
+/* Internal sentinel for a reserved-but-unassigned global slot. Never
+ * observable as a Lox value; reads of an undefined slot are an error. */
+#define TAG_UNDEFINED 7
 
 /* Heap-allocated closure: function pointer + captured environment. */
 typedef struct {
@@ -41,12 +44,43 @@ typedef struct {
  * so mutations are shared between the closure and the enclosing scope. */
 typedef LoxValue LoxCell;
 
+/* Growable backing store for strings built at runtime. Concatenation
+ * appends into it when the left operand is the newest string there, so a
+ * left-fold concat loop copies each byte once instead of re-copying the
+ * accumulated prefix per step. */
+typedef struct {
+    int64_t fill;     /* bytes used */
+    int64_t capacity; /* bytes available */
+    char bytes[];
+} LoxStringBuffer;
+
+/* Runtime string: an immutable (len, bytes) slice. `buffer` is the backing
+ * store for runtime-built strings, or NULL for compiler-emitted constants
+ * whose bytes live in the binary's read-only data. Appending never changes
+ * an existing LoxString — only the buffer's fill — so aliases of the left
+ * operand keep their original contents. */
+typedef struct {
+    int64_t len;
+    LoxStringBuffer *buffer; /* NULL for static strings */
+    const char *data;
+} LoxString;
+
 void lox_print(LoxValue value);
 LoxValue lox_global_get(const char *name, int64_t name_len);
 void lox_global_set(const char *name, int64_t name_len, LoxValue value);
+/* Returns a stable pointer to the named global's value slot, creating the
+ * entry (as TAG_UNDEFINED) if needed. Compiled code caches this pointer so
+ * the hash lookup happens once per name. */
+LoxValue *lox_global_slot(const char *name, int64_t name_len);
 int8_t lox_value_truthy(LoxValue value);
 void lox_runtime_error(const char *message, int64_t message_len, int32_t line);
 
+/* Garbage collector. Compiled main calls lox_gc_init once at startup with
+ * a stack anchor; collections are triggered by allocation thereafter. Set
+ * LOX_GC_STATS=1 to print heap statistics at exit. */
+void lox_gc_init(void *stack_anchor);
+void lox_gc_collect(void);
+
 /* Closure/cell allocation */
 LoxClosure *lox_alloc_closure(void *fn_ptr, int32_t arity, const char *name,
                                LoxValue **env, int32_t env_count);
@@ -61,6 +95,7 @@ int8_t lox_string_equal(LoxValue a, LoxValue b);
 /* Class/instance types and operations */
 typedef struct {
     const char *name;
+    int64_t name_len; /* precomputed so lookups compare lengths first */
     LoxClosure *closure;
 } LoxMethodEntry;
 
@@ -71,13 +106,29 @@ typedef struct LoxClassDesc {
     LoxMethodEntry *methods;
 } LoxClassDesc;
 
-#define MAX_FIELDS 256
+/* Hidden class describing an instance's field layout. Instances that had
+ * the same fields added in the same order share a shape, and each field
+ * has a fixed offset into the instance's values array. Opaque here; the
+ * layout lives in lox_runtime.c. */
+typedef struct LoxShape LoxShape;
+
 typedef struct {
     LoxClassDesc *klass;
-    int32_t field_count;
-    struct { char name[128]; LoxValue value; } fields[MAX_FIELDS];
+    LoxShape *shape;
+    int32_t capacity; /* slots allocated in values */
+    LoxValue *values; /* field storage, indexed by shape offset */
 } LoxInstance;
 
+/* Per-access-site inline cache, allocated as zeroed module data by the
+ * compiler. While an instance's shape matches `shape`, a get is a load
+ * from values[offset]; for a set that adds a field, `transition` is the
+ * shape the instance moves to. */
+typedef struct {
+    LoxShape *shape;
+    LoxShape *transition;
+    int32_t offset;
+} LoxPropertyCache;
+
 LoxClassDesc *lox_alloc_class(const char *name, LoxClassDesc *superclass,
                                int32_t method_count);
 void lox_class_add_method(LoxClassDesc *klass, const char *name,
@@ -87,6 +138,12 @@ LoxValue lox_instance_get_property(LoxValue instance, const char *name,
                                     int64_t name_len);
 void lox_instance_set_field(LoxValue instance, const char *name,
                              int64_t name_len, LoxValue value);
+LoxValue lox_instance_get_property_cached(LoxValue instance, const char *name,
+                                           int64_t name_len,
+                                           LoxPropertyCache *cache);
+void lox_instance_set_field_cached(LoxValue instance, const char *name,
+                                    int64_t name_len, LoxValue value,
+                                    LoxPropertyCache *cache);
 LoxClosure *lox_class_find_method(LoxClassDesc *klass, const char *name);
 LoxValue lox_bind_method(LoxValue instance, LoxClosure *method);
 
@@ -4,14 +4,53 @@ use serde::Serialize;
 
 use crate::scanner::token::Span;
 
-/// A unique identifier for each expression node, used by the resolver
-/// to store variable resolution depths.
+/// A unique identifier for each expression node: its index in the
+/// program's [`ExprArena`]. Also used by the resolver to key variable
+/// resolution results.
 pub type ExprId = usize;
 
-/// Top-level program: a list of declarations.
+/// Arena holding every expression node of a program in one contiguous
+/// `Vec`, addressed by [`ExprId`]. Child links in the AST are plain ids
+/// into this arena rather than boxed pointers, so parsing does a handful
+/// of large allocations instead of one per node, and tree walks touch
+/// memory sequentially instead of pointer-chasing.
+#[derive(Debug, Clone, Default, Serialize)]
+pub struct ExprArena {
+    nodes: Vec<Expr>,
+}
+
+impl ExprArena {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Allocate a node. The closure receives the id the node will get so
+    /// nodes can store their own id (the resolver keys on it).
+    pub fn alloc(&mut self, make: impl FnOnce(ExprId) -> Expr) -> ExprId {
+        let id = self.nodes.len();
+        self.nodes.push(make(id));
+        id
+    }
+
+    pub fn get(&self, id: ExprId) -> &Expr {
+        &self.nodes[id]
+    }
+
+    pub fn len(&self) -> usize {
+        self.nodes.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.nodes.is_empty()
+    }
+}
+
+/// Top-level program: a list of declarations plus the expression arena
+/// their statements reference.
 #[derive(Debug, Clone, Serialize)]
 pub struct Program {
     pub declarations: Vec<Decl>,
+    pub exprs: ExprArena,
 }
 
 #[derive(Debug, Clone)]
@@ -62,7 +101,7 @@ pub struct FunDecl {
 #[derive(Debug, Clone, Serialize)]
 pub struct VarDecl {
     pub name: String,
-    pub initializer: Option<Expr>,
+    pub initializer: Option<ExprId>,
     pub span: Span,
 }
 
@@ -87,19 +126,19 @@ pub enum Stmt {
 
 #[derive(Debug, Clone, Serialize)]
 pub struct ExprStmt {
-    pub expression: Expr,
+    pub expression: ExprId,
     pub span: Span,
 }
 
 #[derive(Debug, Clone, Serialize)]
 pub struct PrintStmt {
-    pub expression: Expr,
+    pub expression: ExprId,
     pub span: Span,
 }
 
 #[derive(Debug, Clone, Serialize)]
 pub struct ReturnStmt {
-    pub value: Option<Expr>,
+    pub value: Option<ExprId>,
     pub span: Span,
 }
 
@@ -111,7 +150,7 @@ pub struct BlockStmt {
 
 #[derive(Debug, Clone, Serialize)]
 pub struct IfStmt {
-    pub condition: Expr,
+    pub condition: ExprId,
     pub then_branch: Box<Stmt>,
     pub else_branch: Option<Box<Stmt>>,
     pub span: Span,
@@ -119,7 +158,7 @@ pub struct IfStmt {
 
 #[derive(Debug, Clone, Serialize)]
 pub struct WhileStmt {
-    pub condition: Expr,
+    pub condition: ExprId,
     pub body: Box<Stmt>,
     pub span: Span,
 }
@@ -180,9 +219,9 @@ impl Expr {
 #[derive(Debug, Clone, Serialize)]
 pub struct BinaryExpr {
     pub id: ExprId,
-    pub left: Box<Expr>,
+    pub left: ExprId,
     pub operator: BinaryOp,
-    pub right: Box<Expr>,
+    pub right: ExprId,
     pub span: Span,
 }
 
@@ -214,7 +253,7 @@ pub enum BinaryOp {
 pub struct UnaryExpr {
     pub id: ExprId,
     pub operator: UnaryOp,
-    pub operand: Box<Expr>,
+    pub operand: ExprId,
     pub span: Span,
 }
 
@@ -244,7 +283,7 @@ pub enum LiteralValue {
 #[derive(Debug, Clone, Serialize)]
 pub struct GroupingExpr {
     pub id: ExprId,
-    pub expression: Box<Expr>,
+    pub expression: ExprId,
     pub span: Span,
 }
 
@@ -259,7 +298,7 @@ pub struct VariableExpr {
 pub struct AssignExpr {
     pub id: ExprId,
     pub name: String,
-    pub value: Box<Expr>,
+    pub value: ExprId,
     pub span: Span,
 }
 
@@ -273,24 +312,24 @@ pub enum LogicalOp {
 #[derive(Debug, Clone, Serialize)]
 pub struct LogicalExpr {
     pub id: ExprId,
-    pub left: Box<Expr>,
+    pub left: ExprId,
     pub operator: LogicalOp,
-    pub right: Box<Expr>,
+    pub right: ExprId,
     pub span: Span,
 }
 
 #[derive(Debug, Clone, Serialize)]
 pub struct CallExpr {
     pub id: ExprId,
-    pub callee: Box<Expr>,
-    pub arguments: Vec<Expr>,
+    pub callee: ExprId,
+    pub arguments: Vec<ExprId>,
     pub span: Span,
 }
 
 #[derive(Debug, Clone, Serialize)]
 pub struct GetExpr {
     pub id: ExprId,
-    pub object: Box<Expr>,
+    pub object: ExprId,
     pub name: String,
     pub span: Span,
 }
@@ -298,9 +337,9 @@ pub struct GetExpr {
 #[derive(Debug, Clone, Serialize)]
 pub struct SetExpr {
     pub id: ExprId,
-    pub object: Box<Expr>,
+    pub object: ExprId,
     pub name: String,
-    pub value: Box<Expr>,
+    pub value: ExprId,
     pub span: Span,
 }
 
@@ -3,7 +3,7 @@ use crate::ast::*;
 pub fn to_sexp(program: &Program) -> String {
     let mut buf = String::new();
     for decl in &program.declarations {
-        sexp_decl(&mut buf, decl);
+        sexp_decl(&mut buf, &program.exprs, decl);
         buf.push('\n');
     }
     buf
@@ -13,7 +13,7 @@ pub fn to_json(program: &Program) -> String {
     serde_json::to_string_pretty(program).expect("AST should be serializable")
 }
 
-fn sexp_decl(buf: &mut String, decl: &Decl) {
+fn sexp_decl(buf: &mut String, exprs: &ExprArena, decl: &Decl) {
     match decl {
         Decl::Class(c) => {
             buf.push_str("(class ");
@@ -24,25 +24,25 @@ fn sexp_decl(buf: &mut String, decl: &Decl) {
             }
             for method in &c.methods {
                 buf.push(' ');
-                sexp_function(buf, method);
+                sexp_function(buf, exprs, method);
             }
             buf.push(')');
         }
-        Decl::Fun(f) => sexp_function(buf, &f.function),
+        Decl::Fun(f) => sexp_function(buf, exprs, &f.function),
         Decl::Var(v) => {
             buf.push_str("(var ");
             buf.push_str(&v.name);
-            if let Some(ref init) = v.initializer {
+            if let Some(init) = v.initializer {
                 buf.push(' ');
-                sexp_expr(buf, init);
+                sexp_expr(buf, exprs, init);
             }
             buf.push(')');
         }
-        Decl::Statement(s) => sexp_stmt(buf, s),
+        Decl::Statement(s) => sexp_stmt(buf, exprs, s),
     }
 }
 
-fn sexp_function(buf: &mut String, f: &Function) {
+fn sexp_function(buf: &mut String, exprs: &ExprArena, f: &Function) {
     buf.push_str("(fun ");
     buf.push_str(&f.name);
     buf.push_str(" (");
@@ -55,24 +55,24 @@ fn sexp_function(buf: &mut String, f: &Function) {
     buf.push(')');
     for decl in &f.body {
         buf.push(' ');
-        sexp_decl(buf, decl);
+        sexp_decl(buf, exprs, decl);
     }
     buf.push(')');
 }
 
-fn sexp_stmt(buf: &mut String, stmt: &Stmt) {
+fn sexp_stmt(buf: &mut String, exprs: &ExprArena, stmt: &Stmt) {
     match stmt {
-        Stmt::Expression(e) => sexp_expr(buf, &e.expression),
+        Stmt::Expression(e) => sexp_expr(buf, exprs, e.expression),
         Stmt::Print(p) => {
             buf.push_str("(print ");
-            sexp_expr(buf, &p.expression);
+            sexp_expr(buf, exprs, p.expression);
             buf.push(')');
         }
         Stmt::Return(r) => {
             buf.push_str("(return");
-            if let Some(ref val) = r.value {
+            if let Some(val) = r.value {
                 buf.push(' ');
-                sexp_expr(buf, val);
+                sexp_expr(buf, exprs, val);
             }
             buf.push(')');
         }
@@ -80,47 +80,47 @@ fn sexp_stmt(buf: &mut String, stmt: &Stmt) {
             buf.push_str("(block");
             for decl in &b.declarations {
                 buf.push(' ');
-                sexp_decl(buf, decl);
+                sexp_decl(buf, exprs, decl);
             }
             buf.push(')');
         }
         Stmt::If(i) => {
             buf.push_str("(if ");
-            sexp_expr(buf, &i.condition);
+            sexp_expr(buf, exprs, i.condition);
             buf.push(' ');
-            sexp_stmt(buf, &i.then_branch);
+            sexp_stmt(buf, exprs, &i.then_branch);
             if let Some(ref else_branch) = i.else_branch {
                 buf.push(' ');
-                sexp_stmt(buf, else_branch);
+                sexp_stmt(buf, exprs, else_branch);
             }
             buf.push(')');
         }
         Stmt::While(w) => {
             buf.push_str("(while ");
-            sexp_expr(buf, &w.condition);
+            sexp_expr(buf, exprs, w.condition);
             buf.push(' ');
-            sexp_stmt(buf, &w.body);
+            sexp_stmt(buf, exprs, &w.body);
             buf.push(')');
         }
     }
 }
 
-fn sexp_expr(buf: &mut String, expr: &Expr) {
-    match expr {
+fn sexp_expr(buf: &mut String, exprs: &ExprArena, id: ExprId) {
+    match exprs.get(id) {
         Expr::Binary(b) => {
             buf.push('(');
             buf.push_str(&b.operator.to_string());
             buf.push(' ');
-            sexp_expr(buf, &b.left);
+            sexp_expr(buf, exprs, b.left);
             buf.push(' ');
-            sexp_expr(buf, &b.right);
+            sexp_expr(buf, exprs, b.right);
             buf.push(')');
         }
         Expr::Unary(u) => {
             buf.push('(');
             buf.push_str(&u.operator.to_string());
             buf.push(' ');
-            sexp_expr(buf, &u.operand);
+            sexp_expr(buf, exprs, u.operand);
             buf.push(')');
         }
         Expr::Literal(l) => match &l.value {
@@ -135,7 +135,7 @@ fn sexp_expr(buf: &mut String, expr: &Expr) {
         },
         Expr::Grouping(g) => {
             buf.push_str("(group ");
-            sexp_expr(buf, &g.expression);
+            sexp_expr(buf, exprs, g.expression);
             buf.push(')');
         }
         Expr::Variable(v) => buf.push_str(&v.name),
@@ -143,41 +143,41 @@ fn sexp_expr(buf: &mut String, expr: &Expr) {
             buf.push_str("(= ");
             buf.push_str(&a.name);
             buf.push(' ');
-            sexp_expr(buf, &a.value);
+            sexp_expr(buf, exprs, a.value);
             buf.push(')');
         }
         Expr::Logical(l) => {
             buf.push('(');
             buf.push_str(&l.operator.to_string());
             buf.push(' ');
-            sexp_expr(buf, &l.left);
+            sexp_expr(buf, exprs, l.left);
             buf.push(' ');
-            sexp_expr(buf, &l.right);
+            sexp_expr(buf, exprs, l.right);
             buf.push(')');
         }
         Expr::Call(c) => {
             buf.push_str("(call ");
-            sexp_expr(buf, &c.callee);
-            for arg in &c.arguments {
+            sexp_expr(buf, exprs, c.callee);
+            for &arg in &c.arguments {
                 buf.push(' ');
-                sexp_expr(buf, arg);
+                sexp_expr(buf, exprs, arg);
             }
             buf.push(')');
         }
         Expr::Get(g) => {
             buf.push_str("(. ");
-            sexp_expr(buf, &g.object);
+            sexp_expr(buf, exprs, g.object);
             buf.push(' ');
             buf.push_str(&g.name);
             buf.push(')');
         }
         Expr::Set(s) => {
             buf.push_str("(.= ");
-            sexp_expr(buf, &s.object);
+            sexp_expr(buf, exprs, s.object);
             buf.push(' ');
             buf.push_str(&s.name);
             buf.push(' ');
-            sexp_expr(buf, &s.value);
+            sexp_expr(buf, exprs, s.value);
             buf.push(')');
         }
         Expr::This(_) => buf.push_str("this"),
@@ -195,35 +195,52 @@ mod tests {
 
     #[test]
     fn sexp_binary_expression() {
+        let mut exprs = ExprArena::new();
+        let one = exprs.alloc(|id| {
+            Expr::Literal(LiteralExpr {
+                id,
+                value: LiteralValue::Number(1.0),
+                span: Span::new(0, 1),
+            })
+        });
+        let two = exprs.alloc(|id| {
+            Expr::Literal(LiteralExpr {
+                id,
+                value: LiteralValue::Number(2.0),
+                span: Span::new(4, 1),
+            })
+        });
+        let three = exprs.alloc(|id| {
+            Expr::Literal(LiteralExpr {
+                id,
+                value: LiteralValue::Number(3.0),
+                span: Span::new(8, 1),
+            })
+        });
+        let product = exprs.alloc(|id| {
+            Expr::Binary(BinaryExpr {
+                id,
+                left: two,
+                operator: BinaryOp::Multiply,
+                right: three,
+                span: Span::new(4, 5),
+            })
+        });
+        let sum = exprs.alloc(|id| {
+            Expr::Binary(BinaryExpr {
+                id,
+                left: one,
+                operator: BinaryOp::Add,
+                right: product,
+                span: Span::new(0, 9),
+            })
+        });
         let program = Program {
             declarations: vec![Decl::Statement(Stmt::Expression(ExprStmt {
-                expression: Expr::Binary(BinaryExpr {
-                    id: 0,
-                    left: Box::new(Expr::Literal(LiteralExpr {
-                        id: 1,
-                        value: LiteralValue::Number(1.0),
-                        span: Span::new(0, 1),
-                    })),
-                    operator: BinaryOp::Add,
-                    right: Box::new(Expr::Binary(BinaryExpr {
-                        id: 2,
-                        left: Box::new(Expr::Literal(LiteralExpr {
-                            id: 3,
-                            value: LiteralValue::Number(2.0),
-                            span: Span::new(4, 1),
-                        })),
-                        operator: BinaryOp::Multiply,
-                        right: Box::new(Expr::Literal(LiteralExpr {
-                            id: 4,
-                            value: LiteralValue::Number(3.0),
-                            span: Span::new(8, 1),
-                        })),
-                        span: Span::new(4, 5),
-                    })),
-                    span: Span::new(0, 9),
-                }),
+                expression: sum,
                 span: Span::new(0, 10),
             }))],
+            exprs,
         };
         let result = to_sexp(&program);
         assert_eq!(result.trim(), "(+ 1 (* 2 3))");
@@ -231,15 +248,20 @@ mod tests {
 
     #[test]
     fn json_statement_uses_inner_type_not_statement_wrapper() {
+        let mut exprs = ExprArena::new();
+        let hello = exprs.alloc(|id| {
+            Expr::Literal(LiteralExpr {
+                id,
+                value: LiteralValue::String("hello".to_string()),
+                span: Span::new(6, 7),
+            })
+        });
         let program = Program {
             declarations: vec![Decl::Statement(Stmt::Print(PrintStmt {
-                expression: Expr::Literal(LiteralExpr {
-                    id: 0,
-                    value: LiteralValue::String("hello".to_string()),
-                    span: Span::new(6, 7),
-                }),
+                expression: hello,
                 span: Span::new(0, 14),
             }))],
+            exprs,
         };
         let json = to_json(&program);
         let parsed: serde_json::Value = serde_json::from_str(&json).expect("valid JSON");
@@ -252,16 +274,21 @@ mod tests {
 
     #[test]
     fn json_output_is_valid() {
+        let mut exprs = ExprArena::new();
+        let forty_two = exprs.alloc(|id| {
+            Expr::Literal(LiteralExpr {
+                id,
+                value: LiteralValue::Number(42.0),
+                span: Span::new(8, 2),
+            })
+        });
         let program = Program {
             declarations: vec![Decl::Var(VarDecl {
                 name: "x".to_string(),
-                initializer: Some(Expr::Literal(LiteralExpr {
-                    id: 0,
-                    value: LiteralValue::Number(42.0),
-                    span: Span::new(8, 2),
-                })),
+                initializer: Some(forty_two),
                 span: Span::new(0, 11),
             })],
+            exprs,
         };
         let json = to_json(&program);
         let parsed: serde_json::Value =
@@ -45,7 +45,7 @@ impl CaptureAnalyzer {
 
     fn analyze(mut self, program: &Program) -> CaptureInfo {
         for decl in &program.declarations {
-            self.visit_decl(decl);
+            self.visit_decl(&program.exprs, decl);
         }
         CaptureInfo {
             captured_vars: self.captured_vars,
@@ -121,39 +121,39 @@ impl CaptureAnalyzer {
         // Not found in any function scope — must be a global, no capture needed
     }
 
-    fn visit_decl(&mut self, decl: &Decl) {
+    fn visit_decl(&mut self, ast: &ExprArena, decl: &Decl) {
         match decl {
             Decl::Var(v) => {
-                if let Some(ref init) = v.initializer {
-                    self.visit_expr(init);
+                if let Some(init) = v.initializer {
+                    self.visit_expr(ast, init);
                 }
                 self.declare_var(&v.name);
             }
             Decl::Fun(f) => {
                 self.declare_var(&f.function.name);
-                self.visit_function(&f.function);
+                self.visit_function(ast, &f.function);
             }
-            Decl::Statement(s) => self.visit_stmt(s),
+            Decl::Statement(s) => self.visit_stmt(ast, s),
             Decl::Class(c) => {
                 self.declare_var(&c.name);
-                self.visit_class(c);
+                self.visit_class(ast, c);
             }
         }
     }
 
-    fn visit_function(&mut self, function: &Function) {
+    fn visit_function(&mut self, ast: &ExprArena, function: &Function) {
         self.function_scopes
             .push((function.name.clone(), HashSet::new()));
         for param in &function.params {
             self.declare_var(param);
         }
         for decl in &function.body {
-            self.visit_decl(decl);
+            self.visit_decl(ast, decl);
         }
         self.function_scopes.pop();
     }
 
-    fn visit_class(&mut self, class: &ClassDecl) {
+    fn visit_class(&mut self, ast: &ExprArena, class: &ClassDecl) {
         // Reference the superclass variable if present
         if let Some(ref superclass) = class.superclass {
             self.reference_var(superclass);
@@ -172,67 +172,67 @@ impl CaptureAnalyzer {
         self.declare_var("this");
 
         for method in &class.methods {
-            self.visit_function(method);
+            self.visit_function(ast, method);
         }
 
         self.function_scopes.pop();
     }
 
-    fn visit_stmt(&mut self, stmt: &Stmt) {
+    fn visit_stmt(&mut self, ast: &ExprArena, stmt: &Stmt) {
         match stmt {
-            Stmt::Expression(e) => self.visit_expr(&e.expression),
-            Stmt::Print(p) => self.visit_expr(&p.expression),
+            Stmt::Expression(e) => self.visit_expr(ast, e.expression),
+            Stmt::Print(p) => self.visit_expr(ast, p.expression),
             Stmt::Return(r) => {
-                if let Some(ref val) = r.value {
-                    self.visit_expr(val);
+                if let Some(val) = r.value {
+                    self.visit_expr(ast, val);
                 }
             }
             Stmt::Block(b) => {
                 for decl in &b.declarations {
-                    self.visit_decl(decl);
+                    self.visit_decl(ast, decl);
                 }
             }
             Stmt::If(i) => {
-                self.visit_expr(&i.condition);
-                self.visit_stmt(&i.then_branch);
+                self.visit_expr(ast, i.condition);
+                self.visit_stmt(ast, &i.then_branch);
                 if let Some(ref else_branch) = i.else_branch {
-                    self.visit_stmt(else_branch);
+                    self.visit_stmt(ast, else_branch);
                 }
             }
             Stmt::While(w) => {
-                self.visit_expr(&w.condition);
-                self.visit_stmt(&w.body);
+                self.visit_expr(ast, w.condition);
+                self.visit_stmt(ast, &w.body);
             }
         }
     }
 
-    fn visit_expr(&mut self, expr: &Expr) {
-        match expr {
+    fn visit_expr(&mut self, ast: &ExprArena, id: ExprId) {
+        match ast.get(id) {
             Expr::Variable(v) => self.reference_var(&v.name),
             Expr::Assign(a) => {
-                self.visit_expr(&a.value);
+                self.visit_expr(ast, a.value);
                 self.reference_var(&a.name);
             }
             Expr::Binary(b) => {
-                self.visit_expr(&b.left);
-                self.visit_expr(&b.right);
+                self.visit_expr(ast, b.left);
+                self.visit_expr(ast, b.right);
             }
-            Expr::Unary(u) => self.visit_expr(&u.operand),
+            Expr::Unary(u) => self.visit_expr(ast, u.operand),
             Expr::Logical(l) => {
-                self.visit_expr(&l.left);
-                self.visit_expr(&l.right);
+                self.visit_expr(ast, l.left);
+                self.visit_expr(ast, l.right);
             }
             Expr::Call(c) => {
-                self.visit_expr(&c.callee);
-                for arg in &c.arguments {
-                    self.visit_expr(arg);
+                self.visit_expr(ast, c.callee);
+                for &arg in &c.arguments {
+                    self.visit_expr(ast, arg);
                 }
             }
-            Expr::Grouping(g) => self.visit_expr(&g.expression),
-            Expr::Get(g) => self.visit_expr(&g.object),
+            Expr::Grouping(g) => self.visit_expr(ast, g.expression),
+            Expr::Get(g) => self.visit_expr(ast, g.object),
             Expr::Set(s) => {
-                self.visit_expr(&s.value);
-                self.visit_expr(&s.object);
+                self.visit_expr(ast, s.value);
+                self.visit_expr(ast, s.object);
             }
             Expr::Literal(_) | Expr::This(_) | Expr::Super(_) => {}
         }
@@ -1,21 +1,25 @@
-use std::collections::HashMap;
+use std::collections::{HashMap, HashSet};
 
 use inkwell::AddressSpace;
 use inkwell::builder::Builder;
 use inkwell::context::Context;
 use inkwell::module::Module;
 use inkwell::values::{
-    BasicMetadataValueEnum, BasicValueEnum, FunctionValue, PointerValue, StructValue,
+    BasicMetadataValueEnum, BasicValueEnum, FloatValue, FunctionValue, GlobalValue, PointerValue,
+    StructValue,
 };
 
 use crate::ast::{
-    AssignExpr, BinaryExpr, BinaryOp, BlockStmt, CallExpr, ClassDecl, Decl, Expr, ExprId, ExprStmt,
-    FunDecl, GetExpr, IfStmt, LiteralExpr, LiteralValue, LogicalExpr, LogicalOp, PrintStmt,
-    Program, ReturnStmt, SetExpr, Stmt, SuperExpr, ThisExpr, UnaryExpr, UnaryOp, VarDecl,
-    VariableExpr, WhileStmt,
+    AssignExpr, BinaryExpr, BinaryOp, BlockStmt, CallExpr, ClassDecl, Decl, Expr, ExprArena,
+    ExprId, ExprStmt, FunDecl, GetExpr, IfStmt, LiteralExpr, LiteralValue, LogicalExpr, LogicalOp,
+    PrintStmt, Program, ReturnStmt, SetExpr, Stmt, SuperExpr, ThisExpr, UnaryExpr, UnaryOp,
+    VarDecl, VariableExpr, WhileStmt,
 };
 
+use crate::interpreter::resolver::Local;
+
 use super::capture::{CaptureInfo, CapturedVar};
+use super::numeric::NumericInfo;
 use super::runtime::RuntimeDecls;
 use super::types::LoxValueType;
 
@@ -27,6 +31,9 @@ enum VarStorage<'ctx> {
     /// Heap-allocated cell (captured by at least one closure).
     /// The PointerValue points to the cell (LoxValue*).
     Cell(PointerValue<'ctx>),
+    /// Raw f64 alloca for a local the numeric analysis proved to hold only
+    /// numbers. Arithmetic reads and writes it unboxed; generic reads box.
+    NumberAlloca(PointerValue<'ctx>),
 }
 
 /// LLVM IR code generator for Lox programs.
@@ -42,28 +49,44 @@ pub struct CodeGen<'ctx> {
     runtime: RuntimeDecls<'ctx>,
     /// The current LLVM function being compiled into.
     current_fn: Option<FunctionValue<'ctx>>,
-    /// Variable resolution results from the resolver: ExprId → scope depth.
+    /// Variable resolution results from the resolver: ExprId → (distance, slot).
     /// If an ExprId is present, the variable is local; otherwise it's global.
-    locals: HashMap<ExprId, usize>,
+    locals: HashMap<ExprId, Local>,
     /// Stack of local variable scopes. Each scope maps variable names to
     /// their storage (alloca or cell pointer).
     scopes: Vec<HashMap<String, VarStorage<'ctx>>>,
     /// Capture analysis results.
     captures: CaptureInfo,
+    /// Numeric analysis results: which locals can live as raw f64 slots.
+    numeric: NumericInfo,
     /// Name of the Lox function currently being compiled (empty = top-level).
     current_lox_fn: String,
     /// For return statements: alloca for the return value and the exit block.
     return_target: Option<(PointerValue<'ctx>, inkwell::basic_block::BasicBlock<'ctx>)>,
     /// Source text of the program, used to compute line numbers from spans.
     source: String,
+    /// Expression arena of the program being compiled, installed by [`Self::emit`].
+    ast: ExprArena,
+    /// Per-name caches for `lox_global_slot` results: module-level `ptr`
+    /// globals, lazily filled so each global name is hashed at most once.
+    global_slots: HashMap<String, GlobalValue<'ctx>>,
+    /// Top-level functions whose global binding can never change once their
+    /// declaration runs: declared exactly once at top level and never the
+    /// target of an assignment. Computed by [`Self::emit`].
+    devirt_eligible: HashSet<String>,
+    /// LLVM functions and arities for eligible top-level functions whose
+    /// declarations have been compiled. Call sites compiled after the
+    /// declaration call these directly instead of going through the closure.
+    direct_fns: HashMap<String, (FunctionValue<'ctx>, usize)>,
 }
 
 impl<'ctx> CodeGen<'ctx> {
     pub fn new(
         context: &'ctx Context,
         module_name: &str,
-        locals: HashMap<ExprId, usize>,
+        locals: HashMap<ExprId, Local>,
         captures: CaptureInfo,
+        numeric: NumericInfo,
         source: &str,
     ) -> Self {
         let module = context.create_module(module_name);
@@ -80,14 +103,21 @@ impl<'ctx> CodeGen<'ctx> {
             locals,
             scopes: Vec::new(),
             captures,
+            numeric,
             current_lox_fn: String::new(),
             return_target: None,
             source: source.to_string(),
+            ast: ExprArena::new(),
+            global_slots: HashMap::new(),
+            devirt_eligible: HashSet::new(),
+            direct_fns: HashMap::new(),
         }
     }
 
     /// Emit LLVM IR for a Lox program, returning the LLVM module.
     pub fn emit(mut self, program: &Program) -> anyhow::Result<Module<'ctx>> {
+        self.ast = program.exprs.clone();
+        self.devirt_eligible = find_devirt_eligible(program);
         self.emit_main(program)?;
         Ok(self.module)
     }
@@ -106,6 +136,16 @@ impl<'ctx> CodeGen<'ctx> {
         self.builder.position_at_end(entry);
         self.current_fn = Some(main_fn);
 
+        // Hand the collector a stack anchor in main's frame: the runtime
+        // scans from the current stack top to this address when collecting.
+        let gc_anchor = self
+            .builder
+            .build_alloca(self.context.i8_type(), "gc_anchor")
+            .expect("alloca gc stack anchor");
+        self.builder
+            .build_call(self.runtime.lox_gc_init, &[gc_anchor.into()], "")
+            .expect("call lox_gc_init");
+
         // Register native clock() function
         self.register_native_clock()?;
         self.register_native_read_line()?;
@@ -244,45 +284,63 @@ impl<'ctx> CodeGen<'ctx> {
     }
 
     fn compile_var_decl(&mut self, var_decl: &VarDecl) -> anyhow::Result<()> {
-        let value = match &var_decl.initializer {
-            Some(expr) => self.compile_expr(expr)?,
-            None => self.lox_value.build_nil(&self.builder),
-        };
-
         if self.scopes.is_empty() {
             // Top-level: store as global
+            let value = match var_decl.initializer {
+                Some(expr) => self.compile_expr(expr)?,
+                None => self.lox_value.build_nil(&self.builder),
+            };
             self.emit_global_set(&var_decl.name, value);
-        } else {
-            // Check if this variable is captured by an inner function
-            let is_captured = self.captures.captured_vars.contains(&CapturedVar {
-                var_name: var_decl.name.clone(),
-                declaring_function: self.current_lox_fn.clone(),
-            });
+            return Ok(());
+        }
 
-            let storage = if is_captured {
-                // Captured: allocate a heap cell so closures can share it
-                let cell = self
-                    .builder
-                    .build_call(self.runtime.lox_alloc_cell, &[value.into()], "cell")
-                    .expect("call lox_alloc_cell")
-                    .try_as_basic_value()
-                    .unwrap_basic()
-                    .into_pointer_value();
-                VarStorage::Cell(cell)
-            } else {
-                // Not captured: use stack alloca
-                let alloca = self.create_entry_block_alloca(&var_decl.name);
+        // Check if this variable is captured by an inner function
+        let is_captured = self.captures.captured_vars.contains(&CapturedVar {
+            var_name: var_decl.name.clone(),
+            declaring_function: self.current_lox_fn.clone(),
+        });
+
+        let storage = match var_decl.initializer {
+            // Proven number-typed: keep the local as a raw f64 slot so loop
+            // counters and accumulators skip boxing and tag checks entirely.
+            Some(init) if !is_captured && self.numeric.is_number_decl(init) => {
+                let raw = self.compile_number_expr(init)?;
+                let alloca = self.create_entry_block_f64_alloca(&var_decl.name);
                 self.builder
-                    .build_store(alloca, value)
-                    .expect("store local var initializer");
-                VarStorage::Alloca(alloca)
-            };
+                    .build_store(alloca, raw)
+                    .expect("store unboxed number initializer");
+                VarStorage::NumberAlloca(alloca)
+            }
+            _ => {
+                let value = match var_decl.initializer {
+                    Some(expr) => self.compile_expr(expr)?,
+                    None => self.lox_value.build_nil(&self.builder),
+                };
+                if is_captured {
+                    // Captured: allocate a heap cell so closures can share it
+                    let cell = self
+                        .builder
+                        .build_call(self.runtime.lox_alloc_cell, &[value.into()], "cell")
+                        .expect("call lox_alloc_cell")
+                        .try_as_basic_value()
+                        .unwrap_basic()
+                        .into_pointer_value();
+                    VarStorage::Cell(cell)
+                } else {
+                    // Not captured: use stack alloca
+                    let alloca = self.create_entry_block_alloca(&var_decl.name);
+                    self.builder
+                        .build_store(alloca, value)
+                        .expect("store local var initializer");
+                    VarStorage::Alloca(alloca)
+                }
+            }
+        };
 
-            self.scopes
-                .last_mut()
-                .expect("checked non-empty above")
-                .insert(var_decl.name.clone(), storage);
-        }
+        self.scopes
+            .last_mut()
+            .expect("checked non-empty above")
+            .insert(var_decl.name.clone(), storage);
         Ok(())
     }
 
@@ -298,7 +356,7 @@ impl<'ctx> CodeGen<'ctx> {
     }
 
     fn compile_print_stmt(&mut self, stmt: &PrintStmt) -> anyhow::Result<()> {
-        let value = self.compile_expr(&stmt.expression)?;
+        let value = self.compile_expr(stmt.expression)?;
         self.builder
             .build_call(self.runtime.lox_print, &[value.into()], "")
             .expect("call lox_print");
@@ -306,7 +364,7 @@ impl<'ctx> CodeGen<'ctx> {
     }
 
     fn compile_expr_stmt(&mut self, stmt: &ExprStmt) -> anyhow::Result<()> {
-        self.compile_expr(&stmt.expression)?;
+        self.compile_expr(stmt.expression)?;
         Ok(())
     }
 
@@ -322,6 +380,7 @@ impl<'ctx> CodeGen<'ctx> {
     fn compile_fun_decl(&mut self, fun_decl: &FunDecl) -> anyhow::Result<()> {
         let function = &fun_decl.function;
         let fn_name = &function.name;
+        let is_top_level = self.scopes.is_empty();
 
         // Determine which variables this function captures from enclosing scopes
         let captured_names = self
@@ -342,6 +401,16 @@ impl<'ctx> CodeGen<'ctx> {
         let llvm_fn_name = format!("lox_fn_{fn_name}");
         let llvm_fn = self.module.add_function(&llvm_fn_name, fn_type, None);
 
+        // An eligible top-level function can be called directly: its global
+        // binding never changes after this declaration runs, and top-level
+        // functions capture nothing, so call sites need no closure. Register
+        // before the body so self-recursion also devirtualizes — by the time
+        // any call executes, this declaration has already run.
+        if is_top_level && captured_names.is_empty() && self.devirt_eligible.contains(fn_name) {
+            self.direct_fns
+                .insert(fn_name.clone(), (llvm_fn, function.params.len()));
+        }
+
         // Save the current compilation state
         let saved_fn = self.current_fn;
         let saved_lox_fn = self.current_lox_fn.clone();
@@ -1050,7 +1119,7 @@ impl<'ctx> CodeGen<'ctx> {
             if let Some(storage) = scope.get(name) {
                 return match storage {
                     VarStorage::Cell(cell) => *cell,
-                    VarStorage::Alloca(_) => {
+                    VarStorage::Alloca(_) | VarStorage::NumberAlloca(_) => {
                         panic!("captured variable '{name}' should be in a cell, not an alloca")
                     }
                 };
@@ -1060,14 +1129,20 @@ impl<'ctx> CodeGen<'ctx> {
     }
 
     fn compile_call(&mut self, call: &CallExpr) -> anyhow::Result<StructValue<'ctx>> {
+        // A callee naming a top-level function that can never be rebound
+        // skips the closure load, runtime arity check, and indirect call.
+        if let Some(result) = self.try_compile_direct_call(call)? {
+            return Ok(result);
+        }
+
         let current_fn = self.current_fn.expect("must be inside a function");
-        let callee = self.compile_expr(&call.callee)?;
+        let callee = self.compile_expr(call.callee)?;
         let lv_type = self.lox_value.llvm_type();
         let line = self.line_from_offset(call.span.offset);
 
         // Evaluate arguments upfront (needed for both function and class calls)
         let mut arg_vals = Vec::new();
-        for arg in &call.arguments {
+        for &arg in &call.arguments {
             arg_vals.push(self.compile_expr(arg)?);
         }
 
@@ -1129,6 +1204,48 @@ impl<'ctx> CodeGen<'ctx> {
         Ok(phi.as_basic_value().into_struct_value())
     }
 
+    /// Try to emit a devirtualized call. Returns `Some` when the callee is a
+    /// plain reference to a top-level function that is declared exactly once
+    /// and never reassigned, and the reference isn't shadowed by a local:
+    /// the call becomes a direct LLVM call with the arity checked at compile
+    /// time and a null env (top-level functions capture nothing). Dynamic
+    /// callees — and arity mismatches, which must keep erroring at runtime
+    /// only if actually executed — return `None` for the generic path.
+    fn try_compile_direct_call(
+        &mut self,
+        call: &CallExpr,
+    ) -> anyhow::Result<Option<StructValue<'ctx>>> {
+        let (name, callee_id) = match self.ast.get(call.callee) {
+            Expr::Variable(var) => (var.name.clone(), var.id),
+            _ => return Ok(None),
+        };
+        // Mirror compile_variable: the reference is a local read only when
+        // the resolver marked it local and a scope currently binds the name.
+        if self.locals.contains_key(&callee_id) && self.find_local(&name).is_some() {
+            return Ok(None);
+        }
+        let Some(&(target, arity)) = self.direct_fns.get(&name) else {
+            return Ok(None);
+        };
+        if call.arguments.len() != arity {
+            return Ok(None);
+        }
+
+        let ptr_type = self.context.ptr_type(AddressSpace::default());
+        let mut call_args: Vec<BasicMetadataValueEnum> = vec![ptr_type.const_null().into()];
+        for &arg in &call.arguments {
+            call_args.push(self.compile_expr(arg)?.into());
+        }
+        let result = self
+            .builder
+            .build_call(target, &call_args, "direct_call")
+            .expect("build direct call")
+            .try_as_basic_value()
+            .unwrap_basic()
+            .into_struct_value();
+        Ok(Some(result))
+    }
+
     /// Emit an indirect call through a closure struct (TAG_FUNCTION path).
     fn emit_closure_call(
         &mut self,
@@ -1307,7 +1424,7 @@ impl<'ctx> CodeGen<'ctx> {
     }
 
     fn compile_return(&mut self, ret: &ReturnStmt) -> anyhow::Result<()> {
-        let value = match &ret.value {
+        let value = match ret.value {
             Some(expr) => self.compile_expr(expr)?,
             None => self.lox_value.build_nil(&self.builder),
         };
@@ -1332,43 +1449,205 @@ impl<'ctx> CodeGen<'ctx> {
         Ok(())
     }
 
+    /// LLVM struct type mirroring the runtime's `LoxInstance`:
+    /// `{ ptr klass, ptr shape, i32 capacity, ptr values }`.
+    fn instance_struct_type(&self) -> inkwell::types::StructType<'ctx> {
+        let ptr_type = self.context.ptr_type(AddressSpace::default());
+        let i32_type = self.context.i32_type();
+        self.context.struct_type(
+            &[
+                ptr_type.into(),
+                ptr_type.into(),
+                i32_type.into(),
+                ptr_type.into(),
+            ],
+            false,
+        )
+    }
+
+    /// Allocate a zeroed per-access-site `LoxPropertyCache`
+    /// (`{ ptr shape, ptr transition, i32 offset }`) as module data.
+    fn add_property_cache(&mut self) -> (GlobalValue<'ctx>, inkwell::types::StructType<'ctx>) {
+        let ptr_type = self.context.ptr_type(AddressSpace::default());
+        let i32_type = self.context.i32_type();
+        let cache_type = self
+            .context
+            .struct_type(&[ptr_type.into(), ptr_type.into(), i32_type.into()], false);
+        let cache = self.module.add_global(cache_type, None, "prop.cache");
+        cache.set_linkage(inkwell::module::Linkage::Internal);
+        cache.set_initializer(&cache_type.const_zero());
+        (cache, cache_type)
+    }
+
     fn compile_get(&mut self, get: &GetExpr) -> anyhow::Result<StructValue<'ctx>> {
-        let object = self.compile_expr(&get.object)?;
+        let object = self.compile_expr(get.object)?;
         let line = self.line_from_offset(get.span.offset);
         self.check_is_instance(object, "only instances have properties", line);
+
+        // Shape check against this site's cache: on a hit the access is an
+        // indexed load from the instance's values array; on a miss the
+        // runtime resolves the name and refills the cache.
+        let current_fn = self.current_fn.expect("must be inside a function");
+        let ptr_type = self.context.ptr_type(AddressSpace::default());
+        let lv_type = self.lox_value.llvm_type();
+        let instance_type = self.instance_struct_type();
+        let (cache, cache_type) = self.add_property_cache();
+
+        let payload = self.lox_value.extract_payload(&self.builder, object);
+        let inst_ptr = self
+            .builder
+            .build_int_to_ptr(payload, ptr_type, "inst_ptr")
+            .expect("instance payload to ptr");
+        let shape_slot = self
+            .builder
+            .build_struct_gep(instance_type, inst_ptr, 1, "shape_slot")
+            .expect("GEP to instance shape");
+        let shape = self
+            .builder
+            .build_load(ptr_type, shape_slot, "shape")
+            .expect("load instance shape")
+            .into_pointer_value();
+        let cache_shape_slot = self
+            .builder
+            .build_struct_gep(cache_type, cache.as_pointer_value(), 0, "cache_shape_slot")
+            .expect("GEP to cache shape");
+        let cache_shape = self
+            .builder
+            .build_load(ptr_type, cache_shape_slot, "cache_shape")
+            .expect("load cached shape")
+            .into_pointer_value();
+        let cache_transition_slot = self
+            .builder
+            .build_struct_gep(
+                cache_type,
+                cache.as_pointer_value(),
+                1,
+                "cache_transition_slot",
+            )
+            .expect("GEP to cache transition");
+        let cache_transition = self
+            .builder
+            .build_load(ptr_type, cache_transition_slot, "cache_transition")
+            .expect("load cached transition")
+            .into_pointer_value();
+
+        // A zeroed cache never hits: the instance shape is never null.
+        let shape_matches = self
+            .builder
+            .build_int_compare(
+                inkwell::IntPredicate::EQ,
+                self.builder
+                    .build_ptr_to_int(shape, self.context.i64_type(), "shape_int")
+                    .expect("shape ptr to int"),
+                self.builder
+                    .build_ptr_to_int(cache_shape, self.context.i64_type(), "cache_shape_int")
+                    .expect("cache shape ptr to int"),
+                "shape_matches",
+            )
+            .expect("compare shapes");
+        let no_transition = self
+            .builder
+            .build_is_null(cache_transition, "no_transition")
+            .expect("null-check cached transition");
+        let cache_hit = self
+            .builder
+            .build_and(shape_matches, no_transition, "prop_cache_hit")
+            .expect("and shape/transition checks");
+
+        let fast_bb = self.context.append_basic_block(current_fn, "prop_fast");
+        let slow_bb = self.context.append_basic_block(current_fn, "prop_slow");
+        let merge_bb = self.context.append_basic_block(current_fn, "prop_merge");
+        self.builder
+            .build_conditional_branch(cache_hit, fast_bb, slow_bb)
+            .expect("branch on property cache");
+
+        self.builder.position_at_end(fast_bb);
+        let values_slot = self
+            .builder
+            .build_struct_gep(instance_type, inst_ptr, 3, "values_slot")
+            .expect("GEP to instance values");
+        let values = self
+            .builder
+            .build_load(ptr_type, values_slot, "values")
+            .expect("load values array")
+            .into_pointer_value();
+        let offset_slot = self
+            .builder
+            .build_struct_gep(cache_type, cache.as_pointer_value(), 2, "offset_slot")
+            .expect("GEP to cache offset");
+        let offset = self
+            .builder
+            .build_load(self.context.i32_type(), offset_slot, "offset")
+            .expect("load cached offset")
+            .into_int_value();
+        let field_ptr = unsafe {
+            self.builder
+                .build_gep(lv_type, values, &[offset], "field_ptr")
+                .expect("GEP into values array")
+        };
+        let fast_val = self
+            .builder
+            .build_load(lv_type, field_ptr, "field_val")
+            .expect("load field value")
+            .into_struct_value();
+        self.builder
+            .build_unconditional_branch(merge_bb)
+            .expect("branch to prop_merge from fast path");
+
+        self.builder.position_at_end(slow_bb);
         let (name_ptr, name_len) = self.build_string_constant(&get.name);
-        let result = self
+        let slow_val = self
             .builder
             .build_call(
-                self.runtime.lox_instance_get_property,
-                &[object.into(), name_ptr.into(), name_len.into()],
+                self.runtime.lox_instance_get_property_cached,
+                &[
+                    object.into(),
+                    name_ptr.into(),
+                    name_len.into(),
+                    cache.as_pointer_value().into(),
+                ],
                 "get_prop",
             )
-            .expect("call lox_instance_get_property")
+            .expect("call lox_instance_get_property_cached")
             .try_as_basic_value()
             .unwrap_basic()
             .into_struct_value();
-        Ok(result)
+        self.builder
+            .build_unconditional_branch(merge_bb)
+            .expect("branch to prop_merge from slow path");
+
+        self.builder.position_at_end(merge_bb);
+        let phi = self
+            .builder
+            .build_phi(lv_type, "prop_val")
+            .expect("build phi for property value");
+        phi.add_incoming(&[(&fast_val, fast_bb), (&slow_val, slow_bb)]);
+        Ok(phi.as_basic_value().into_struct_value())
     }
 
     fn compile_set(&mut self, set: &SetExpr) -> anyhow::Result<StructValue<'ctx>> {
-        let object = self.compile_expr(&set.object)?;
+        let object = self.compile_expr(set.object)?;
         let line = self.line_from_offset(set.span.offset);
         self.check_is_instance(object, "only instances have fields", line);
-        let value = self.compile_expr(&set.value)?;
+        let value = self.compile_expr(set.value)?;
         let (name_ptr, name_len) = self.build_string_constant(&set.name);
+        // Sets stay a runtime call: a set may grow the values array or
+        // transition the shape, but the per-site cache makes the common
+        // repeat store a pointer compare inside the runtime.
+        let (cache, _) = self.add_property_cache();
         self.builder
             .build_call(
-                self.runtime.lox_instance_set_field,
+                self.runtime.lox_instance_set_field_cached,
                 &[
                     object.into(),
                     name_ptr.into(),
                     name_len.into(),
                     value.into(),
+                    cache.as_pointer_value().into(),
                 ],
                 "",
             )
-            .expect("call lox_instance_set_field");
+            .expect("call lox_instance_set_field_cached");
         Ok(value)
     }
 
@@ -1459,7 +1738,7 @@ impl<'ctx> CodeGen<'ctx> {
         let current_fn = self.current_fn.expect("must be inside a function");
 
         // Evaluate condition and convert to i1 via lox_value_truthy
-        let condition = self.compile_expr(&if_stmt.condition)?;
+        let condition = self.compile_expr(if_stmt.condition)?;
         let cond_bool = self.emit_truthy(condition);
 
         let then_bb = self.context.append_basic_block(current_fn, "then");
@@ -1516,7 +1795,7 @@ impl<'ctx> CodeGen<'ctx> {
 
         // Condition block
         self.builder.position_at_end(cond_bb);
-        let condition = self.compile_expr(&while_stmt.condition)?;
+        let condition = self.compile_expr(while_stmt.condition)?;
         let cond_bool = self.emit_truthy(condition);
         self.builder
             .build_conditional_branch(cond_bool, body_bb, exit_bb)
@@ -1534,20 +1813,23 @@ impl<'ctx> CodeGen<'ctx> {
         Ok(())
     }
 
-    fn compile_expr(&mut self, expr: &Expr) -> anyhow::Result<StructValue<'ctx>> {
+    fn compile_expr(&mut self, id: ExprId) -> anyhow::Result<StructValue<'ctx>> {
+        // Clone the node out of the arena: handlers borrow self mutably to
+        // emit IR, so we can't hold the arena borrow across the dispatch.
+        let expr = self.ast.get(id).clone();
         match expr {
-            Expr::Literal(lit) => self.compile_literal(lit),
-            Expr::Binary(bin) => self.compile_binary(bin),
-            Expr::Unary(un) => self.compile_unary(un),
-            Expr::Grouping(g) => self.compile_expr(&g.expression),
-            Expr::Variable(var) => self.compile_variable(var),
-            Expr::Assign(assign) => self.compile_assign(assign),
-            Expr::Logical(logical) => self.compile_logical(logical),
-            Expr::Call(call) => self.compile_call(call),
-            Expr::Get(get) => self.compile_get(get),
-            Expr::Set(set) => self.compile_set(set),
-            Expr::This(this) => self.compile_this(this),
-            Expr::Super(sup) => self.compile_super(sup),
+            Expr::Literal(lit) => self.compile_literal(&lit),
+            Expr::Binary(bin) => self.compile_binary(&bin),
+            Expr::Unary(un) => self.compile_unary(&un),
+            Expr::Grouping(g) => self.compile_expr(g.expression),
+            Expr::Variable(var) => self.compile_variable(&var),
+            Expr::Assign(assign) => self.compile_assign(&assign),
+            Expr::Logical(logical) => self.compile_logical(&logical),
+            Expr::Call(call) => self.compile_call(&call),
+            Expr::Get(get) => self.compile_get(&get),
+            Expr::Set(set) => self.compile_set(&set),
+            Expr::This(this) => self.compile_this(&this),
+            Expr::Super(sup) => self.compile_super(&sup),
         }
     }
 
@@ -1561,14 +1843,30 @@ impl<'ctx> CodeGen<'ctx> {
     }
 
     fn compile_string_literal(&mut self, s: &str) -> anyhow::Result<StructValue<'ctx>> {
-        let global = self
-            .builder
-            .build_global_string_ptr(s, "str")
-            .expect("build global string");
+        // Emit a constant LoxString header { i64 len, ptr buffer, ptr data }
+        // matching the runtime's struct: null buffer marks the bytes as
+        // static, and the stored length spares the runtime any strlen calls.
+        let bytes = self
+            .builder
+            .build_global_string_ptr(s, "str.bytes")
+            .expect("build global string bytes");
+        let i64_type = self.context.i64_type();
+        let ptr_type = self.context.ptr_type(AddressSpace::default());
+        let header_type = self
+            .context
+            .struct_type(&[i64_type.into(), ptr_type.into(), ptr_type.into()], false);
+        let header = self.module.add_global(header_type, None, "str");
+        header.set_linkage(inkwell::module::Linkage::Internal);
+        header.set_constant(true);
+        header.set_initializer(&header_type.const_named_struct(&[
+            i64_type.const_int(s.len() as u64, false).into(),
+            ptr_type.const_null().into(),
+            bytes.as_pointer_value().into(),
+        ]));
         let ptr_as_int = self
             .builder
             .build_ptr_to_int(
-                global.as_pointer_value(),
+                header.as_pointer_value(),
                 self.context.i64_type(),
                 "str_ptr",
             )
@@ -1577,8 +1875,27 @@ impl<'ctx> CodeGen<'ctx> {
     }
 
     fn compile_binary(&mut self, bin: &BinaryExpr) -> anyhow::Result<StructValue<'ctx>> {
-        let left = self.compile_expr(&bin.left)?;
-        let right = self.compile_expr(&bin.right)?;
+        // Both operands statically proven numbers: compute on raw doubles
+        // with no tag checks, boxing only the final result. Nested arithmetic
+        // stays unboxed because compile_number_expr recurses directly.
+        if matches!(
+            bin.operator,
+            BinaryOp::Add
+                | BinaryOp::Subtract
+                | BinaryOp::Multiply
+                | BinaryOp::Divide
+                | BinaryOp::Less
+                | BinaryOp::LessEqual
+                | BinaryOp::Greater
+                | BinaryOp::GreaterEqual
+        ) && self.is_number_expr(bin.left)
+            && self.is_number_expr(bin.right)
+        {
+            return self.compile_number_binary(bin);
+        }
+
+        let left = self.compile_expr(bin.left)?;
+        let right = self.compile_expr(bin.right)?;
         let line = self.line_from_offset(bin.span.offset);
 
         match bin.operator {
@@ -1595,6 +1912,168 @@ impl<'ctx> CodeGen<'ctx> {
         }
     }
 
+    /// Compile a binary expression whose operands are both provably numbers.
+    /// Arithmetic operates on raw doubles and boxes once at the end;
+    /// comparisons feed the fcmp result straight into a bool LoxValue.
+    fn compile_number_binary(&mut self, bin: &BinaryExpr) -> anyhow::Result<StructValue<'ctx>> {
+        let lhs = self.compile_number_expr(bin.left)?;
+        let rhs = self.compile_number_expr(bin.right)?;
+
+        use inkwell::FloatPredicate;
+        let predicate = match bin.operator {
+            BinaryOp::Add => {
+                let sum = self
+                    .builder
+                    .build_float_add(lhs, rhs, "add")
+                    .expect("float add");
+                return Ok(self.lox_value.build_number_from_float(&self.builder, sum));
+            }
+            BinaryOp::Subtract => {
+                let diff = self
+                    .builder
+                    .build_float_sub(lhs, rhs, "sub")
+                    .expect("float sub");
+                return Ok(self.lox_value.build_number_from_float(&self.builder, diff));
+            }
+            BinaryOp::Multiply => {
+                let product = self
+                    .builder
+                    .build_float_mul(lhs, rhs, "mul")
+                    .expect("float mul");
+                return Ok(self
+                    .lox_value
+                    .build_number_from_float(&self.builder, product));
+            }
+            BinaryOp::Divide => {
+                let quotient = self
+                    .builder
+                    .build_float_div(lhs, rhs, "div")
+                    .expect("float div");
+                return Ok(self
+                    .lox_value
+                    .build_number_from_float(&self.builder, quotient));
+            }
+            BinaryOp::Less => FloatPredicate::OLT,
+            BinaryOp::LessEqual => FloatPredicate::OLE,
+            BinaryOp::Greater => FloatPredicate::OGT,
+            BinaryOp::GreaterEqual => FloatPredicate::OGE,
+            BinaryOp::Equal | BinaryOp::NotEqual => {
+                unreachable!("equality takes the generic path")
+            }
+        };
+
+        let cmp = self
+            .builder
+            .build_float_compare(predicate, lhs, rhs, "cmp")
+            .expect("float compare");
+        Ok(self.lox_value.build_bool_from_i1(&self.builder, cmp))
+    }
+
+    /// True if `id` provably evaluates to a number: number literals,
+    /// negation, arithmetic over provable operands, and reads of locals the
+    /// numeric analysis gave raw f64 storage. Mirrors the analysis in
+    /// [`super::numeric`], but checks the storage actually emitted so the
+    /// two can't drift apart.
+    fn is_number_expr(&self, id: ExprId) -> bool {
+        match self.ast.get(id) {
+            Expr::Literal(lit) => matches!(lit.value, LiteralValue::Number(_)),
+            Expr::Grouping(g) => self.is_number_expr(g.expression),
+            Expr::Unary(un) => {
+                matches!(un.operator, UnaryOp::Negate) && self.is_number_expr(un.operand)
+            }
+            Expr::Binary(bin) => {
+                matches!(
+                    bin.operator,
+                    BinaryOp::Add | BinaryOp::Subtract | BinaryOp::Multiply | BinaryOp::Divide
+                ) && self.is_number_expr(bin.left)
+                    && self.is_number_expr(bin.right)
+            }
+            Expr::Variable(var) => {
+                self.locals.contains_key(&var.id)
+                    && matches!(
+                        self.find_local(&var.name),
+                        Some(VarStorage::NumberAlloca(_))
+                    )
+            }
+            _ => false,
+        }
+    }
+
+    /// Compile an expression to a raw f64. Expressions [`Self::is_number_expr`]
+    /// accepts are emitted unboxed with no tag checks; anything else falls
+    /// back to the generic path followed by a checked unbox.
+    fn compile_number_expr(&mut self, id: ExprId) -> anyhow::Result<FloatValue<'ctx>> {
+        let expr = self.ast.get(id).clone();
+        match expr {
+            Expr::Literal(LiteralExpr {
+                value: LiteralValue::Number(n),
+                ..
+            }) => Ok(self.context.f64_type().const_float(n)),
+            Expr::Grouping(g) => self.compile_number_expr(g.expression),
+            Expr::Unary(un)
+                if matches!(un.operator, UnaryOp::Negate) && self.is_number_expr(un.operand) =>
+            {
+                let operand = self.compile_number_expr(un.operand)?;
+                Ok(self
+                    .builder
+                    .build_float_neg(operand, "neg")
+                    .expect("float neg"))
+            }
+            Expr::Binary(bin)
+                if matches!(
+                    bin.operator,
+                    BinaryOp::Add | BinaryOp::Subtract | BinaryOp::Multiply | BinaryOp::Divide
+                ) && self.is_number_expr(bin.left)
+                    && self.is_number_expr(bin.right) =>
+            {
+                let lhs = self.compile_number_expr(bin.left)?;
+                let rhs = self.compile_number_expr(bin.right)?;
+                let result = match bin.operator {
+                    BinaryOp::Add => self.builder.build_float_add(lhs, rhs, "add"),
+                    BinaryOp::Subtract => self.builder.build_float_sub(lhs, rhs, "sub"),
+                    BinaryOp::Multiply => self.builder.build_float_mul(lhs, rhs, "mul"),
+                    BinaryOp::Divide => self.builder.build_float_div(lhs, rhs, "div"),
+                    _ => unreachable!("guard matched arithmetic operator"),
+                };
+                Ok(result.expect("float binop"))
+            }
+            Expr::Variable(var)
+                if self.locals.contains_key(&var.id)
+                    && matches!(
+                        self.find_local(&var.name),
+                        Some(VarStorage::NumberAlloca(_))
+                    ) =>
+            {
+                let Some(VarStorage::NumberAlloca(alloca)) = self.find_local(&var.name) else {
+                    unreachable!("guard matched NumberAlloca storage")
+                };
+                Ok(self
+                    .builder
+                    .build_load(self.context.f64_type(), alloca, &var.name)
+                    .expect("load unboxed number")
+                    .into_float_value())
+            }
+            _ => {
+                // Not statically provable: evaluate generically and unbox
+                // with a runtime tag check. The numeric analysis only routes
+                // provable expressions here, so this is a safety net.
+                let line = self.line_from_offset(self.ast.get(id).span().offset);
+                let value = self.compile_expr(id)?;
+                let tag = self.lox_value.extract_tag(&self.builder, value);
+                let number_tag = self
+                    .context
+                    .i8_type()
+                    .const_int(u64::from(super::types::TAG_NUMBER), false);
+                let is_num = self
+                    .builder
+                    .build_int_compare(inkwell::IntPredicate::EQ, tag, number_tag, "is_num")
+                    .expect("check value is number");
+                self.emit_type_check(is_num, "operand must be a number", line);
+                Ok(self.lox_value.extract_number(&self.builder, value))
+            }
+        }
+    }
+
     fn compile_add(
         &mut self,
         left: StructValue<'ctx>,
@@ -1879,7 +2358,19 @@ impl<'ctx> CodeGen<'ctx> {
     }
 
     fn compile_unary(&mut self, un: &UnaryExpr) -> anyhow::Result<StructValue<'ctx>> {
-        let operand = self.compile_expr(&un.operand)?;
+        // Negating a provable number needs no tag check.
+        if matches!(un.operator, UnaryOp::Negate) && self.is_number_expr(un.operand) {
+            let operand = self.compile_number_expr(un.operand)?;
+            let negated = self
+                .builder
+                .build_float_neg(operand, "neg")
+                .expect("float neg");
+            return Ok(self
+                .lox_value
+                .build_number_from_float(&self.builder, negated));
+        }
+
+        let operand = self.compile_expr(un.operand)?;
         match un.operator {
             UnaryOp::Negate => {
                 let line = self.line_from_offset(un.span.offset);
@@ -1923,7 +2414,7 @@ impl<'ctx> CodeGen<'ctx> {
     fn compile_logical(&mut self, logical: &LogicalExpr) -> anyhow::Result<StructValue<'ctx>> {
         let current_fn = self.current_fn.expect("must be inside a function");
 
-        let left = self.compile_expr(&logical.left)?;
+        let left = self.compile_expr(logical.left)?;
         let left_truthy = self.emit_truthy(left);
 
         let rhs_bb = self.context.append_basic_block(current_fn, "log_rhs");
@@ -1949,7 +2440,7 @@ impl<'ctx> CodeGen<'ctx> {
 
         // Evaluate right operand
         self.builder.position_at_end(rhs_bb);
-        let right = self.compile_expr(&logical.right)?;
+        let right = self.compile_expr(logical.right)?;
         let rhs_exit_bb = self.builder.get_insert_block().expect("have insert block");
         self.builder
             .build_unconditional_branch(merge_bb)
@@ -1980,7 +2471,19 @@ impl<'ctx> CodeGen<'ctx> {
     }
 
     fn compile_assign(&mut self, assign: &AssignExpr) -> anyhow::Result<StructValue<'ctx>> {
-        let value = self.compile_expr(&assign.value)?;
+        // Assignment to a raw f64 local stores the double directly; the
+        // boxed result is only materialized for the assignment's own value.
+        if self.locals.contains_key(&assign.id)
+            && let Some(VarStorage::NumberAlloca(alloca)) = self.find_local(&assign.name)
+        {
+            let raw = self.compile_number_expr(assign.value)?;
+            self.builder
+                .build_store(alloca, raw)
+                .expect("store unboxed number");
+            return Ok(self.lox_value.build_number_from_float(&self.builder, raw));
+        }
+
+        let value = self.compile_expr(assign.value)?;
         if self.locals.contains_key(&assign.id) {
             if let Some(storage) = self.find_local(&assign.name) {
                 self.store_var_storage(&storage, value);
@@ -2029,6 +2532,15 @@ impl<'ctx> CodeGen<'ctx> {
                 .try_as_basic_value()
                 .unwrap_basic()
                 .into_struct_value(),
+            VarStorage::NumberAlloca(alloca) => {
+                // Generic read of an unboxed local: box it on the way out.
+                let raw = self
+                    .builder
+                    .build_load(self.context.f64_type(), *alloca, name)
+                    .expect("load unboxed number")
+                    .into_float_value();
+                self.lox_value.build_number_from_float(&self.builder, raw)
+            }
         }
     }
 
@@ -2049,6 +2561,9 @@ impl<'ctx> CodeGen<'ctx> {
                     )
                     .expect("call lox_cell_set");
             }
+            VarStorage::NumberAlloca(_) => {
+                unreachable!("number locals are assigned through compile_assign's unboxed path")
+            }
         }
     }
 
@@ -2071,6 +2586,24 @@ impl<'ctx> CodeGen<'ctx> {
             .expect("build alloca for local var")
     }
 
+    /// Like [`Self::create_entry_block_alloca`], but a raw f64 slot for a
+    /// number-typed local.
+    fn create_entry_block_f64_alloca(&self, name: &str) -> PointerValue<'ctx> {
+        let current_fn = self.current_fn.expect("must be inside a function");
+        let entry = current_fn
+            .get_first_basic_block()
+            .expect("function has entry block");
+
+        let alloca_builder = self.context.create_builder();
+        match entry.get_first_instruction() {
+            Some(first_instr) => alloca_builder.position_before(&first_instr),
+            None => alloca_builder.position_at_end(entry),
+        }
+        alloca_builder
+            .build_alloca(self.context.f64_type(), name)
+            .expect("build alloca for number local")
+    }
+
     // --- Helpers ---
 
     /// Call `lox_value_truthy` to convert a LoxValue to an LLVM i1.
@@ -2085,29 +2618,113 @@ impl<'ctx> CodeGen<'ctx> {
 
     // --- Global variable access ---
 
-    fn emit_global_get(&mut self, name: &str) -> StructValue<'ctx> {
-        let (name_ptr, name_len) = self.build_string_constant(name);
+    /// Emit code that yields the cached `LoxValue*` slot for a global name.
+    ///
+    /// Each name gets one module-level `ptr` global, initialized to null.
+    /// At the access site we load it and, if still null, call
+    /// `lox_global_slot` once and cache the result — so the runtime hash
+    /// lookup happens at most once per name, not per access.
+    fn emit_global_slot(&mut self, name: &str) -> PointerValue<'ctx> {
+        let ptr_type = self.context.ptr_type(AddressSpace::default());
+        let cache = match self.global_slots.get(name) {
+            Some(cache) => *cache,
+            None => {
+                let cache =
+                    self.module
+                        .add_global(ptr_type, None, &format!("lox.global.slot.{name}"));
+                cache.set_linkage(inkwell::module::Linkage::Internal);
+                cache.set_initializer(&ptr_type.const_null());
+                self.global_slots.insert(name.to_string(), cache);
+                cache
+            }
+        };
+
+        let current_fn = self.current_fn.expect("must be inside a function");
+        let cached = self
+            .builder
+            .build_load(ptr_type, cache.as_pointer_value(), "slot_cached")
+            .expect("load cached global slot")
+            .into_pointer_value();
+        let is_null = self
+            .builder
+            .build_is_null(cached, "slot_missing")
+            .expect("null-check cached slot");
+        let cached_bb = self.builder.get_insert_block().expect("have insert block");
+
+        let resolve_bb = self.context.append_basic_block(current_fn, "slot_resolve");
+        let done_bb = self.context.append_basic_block(current_fn, "slot_done");
         self.builder
+            .build_conditional_branch(is_null, resolve_bb, done_bb)
+            .expect("branch on cached slot");
+
+        self.builder.position_at_end(resolve_bb);
+        let (name_ptr, name_len) = self.build_string_constant(name);
+        let resolved = self
+            .builder
             .build_call(
-                self.runtime.lox_global_get,
+                self.runtime.lox_global_slot,
                 &[name_ptr.into(), name_len.into()],
-                "global_get",
+                "slot",
             )
-            .expect("call lox_global_get")
+            .expect("call lox_global_slot")
             .try_as_basic_value()
             .unwrap_basic()
-            .into_struct_value()
+            .into_pointer_value();
+        self.builder
+            .build_store(cache.as_pointer_value(), resolved)
+            .expect("cache resolved slot");
+        self.builder
+            .build_unconditional_branch(done_bb)
+            .expect("branch to slot_done");
+
+        self.builder.position_at_end(done_bb);
+        let phi = self
+            .builder
+            .build_phi(ptr_type, "slot_ptr")
+            .expect("build phi for global slot");
+        phi.add_incoming(&[(&cached, cached_bb), (&resolved, resolve_bb)]);
+        phi.as_basic_value().into_pointer_value()
+    }
+
+    fn emit_global_get(&mut self, name: &str) -> StructValue<'ctx> {
+        let current_fn = self.current_fn.expect("must be inside a function");
+        let slot = self.emit_global_slot(name);
+        let value = self
+            .builder
+            .build_load(self.lox_value.llvm_type(), slot, "global_get")
+            .expect("load global value")
+            .into_struct_value();
+
+        // A slot can exist before its variable is defined (another access
+        // site reserved it); reading one is still an undefined-variable error.
+        let tag = self.lox_value.extract_tag(&self.builder, value);
+        let undefined_tag = self
+            .context
+            .i8_type()
+            .const_int(u64::from(super::types::TAG_UNDEFINED), false);
+        let is_undefined = self
+            .builder
+            .build_int_compare(inkwell::IntPredicate::EQ, tag, undefined_tag, "is_undef")
+            .expect("compare tag to undefined");
+
+        let err_bb = self.context.append_basic_block(current_fn, "global_undef");
+        let ok_bb = self.context.append_basic_block(current_fn, "global_ok");
+        self.builder
+            .build_conditional_branch(is_undefined, err_bb, ok_bb)
+            .expect("branch on undefined global");
+
+        self.builder.position_at_end(err_bb);
+        self.emit_runtime_error(&format!("undefined variable '{name}'"), 0);
+
+        self.builder.position_at_end(ok_bb);
+        value
     }
 
     fn emit_global_set(&mut self, name: &str, value: StructValue<'ctx>) {
-        let (name_ptr, name_len) = self.build_string_constant(name);
+        let slot = self.emit_global_slot(name);
         self.builder
-            .build_call(
-                self.runtime.lox_global_set,
-                &[name_ptr.into(), name_len.into(), value.into()],
-                "",
-            )
-            .expect("call lox_global_set");
+            .build_store(slot, value)
+            .expect("store global value");
     }
 
     /// Create a global string constant and return (pointer, length).
@@ -2214,6 +2831,45 @@ impl<'ctx> CodeGen<'ctx> {
     }
 }
 
+/// Names of top-level functions whose global binding can never change after
+/// their declaration runs: declared exactly once at top level and never the
+/// target of an assignment anywhere in the program. (Assignments are checked
+/// by name, which conservatively also disqualifies a function when some
+/// unrelated local of the same name is assigned.)
+fn find_devirt_eligible(program: &Program) -> HashSet<String> {
+    let mut assigned: HashSet<&str> = HashSet::new();
+    for id in 0..program.exprs.len() {
+        if let Expr::Assign(assign) = program.exprs.get(id) {
+            assigned.insert(&assign.name);
+        }
+    }
+
+    let mut decl_counts: HashMap<&str, usize> = HashMap::new();
+    for decl in &program.declarations {
+        let name = match decl {
+            Decl::Fun(f) => &f.function.name,
+            Decl::Var(v) => &v.name,
+            Decl::Class(c) => &c.name,
+            Decl::Statement(_) => continue,
+        };
+        *decl_counts.entry(name).or_insert(0) += 1;
+    }
+
+    program
+        .declarations
+        .iter()
+        .filter_map(|decl| match decl {
+            Decl::Fun(f)
+                if decl_counts[f.function.name.as_str()] == 1
+                    && !assigned.contains(f.function.name.as_str()) =>
+            {
+                Some(f.function.name.clone())
+            }
+            _ => None,
+        })
+        .collect()
+}
+
 #[cfg(test)]
 mod tests {
     use super::*;
@@ -2226,8 +2882,9 @@ mod tests {
         let program = Parser::new(tokens).parse().expect("parse succeeds");
         let locals = Resolver::new().resolve(&program).expect("resolve succeeds");
         let captures = super::super::capture::analyze_captures(&program);
+        let numeric = super::super::numeric::analyze_numbers(&program, &captures);
         let context = Context::create();
-        let codegen = CodeGen::new(&context, "test", locals, captures, source);
+        let codegen = CodeGen::new(&context, "test", locals, captures, numeric, source);
         codegen.compile(&program).expect("compile succeeds")
     }
 
@@ -2315,17 +2972,23 @@ mod tests {
     #[test]
     fn global_var_define_and_read() {
         let ir = compile_to_ir("var x = 10; print x;");
-        assert!(ir.contains("lox_global_set"));
-        assert!(ir.contains("lox_global_get"));
+        assert!(
+            ir.contains("lox.global.slot.x"),
+            "x should get a cached slot pointer"
+        );
+        assert!(
+            ir.contains("lox_global_slot"),
+            "slot should be resolved through the runtime"
+        );
     }
 
     #[test]
     fn global_var_assign() {
         let ir = compile_to_ir("var x = 1; x = 2; print x;");
-        let set_count = ir.matches("lox_global_set").count();
+        let slot_count = ir.matches("lox.global.slot.x").count();
         assert!(
-            set_count >= 2,
-            "expected >= 2 global_set calls, got {set_count}"
+            slot_count >= 3,
+            "define, assign, and read should all go through x's slot, got {slot_count}"
         );
     }
 
@@ -2341,6 +3004,15 @@ mod tests {
         assert!(ir.contains("ret i32 0"), "main should return 0");
     }
 
+    #[test]
+    fn main_initializes_gc() {
+        let ir = compile_to_ir("print 1;");
+        assert!(
+            ir.contains("call void @lox_gc_init"),
+            "main should hand the collector its stack anchor"
+        );
+    }
+
     #[test]
     fn constant_folded_arithmetic() {
         // Pure constant expressions get folded by LLVM, so just verify
@@ -2430,10 +3102,10 @@ mod tests {
         assert!(ir.contains("alloca"), "should use alloca for local var");
         assert!(ir.contains("store"), "should store to local var");
         assert!(ir.contains("load"), "should load from local var");
-        // Should not call lox_global_get for "x" (declaration is ok)
+        // Should not touch the global table for "x"
         assert!(
-            !ir.contains("call { i8, i64 } @lox_global_get"),
-            "local var should not call global_get"
+            !ir.contains("lox.global.slot.x"),
+            "local var should not get a global slot"
         );
     }
 
@@ -2447,11 +3119,8 @@ mod tests {
             }
             print x;"#,
         );
-        // Should have both a global_set call (for outer x) and alloca (for inner x)
-        assert!(
-            ir.contains("call void @lox_global_set"),
-            "outer x is global"
-        );
+        // Outer x goes through the global slot cache, inner x uses an alloca
+        assert!(ir.contains("lox.global.slot.x"), "outer x is global");
         assert!(ir.contains("alloca"), "inner x uses alloca");
     }
 
@@ -2476,22 +3145,60 @@ mod tests {
             "should have stores for init and assignment, got {store_count}"
         );
         assert!(
-            !ir.contains("call { i8, i64 } @lox_global_get"),
-            "local assignment should not call global_get"
+            !ir.contains("lox.global.slot.x"),
+            "local assignment should not touch the global table"
         );
     }
 
     #[test]
-    fn mixed_global_and_local() {
-        let ir = compile_to_ir("var g = 1; { var l = 2; print g; print l; }");
-        // Global uses global_set/global_get calls, local uses alloca/load
+    fn number_local_arithmetic_is_unboxed() {
+        let ir = compile_to_ir("{ var x = 1; var y = x + 2; print y; }");
+        // Proven-number locals live in raw f64 slots and add without the
+        // generic path's tag dispatch blocks.
+        assert!(ir.contains("alloca double"), "number local uses f64 slot");
+        assert!(ir.contains("fadd double"), "addition stays on raw doubles");
+        assert!(
+            !ir.contains("add_check_str"),
+            "proven-number add should skip the tag dispatch"
+        );
+    }
+
+    #[test]
+    fn loop_counter_stays_unboxed() {
+        let ir = compile_to_ir("{ var i = 0; while (i < 10) i = i + 1; }");
+        assert!(ir.contains("alloca double"), "counter uses f64 slot");
+        assert!(ir.contains("store double"), "increment stores a raw double");
+        assert!(
+            !ir.contains("add_check_str"),
+            "counter increment should skip the tag dispatch"
+        );
+    }
+
+    #[test]
+    fn string_local_keeps_boxed_storage() {
+        let ir = compile_to_ir(r#"{ var s = "hi"; print s; }"#);
+        assert!(
+            !ir.contains("alloca double"),
+            "non-number local must stay a boxed LoxValue"
+        );
+    }
+
+    #[test]
+    fn number_local_demoted_by_non_number_assignment() {
+        let ir = compile_to_ir(r#"{ var x = 1; x = "s"; print x; }"#);
         assert!(
-            ir.contains("call void @lox_global_set"),
-            "global var calls global_set"
+            !ir.contains("alloca double"),
+            "a later string assignment disqualifies the local"
         );
+    }
+
+    #[test]
+    fn mixed_global_and_local() {
+        let ir = compile_to_ir("var g = 1; { var l = 2; print g; print l; }");
+        // Global goes through its cached slot, local uses alloca/load
         assert!(
-            ir.contains("@lox_global_get"),
-            "reading global from block calls global_get"
+            ir.contains("lox.global.slot.g"),
+            "global var goes through its slot"
         );
         assert!(ir.contains("alloca"), "local var uses alloca");
     }
@@ -2512,8 +3219,62 @@ mod tests {
     fn function_call() {
         let ir = compile_to_ir("fun greet() { print 42; } greet();");
         assert!(ir.contains("@lox_fn_greet"), "should define greet fn");
-        // Call should be indirect (through closure)
-        assert!(ir.contains("call { i8, i64 }"), "should have call result");
+        // greet is top-level and never rebound, so the call is direct
+        assert!(
+            ir.contains("@lox_fn_greet(ptr null"),
+            "call to a never-rebound top-level fn should be direct"
+        );
+    }
+
+    #[test]
+    fn direct_call_skips_closure_machinery() {
+        let ir = compile_to_ir("fun add(a, b) { return a + b; } print add(1, 2);");
+        assert!(
+            ir.contains("@lox_fn_add(ptr null"),
+            "should call the function directly with a null env"
+        );
+        assert!(
+            !ir.contains("fn_call_result"),
+            "direct call should not go through the indirect closure path"
+        );
+    }
+
+    #[test]
+    fn recursive_call_is_direct() {
+        let ir = compile_to_ir(
+            "fun fib(n) { if (n <= 1) return n; return fib(n-1) + fib(n-2); } fib(10);",
+        );
+        assert!(
+            ir.contains("@lox_fn_fib(ptr null"),
+            "self-recursion should devirtualize"
+        );
+    }
+
+    #[test]
+    fn reassigned_function_stays_dynamic() {
+        let ir = compile_to_ir("fun f() { return 1; } f = f; print f();");
+        assert!(
+            ir.contains("fn_call_result"),
+            "a reassigned function must keep the generic closure call"
+        );
+    }
+
+    #[test]
+    fn arity_mismatch_falls_back_to_generic_call() {
+        let ir = compile_to_ir("fun one(a) { return a; } one(1, 2);");
+        assert!(
+            ir.contains("arity_ok"),
+            "a call with the wrong argument count keeps the runtime arity check"
+        );
+    }
+
+    #[test]
+    fn shadowed_function_name_stays_dynamic() {
+        let ir = compile_to_ir("fun f() { return 1; } { var f = nil; f(); }");
+        assert!(
+            ir.contains("fn_call_result"),
+            "a locally shadowed callee must use the generic path"
+        );
     }
 
     #[test]
@@ -2640,10 +3401,17 @@ mod tests {
         let ir = compile_to_ir(
             "class Cake { init(f) { this.flavor = f; } } var c = Cake(1); print c.flavor;",
         );
-        assert!(ir.contains("lox_instance_set_field"), "should set field");
         assert!(
-            ir.contains("lox_instance_get_property"),
-            "should get property"
+            ir.contains("lox_instance_set_field_cached"),
+            "should set field through a property cache"
+        );
+        assert!(
+            ir.contains("lox_instance_get_property_cached"),
+            "should get property through a property cache"
+        );
+        assert!(
+            ir.contains("prop_cache_hit"),
+            "get should shape-check before the indexed load"
         );
     }
 
@@ -2654,7 +3422,7 @@ mod tests {
         );
         assert!(ir.contains("@lox_fn_Greeter_greet"), "should define method");
         assert!(
-            ir.contains("lox_instance_get_property"),
+            ir.contains("lox_instance_get_property_cached"),
             "method access via get_property"
         );
     }
@@ -2723,7 +3491,8 @@ mod tests {
 
     #[test]
     fn callable_check() {
-        let ir = compile_to_ir("fun f() {} f();");
+        // Use a dynamic callee: direct calls to known functions skip the check.
+        let ir = compile_to_ir("var f = nil; f();");
         assert!(
             ir.contains("lox_runtime_error"),
             "call should emit callable check"
@@ -1,6 +1,7 @@
 pub mod capture;
 pub mod compiler;
 pub mod native;
+pub mod numeric;
 pub mod runtime;
 pub mod types;
 
@@ -9,9 +10,54 @@ use std::collections::HashMap;
 use anyhow::Result;
 use inkwell::context::Context;
 use inkwell::module::Module;
+use inkwell::passes::PassBuilderOptions;
 
 use crate::ast::{ExprId, Program};
-use crate::interpreter::resolver::Resolver;
+use crate::interpreter::resolver::{Local, Resolver};
+
+/// LLVM optimization level selected by the CLI's `-O` flag.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum OptLevel {
+    O0,
+    O1,
+    O2,
+}
+
+impl OptLevel {
+    /// Map the numeric `-O` flag (clap caps it at 2).
+    pub fn from_flag(level: u8) -> Self {
+        match level {
+            0 => Self::O0,
+            1 => Self::O1,
+            _ => Self::O2,
+        }
+    }
+
+    /// New-pass-manager pipeline description; `None` means leave the
+    /// module untouched.
+    fn pipeline(self) -> Option<&'static str> {
+        match self {
+            Self::O0 => None,
+            Self::O1 => Some("default<O1>"),
+            Self::O2 => Some("default<O2>"),
+        }
+    }
+}
+
+/// Run LLVM's standard optimization pipeline over `module` in place
+/// (`-O0` is a no-op). The module is retargeted to the host first so the
+/// passes see the real data layout.
+pub fn optimize_module(module: &Module, level: OptLevel) -> Result<()> {
+    let Some(pipeline) = level.pipeline() else {
+        return Ok(());
+    };
+    let machine = native::host_target_machine()?;
+    module.set_triple(&machine.get_triple());
+    module.set_data_layout(&machine.get_target_data().get_data_layout());
+    module
+        .run_passes(pipeline, &machine, PassBuilderOptions::create())
+        .map_err(|msg| anyhow::anyhow!("run LLVM pass pipeline '{pipeline}': {msg}"))
+}
 
 /// Compile a Lox AST to an LLVM Module for further processing.
 ///
@@ -23,7 +69,8 @@ pub fn compile_to_module<'ctx>(
 ) -> Result<Module<'ctx>> {
     let locals = resolve(program)?;
     let captures = capture::analyze_captures(program);
-    let codegen = compiler::CodeGen::new(context, "lox", locals, captures, source);
+    let numeric = numeric::analyze_numbers(program, &captures);
+    let codegen = compiler::CodeGen::new(context, "lox", locals, captures, numeric, source);
     codegen.emit(program)
 }
 
@@ -36,7 +83,7 @@ pub fn compile(program: &Program, source: &str) -> Result<String> {
     Ok(module.print_to_string().to_string())
 }
 
-fn resolve(program: &Program) -> Result<HashMap<ExprId, usize>> {
+fn resolve(program: &Program) -> Result<HashMap<ExprId, Local>> {
     let resolver = Resolver::new();
     resolver
         .resolve(program)
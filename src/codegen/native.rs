@@ -8,15 +8,21 @@ use inkwell::targets::{
     CodeModel, FileType, InitializationConfig, RelocMode, Target, TargetMachine,
 };
 
+use super::OptLevel;
+
 /// Compile an LLVM module to a native ELF executable.
 ///
-/// Emits an object file from the module, links it with the Lox C runtime,
-/// and produces a self-contained executable.
-pub fn compile_to_executable(module: &Module, output_path: &Path) -> Result<()> {
+/// Links the C runtime's bitcode into the module when available (so the
+/// optimizer can inline its helpers), runs the pass pipeline at `level`,
+/// emits an object file, and links it into a self-contained executable.
+pub fn compile_to_executable(module: &Module, output_path: &Path, level: OptLevel) -> Result<()> {
+    let runtime_in_module = link_runtime_bitcode(module)?;
+    super::optimize_module(module, level)?;
+
     let obj_path = output_path.with_extension("o");
     emit_object_file(module, &obj_path)?;
 
-    let link_result = link_executable(&obj_path, output_path);
+    let link_result = link_executable(&obj_path, output_path, !runtime_in_module);
 
     // Clean up the intermediate object file regardless of link success
     let _ = std::fs::remove_file(&obj_path);
@@ -24,8 +30,37 @@ pub fn compile_to_executable(module: &Module, output_path: &Path) -> Result<()>
     link_result
 }
 
-/// Emit an object file from an LLVM module using the host target.
-fn emit_object_file(module: &Module, obj_path: &Path) -> Result<()> {
+/// Link the C runtime's bitcode (built by `build.rs` when clang is
+/// available) into the module, making hot helpers like value boxing
+/// eligible for cross-module inlining by the pass pipeline. Returns false
+/// when no usable bitcode exists; the runtime is then linked as a plain
+/// object file instead, exactly as before.
+fn link_runtime_bitcode(module: &Module) -> Result<bool> {
+    let bc_path = env!("LOX_RUNTIME_BC");
+    if bc_path.is_empty() {
+        return Ok(false);
+    }
+    let runtime = match Module::parse_bitcode_from_path(bc_path, module.get_context()) {
+        Ok(runtime) => runtime,
+        Err(msg) => {
+            // Bitcode from a mismatched clang is not fatal: fall back to
+            // object-file linking and say why.
+            eprintln!(
+                "warning: could not parse runtime bitcode '{bc_path}' ({msg}); \
+                 linking the runtime as an object file instead"
+            );
+            return Ok(false);
+        }
+    };
+    module
+        .link_in_module(runtime)
+        .map_err(|msg| anyhow::anyhow!("link runtime bitcode into module: {msg}"))?;
+    Ok(true)
+}
+
+/// Create a target machine for the host (used for both optimization and
+/// object emission).
+pub(crate) fn host_target_machine() -> Result<TargetMachine> {
     Target::initialize_native(&InitializationConfig::default())
         .map_err(|msg| anyhow::anyhow!("initialize native target: {msg}"))?;
 
@@ -36,7 +71,7 @@ fn emit_object_file(module: &Module, obj_path: &Path) -> Result<()> {
     let cpu = TargetMachine::get_host_cpu_name();
     let features = TargetMachine::get_host_cpu_features();
 
-    let machine = target
+    target
         .create_target_machine(
             &triple,
             cpu.to_str().expect("host CPU name is valid UTF-8"),
@@ -47,9 +82,14 @@ fn emit_object_file(module: &Module, obj_path: &Path) -> Result<()> {
             RelocMode::PIC,
             CodeModel::Default,
         )
-        .ok_or_else(|| anyhow::anyhow!("create target machine for {}", triple))?;
+        .ok_or_else(|| anyhow::anyhow!("create target machine for {}", triple))
+}
+
+/// Emit an object file from an LLVM module using the host target.
+fn emit_object_file(module: &Module, obj_path: &Path) -> Result<()> {
+    let machine = host_target_machine()?;
 
-    module.set_triple(&triple);
+    module.set_triple(&machine.get_triple());
     module.set_data_layout(&machine.get_target_data().get_data_layout());
 
     machine
@@ -60,14 +100,18 @@ fn emit_object_file(module: &Module, obj_path: &Path) -> Result<()> {
     Ok(())
 }
 
-/// Link an object file with the Lox runtime to produce an executable.
-fn link_executable(obj_path: &Path, output_path: &Path) -> Result<()> {
+/// Link an object file into an executable; `with_runtime_obj` adds the Lox
+/// runtime object (skipped when its bitcode was already linked into the
+/// module).
+fn link_executable(obj_path: &Path, output_path: &Path, with_runtime_obj: bool) -> Result<()> {
     let cc = std::env::var("CC").unwrap_or_else(|_| "gcc".to_string());
-    let runtime_obj = env!("LOX_RUNTIME_OBJ");
 
-    let output = Command::new(&cc)
-        .arg(obj_path)
-        .arg(runtime_obj)
+    let mut command = Command::new(&cc);
+    command.arg(obj_path);
+    if with_runtime_obj {
+        command.arg(env!("LOX_RUNTIME_OBJ"));
+    }
+    let output = command
         .arg("-o")
         .arg(output_path)
         .arg("-lm")
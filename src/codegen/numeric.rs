@@ -0,0 +1,286 @@
+use std::collections::{HashMap, HashSet};
+
+use crate::ast::*;
+
+use super::capture::{CaptureInfo, CapturedVar};
+
+/// Locals proven to hold only numbers for their entire lifetime.
+///
+/// Produced by analyzing the AST before codegen. A local qualifies when it
+/// has an initializer, is never captured by a closure, and its initializer
+/// and every assignment to it are provably numeric: number literals,
+/// arithmetic, negation, or reads of other qualifying locals. Codegen gives
+/// these locals raw `f64` stack slots instead of boxed LoxValues, so loop
+/// counters and accumulators stay unboxed with no tag checks; the value is
+/// boxed only when it escapes through a generic read (a call argument, a
+/// print, a store into an object, ...).
+pub struct NumericInfo {
+    /// Qualifying var declarations, identified by their initializer
+    /// expression id (every qualifying decl has an initializer, and no two
+    /// decls share one).
+    number_decls: HashSet<ExprId>,
+}
+
+impl NumericInfo {
+    /// True if the var declaration whose initializer is `init` was proven
+    /// number-typed.
+    pub fn is_number_decl(&self, init: ExprId) -> bool {
+        self.number_decls.contains(&init)
+    }
+}
+
+/// One lexical scope: names declared so far, in declaration order, each with
+/// the initializer id of the var decl it refers to. `None` marks names that
+/// can never qualify — params, function and class names, `this`/`super`,
+/// uninitialized or captured vars, and top-level globals — but that still
+/// shadow outer declarations.
+type Scope = Vec<(String, Option<ExprId>)>;
+
+struct NumericAnalyzer<'a> {
+    captures: &'a CaptureInfo,
+    /// Stack of enclosing function names; last is the function being walked
+    /// (empty string = top-level).
+    functions: Vec<String>,
+    /// Lexical scope stack, spanning all enclosing functions. Index 0 is the
+    /// top-level scope, whose vars are globals.
+    scopes: Vec<Scope>,
+    /// Initializer ids of candidate local var decls, in walk order.
+    decls: Vec<ExprId>,
+    /// Assignments that resolve to a candidate decl: (decl, assigned value).
+    assigns: Vec<(ExprId, ExprId)>,
+    /// Variable reads that resolve to a candidate decl: read expr id → decl.
+    reads: HashMap<ExprId, ExprId>,
+}
+
+impl<'a> NumericAnalyzer<'a> {
+    fn new(captures: &'a CaptureInfo) -> Self {
+        Self {
+            captures,
+            functions: vec![String::new()],
+            scopes: vec![Vec::new()],
+            decls: Vec::new(),
+            assigns: Vec::new(),
+            reads: HashMap::new(),
+        }
+    }
+
+    fn analyze(mut self, program: &Program) -> NumericInfo {
+        for decl in &program.declarations {
+            self.visit_decl(&program.exprs, decl);
+        }
+        self.solve(&program.exprs)
+    }
+
+    /// Iterate to a fixpoint: start from all candidates and demote any decl
+    /// whose initializer or assigned values stop being provably numeric as
+    /// the decls they read from are themselves demoted.
+    fn solve(self, ast: &ExprArena) -> NumericInfo {
+        let mut number: HashSet<ExprId> = self.decls.iter().copied().collect();
+        loop {
+            let mut changed = false;
+            for &init in &self.decls {
+                if number.contains(&init) && !is_number_expr(ast, init, &number, &self.reads) {
+                    number.remove(&init);
+                    changed = true;
+                }
+            }
+            for &(decl, value) in &self.assigns {
+                if number.contains(&decl) && !is_number_expr(ast, value, &number, &self.reads) {
+                    number.remove(&decl);
+                    changed = true;
+                }
+            }
+            if !changed {
+                return NumericInfo {
+                    number_decls: number,
+                };
+            }
+        }
+    }
+
+    fn current_function(&self) -> &str {
+        self.functions.last().expect("non-empty function stack")
+    }
+
+    /// Declare a name that can never qualify (but still shadows).
+    fn declare_opaque(&mut self, name: &str) {
+        self.scopes
+            .last_mut()
+            .expect("non-empty scope stack")
+            .push((name.to_string(), None));
+    }
+
+    /// Resolve a name to the decl it refers to, innermost scope first.
+    /// Returns `None` for globals and for names that can never qualify.
+    fn resolve(&self, name: &str) -> Option<ExprId> {
+        for scope in self.scopes.iter().rev() {
+            if let Some((_, decl)) = scope.iter().rev().find(|(n, _)| n == name) {
+                return *decl;
+            }
+        }
+        None
+    }
+
+    fn visit_decl(&mut self, ast: &ExprArena, decl: &Decl) {
+        match decl {
+            Decl::Var(v) => {
+                if let Some(init) = v.initializer {
+                    self.visit_expr(ast, init);
+                }
+                // Top-level vars are globals, captured vars live in cells,
+                // and uninitialized vars start as nil — none can qualify.
+                let is_global = self.scopes.len() == 1;
+                let is_captured = self.captures.captured_vars.contains(&CapturedVar {
+                    var_name: v.name.clone(),
+                    declaring_function: self.current_function().to_string(),
+                });
+                match v.initializer {
+                    Some(init) if !is_global && !is_captured => {
+                        self.decls.push(init);
+                        self.scopes
+                            .last_mut()
+                            .expect("non-empty scope stack")
+                            .push((v.name.clone(), Some(init)));
+                    }
+                    _ => self.declare_opaque(&v.name),
+                }
+            }
+            Decl::Fun(f) => {
+                self.declare_opaque(&f.function.name);
+                self.visit_function(ast, &f.function);
+            }
+            Decl::Statement(s) => self.visit_stmt(ast, s),
+            Decl::Class(c) => {
+                self.declare_opaque(&c.name);
+                self.visit_class(ast, c);
+            }
+        }
+    }
+
+    fn visit_function(&mut self, ast: &ExprArena, function: &Function) {
+        self.functions.push(function.name.clone());
+        self.scopes.push(Vec::new());
+        for param in &function.params {
+            self.declare_opaque(param);
+        }
+        for decl in &function.body {
+            self.visit_decl(ast, decl);
+        }
+        self.scopes.pop();
+        self.functions.pop();
+    }
+
+    fn visit_class(&mut self, ast: &ExprArena, class: &ClassDecl) {
+        // Mirror the resolver: a class scope providing "this" and "super".
+        self.scopes.push(Vec::new());
+        if class.superclass.is_some() {
+            self.declare_opaque("super");
+        }
+        self.declare_opaque("this");
+        for method in &class.methods {
+            self.visit_function(ast, method);
+        }
+        self.scopes.pop();
+    }
+
+    fn visit_stmt(&mut self, ast: &ExprArena, stmt: &Stmt) {
+        match stmt {
+            Stmt::Expression(e) => self.visit_expr(ast, e.expression),
+            Stmt::Print(p) => self.visit_expr(ast, p.expression),
+            Stmt::Return(r) => {
+                if let Some(val) = r.value {
+                    self.visit_expr(ast, val);
+                }
+            }
+            Stmt::Block(b) => {
+                self.scopes.push(Vec::new());
+                for decl in &b.declarations {
+                    self.visit_decl(ast, decl);
+                }
+                self.scopes.pop();
+            }
+            Stmt::If(i) => {
+                self.visit_expr(ast, i.condition);
+                self.visit_stmt(ast, &i.then_branch);
+                if let Some(ref else_branch) = i.else_branch {
+                    self.visit_stmt(ast, else_branch);
+                }
+            }
+            Stmt::While(w) => {
+                self.visit_expr(ast, w.condition);
+                self.visit_stmt(ast, &w.body);
+            }
+        }
+    }
+
+    fn visit_expr(&mut self, ast: &ExprArena, id: ExprId) {
+        match ast.get(id) {
+            Expr::Variable(v) => {
+                if let Some(decl) = self.resolve(&v.name) {
+                    self.reads.insert(id, decl);
+                }
+            }
+            Expr::Assign(a) => {
+                self.visit_expr(ast, a.value);
+                if let Some(decl) = self.resolve(&a.name) {
+                    self.assigns.push((decl, a.value));
+                }
+            }
+            Expr::Binary(b) => {
+                self.visit_expr(ast, b.left);
+                self.visit_expr(ast, b.right);
+            }
+            Expr::Unary(u) => self.visit_expr(ast, u.operand),
+            Expr::Logical(l) => {
+                self.visit_expr(ast, l.left);
+                self.visit_expr(ast, l.right);
+            }
+            Expr::Call(c) => {
+                self.visit_expr(ast, c.callee);
+                for &arg in &c.arguments {
+                    self.visit_expr(ast, arg);
+                }
+            }
+            Expr::Grouping(g) => self.visit_expr(ast, g.expression),
+            Expr::Get(g) => self.visit_expr(ast, g.object),
+            Expr::Set(s) => {
+                self.visit_expr(ast, s.value);
+                self.visit_expr(ast, s.object);
+            }
+            Expr::Literal(_) | Expr::This(_) | Expr::Super(_) => {}
+        }
+    }
+}
+
+/// True if `id` provably evaluates to a number given the current candidate
+/// set: number literals, negation, arithmetic over provable operands, and
+/// reads of candidate decls. Codegen's `is_number_expr` mirrors this shape
+/// against emitted storage, so the two stay in agreement.
+fn is_number_expr(
+    ast: &ExprArena,
+    id: ExprId,
+    number: &HashSet<ExprId>,
+    reads: &HashMap<ExprId, ExprId>,
+) -> bool {
+    match ast.get(id) {
+        Expr::Literal(lit) => matches!(lit.value, LiteralValue::Number(_)),
+        Expr::Grouping(g) => is_number_expr(ast, g.expression, number, reads),
+        Expr::Unary(u) => {
+            matches!(u.operator, UnaryOp::Negate) && is_number_expr(ast, u.operand, number, reads)
+        }
+        Expr::Binary(b) => {
+            matches!(
+                b.operator,
+                BinaryOp::Add | BinaryOp::Subtract | BinaryOp::Multiply | BinaryOp::Divide
+            ) && is_number_expr(ast, b.left, number, reads)
+                && is_number_expr(ast, b.right, number, reads)
+        }
+        Expr::Variable(_) => reads.get(&id).is_some_and(|decl| number.contains(decl)),
+        _ => false,
+    }
+}
+
+/// Analyze a program to find locals that can live as raw f64 slots.
+pub fn analyze_numbers(program: &Program, captures: &CaptureInfo) -> NumericInfo {
+    NumericAnalyzer::new(captures).analyze(program)
+}
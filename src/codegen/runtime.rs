@@ -11,8 +11,10 @@ pub struct RuntimeDecls<'ctx> {
     pub lox_print: FunctionValue<'ctx>,
     pub lox_global_get: FunctionValue<'ctx>,
     pub lox_global_set: FunctionValue<'ctx>,
+    pub lox_global_slot: FunctionValue<'ctx>,
     pub lox_value_truthy: FunctionValue<'ctx>,
     pub lox_runtime_error: FunctionValue<'ctx>,
+    pub lox_gc_init: FunctionValue<'ctx>,
     pub lox_alloc_closure: FunctionValue<'ctx>,
     pub lox_alloc_cell: FunctionValue<'ctx>,
     pub lox_cell_get: FunctionValue<'ctx>,
@@ -24,6 +26,8 @@ pub struct RuntimeDecls<'ctx> {
     pub lox_alloc_instance: FunctionValue<'ctx>,
     pub lox_instance_get_property: FunctionValue<'ctx>,
     pub lox_instance_set_field: FunctionValue<'ctx>,
+    pub lox_instance_get_property_cached: FunctionValue<'ctx>,
+    pub lox_instance_set_field_cached: FunctionValue<'ctx>,
     pub lox_class_find_method: FunctionValue<'ctx>,
     pub lox_bind_method: FunctionValue<'ctx>,
     pub lox_clock: FunctionValue<'ctx>,
@@ -54,6 +58,10 @@ impl<'ctx> RuntimeDecls<'ctx> {
             void_type.fn_type(&[ptr_type.into(), i64_type.into(), lv_type.into()], false);
         let lox_global_set = module.add_function("lox_global_set", lox_global_set_ty, None);
 
+        // LoxValue* lox_global_slot(i8* name, i64 name_len)
+        let lox_global_slot_ty = ptr_type.fn_type(&[ptr_type.into(), i64_type.into()], false);
+        let lox_global_slot = module.add_function("lox_global_slot", lox_global_slot_ty, None);
+
         // i1 lox_value_truthy(LoxValue value)
         let lox_value_truthy_ty = i1_type.fn_type(&[lv_type.into()], false);
         let lox_value_truthy = module.add_function("lox_value_truthy", lox_value_truthy_ty, None);
@@ -64,6 +72,10 @@ impl<'ctx> RuntimeDecls<'ctx> {
         let lox_runtime_error =
             module.add_function("lox_runtime_error", lox_runtime_error_ty, None);
 
+        // void lox_gc_init(i8* stack_anchor)
+        let lox_gc_init_ty = void_type.fn_type(&[ptr_type.into()], false);
+        let lox_gc_init = module.add_function("lox_gc_init", lox_gc_init_ty, None);
+
         // LoxClosure* lox_alloc_closure(void* fn_ptr, i32 arity, i8* name,
         //                                LoxValue** env, i32 env_count)
         let lox_alloc_closure_ty = ptr_type.fn_type(
@@ -138,6 +150,41 @@ impl<'ctx> RuntimeDecls<'ctx> {
         let lox_instance_set_field =
             module.add_function("lox_instance_set_field", lox_instance_set_field_ty, None);
 
+        // LoxValue lox_instance_get_property_cached(LoxValue, i8* name, i64 name_len,
+        //                                           LoxPropertyCache* cache)
+        let lox_instance_get_property_cached_ty = lv_type.fn_type(
+            &[
+                lv_type.into(),
+                ptr_type.into(),
+                i64_type.into(),
+                ptr_type.into(),
+            ],
+            false,
+        );
+        let lox_instance_get_property_cached = module.add_function(
+            "lox_instance_get_property_cached",
+            lox_instance_get_property_cached_ty,
+            None,
+        );
+
+        // void lox_instance_set_field_cached(LoxValue, i8* name, i64 name_len,
+        //                                    LoxValue value, LoxPropertyCache* cache)
+        let lox_instance_set_field_cached_ty = void_type.fn_type(
+            &[
+                lv_type.into(),
+                ptr_type.into(),
+                i64_type.into(),
+                lv_type.into(),
+                ptr_type.into(),
+            ],
+            false,
+        );
+        let lox_instance_set_field_cached = module.add_function(
+            "lox_instance_set_field_cached",
+            lox_instance_set_field_cached_ty,
+            None,
+        );
+
         // LoxClosure* lox_class_find_method(ptr klass, i8* name)
         let lox_class_find_method_ty = ptr_type.fn_type(&[ptr_type.into(), ptr_type.into()], false);
         let lox_class_find_method =
@@ -163,8 +210,10 @@ impl<'ctx> RuntimeDecls<'ctx> {
             lox_print,
             lox_global_get,
             lox_global_set,
+            lox_global_slot,
             lox_value_truthy,
             lox_runtime_error,
+            lox_gc_init,
             lox_alloc_closure,
             lox_alloc_cell,
             lox_cell_get,
@@ -176,6 +225,8 @@ impl<'ctx> RuntimeDecls<'ctx> {
             lox_alloc_instance,
             lox_instance_get_property,
             lox_instance_set_field,
+            lox_instance_get_property_cached,
+            lox_instance_set_field_cached,
             lox_class_find_method,
             lox_bind_method,
             lox_clock,
@@ -12,6 +12,9 @@ pub const TAG_STRING: u8 = 3;
 pub const TAG_FUNCTION: u8 = 4;
 pub const TAG_CLASS: u8 = 5;
 pub const TAG_INSTANCE: u8 = 6;
+/// Internal sentinel used by the runtime's global table for a slot that has
+/// been reserved but not assigned. Never appears as a real Lox value.
+pub const TAG_UNDEFINED: u8 = 7;
 
 /// Helper for building and extracting LoxValue structs in LLVM IR.
 ///
@@ -55,15 +58,23 @@ impl<'ctx> LoxValueType<'ctx> {
 
     /// Build a number LoxValue from an f64.
     pub fn build_number(&self, builder: &Builder<'ctx>, value: f64) -> StructValue<'ctx> {
-        let f = self.context.f64_type().const_float(value);
+        self.build_number_from_float(builder, self.context.f64_type().const_float(value))
+    }
+
+    /// Box a raw f64 SSA value into a number LoxValue.
+    pub fn build_number_from_float(
+        &self,
+        builder: &Builder<'ctx>,
+        value: inkwell::values::FloatValue<'ctx>,
+    ) -> StructValue<'ctx> {
         let payload = builder
-            .build_bit_cast(f, self.context.i64_type(), "num_to_i64")
+            .build_bit_cast(value, self.context.i64_type(), "num_to_i64")
             .expect("bitcast f64 to i64")
             .into_int_value();
         self.build_tagged_value(builder, TAG_NUMBER, payload)
     }
 
-    /// Build a string LoxValue from a pointer stored as i64.
+    /// Build a string LoxValue from a LoxString header pointer stored as i64.
     pub fn build_string(&self, builder: &Builder<'ctx>, ptr: IntValue<'ctx>) -> StructValue<'ctx> {
         self.build_tagged_value(builder, TAG_STRING, ptr)
     }
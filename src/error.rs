@@ -112,6 +112,17 @@ pub enum RuntimeError {
     Return {
         value: crate::interpreter::value::Value,
     },
+
+    /// Internal control flow for the tree-walk interpreter's trampoline: a
+    /// call in tail position is not performed where it appears; its callee
+    /// and evaluated arguments are thrown to the enclosing `call_function`,
+    /// which re-enters its body loop instead of recursing on the Rust stack.
+    /// Never escapes to user code.
+    #[error("tail call")]
+    TailCall {
+        function: Box<crate::interpreter::callable::LoxFunction>,
+        args: Vec<crate::interpreter::value::Value>,
+    },
 }
 
 impl RuntimeError {
@@ -149,7 +160,7 @@ impl RuntimeError {
     pub fn backtrace_frames(&self) -> &[StackFrame] {
         match self {
             Self::Error { backtrace, .. } => backtrace,
-            Self::Return { .. } => &[],
+            Self::Return { .. } | Self::TailCall { .. } => &[],
         }
     }
 
@@ -172,8 +183,8 @@ impl RuntimeError {
             } => {
                 format!("Error: {}", message)
             }
-            Self::Return { .. } => {
-                // Should never display Return as an error
+            Self::Return { .. } | Self::TailCall { .. } => {
+                // Should never display control-flow variants as errors
                 "Error: unexpected return".to_string()
             }
         }
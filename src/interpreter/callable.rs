@@ -97,7 +97,7 @@ impl NativeFunction {
                 Value::Number(secs)
             }
             Self::ReadLine => match crate::stdlib::read_line_from(&mut std::io::stdin().lock()) {
-                Some(s) => Value::Str(s),
+                Some(s) => Value::Str(Rc::from(s)),
                 None => Value::Nil,
             },
             Self::ToNumber => match &_args[0] {
@@ -4,9 +4,19 @@ use std::rc::Rc;
 
 use crate::interpreter::value::Value;
 
+/// A lexical scope: a flat frame of values plus a name index.
+///
+/// Resolved variable accesses go straight to [`get_at`](Self::get_at) /
+/// [`assign_at`](Self::assign_at) with the `(distance, slot)` pair the
+/// resolver computed — no string hashing on the hot path. Slot order is
+/// definition order, which matches the resolver's declaration order. The
+/// name index stays for the paths that are inherently name-based: globals
+/// (never resolved), REPL definitions, and the superclass lookup in class
+/// declarations.
 #[derive(Debug)]
 pub struct Environment {
-    values: HashMap<String, Value>,
+    slots: Vec<Value>,
+    names: HashMap<String, usize>,
     enclosing: Option<Rc<RefCell<Environment>>>,
 }
 
@@ -19,25 +29,35 @@ impl Default for Environment {
 impl Environment {
     pub fn new() -> Self {
         Self {
-            values: HashMap::new(),
+            slots: Vec::new(),
+            names: HashMap::new(),
             enclosing: None,
         }
     }
 
     pub fn with_enclosing(enclosing: Rc<RefCell<Environment>>) -> Self {
         Self {
-            values: HashMap::new(),
+            slots: Vec::new(),
+            names: HashMap::new(),
             enclosing: Some(enclosing),
         }
     }
 
     pub fn define(&mut self, name: String, value: Value) {
-        self.values.insert(name, value);
+        match self.names.get(&name) {
+            // Redefinition (legal at global scope and in the REPL) keeps
+            // the original slot so resolved references stay valid.
+            Some(&slot) => self.slots[slot] = value,
+            None => {
+                self.names.insert(name, self.slots.len());
+                self.slots.push(value);
+            }
+        }
     }
 
     pub fn get(&self, name: &str) -> Option<Value> {
-        if let Some(val) = self.values.get(name) {
-            return Some(val.clone());
+        if let Some(&slot) = self.names.get(name) {
+            return Some(self.slots[slot].clone());
         }
         if let Some(ref enclosing) = self.enclosing {
             return enclosing.borrow().get(name);
@@ -45,21 +65,21 @@ impl Environment {
         None
     }
 
-    pub fn get_at(&self, distance: usize, name: &str) -> Option<Value> {
+    pub fn get_at(&self, distance: usize, slot: usize) -> Value {
         if distance == 0 {
-            self.values.get(name).cloned()
+            self.slots[slot].clone()
         } else {
             self.enclosing
                 .as_ref()
                 .expect("resolver guarantees valid distance")
                 .borrow()
-                .get_at(distance - 1, name)
+                .get_at(distance - 1, slot)
         }
     }
 
     pub fn assign(&mut self, name: &str, value: Value) -> bool {
-        if self.values.contains_key(name) {
-            self.values.insert(name.to_string(), value);
+        if let Some(&slot) = self.names.get(name) {
+            self.slots[slot] = value;
             return true;
         }
         if let Some(ref enclosing) = self.enclosing {
@@ -68,15 +88,15 @@ impl Environment {
         false
     }
 
-    pub fn assign_at(&mut self, distance: usize, name: &str, value: Value) {
+    pub fn assign_at(&mut self, distance: usize, slot: usize, value: Value) {
         if distance == 0 {
-            self.values.insert(name.to_string(), value);
+            self.slots[slot] = value;
         } else {
             self.enclosing
                 .as_ref()
                 .expect("resolver guarantees valid distance")
                 .borrow_mut()
-                .assign_at(distance - 1, name, value);
+                .assign_at(distance - 1, slot, value);
         }
     }
 }
@@ -122,6 +142,25 @@ mod tests {
         assert!(!env.assign("x", Value::Number(1.0)));
     }
 
+    #[test]
+    fn slots_follow_definition_order() {
+        let mut env = Environment::new();
+        env.define("a".to_string(), Value::Number(1.0));
+        env.define("b".to_string(), Value::Number(2.0));
+        assert!(matches!(env.get_at(0, 0), Value::Number(n) if n == 1.0));
+        assert!(matches!(env.get_at(0, 1), Value::Number(n) if n == 2.0));
+    }
+
+    #[test]
+    fn redefinition_keeps_slot() {
+        let mut env = Environment::new();
+        env.define("x".to_string(), Value::Number(1.0));
+        env.define("y".to_string(), Value::Number(2.0));
+        env.define("x".to_string(), Value::Number(3.0));
+        assert!(matches!(env.get_at(0, 0), Value::Number(n) if n == 3.0));
+        assert!(matches!(env.get_at(0, 1), Value::Number(n) if n == 2.0));
+    }
+
     #[test]
     fn get_at_depth() {
         let outer = Rc::new(RefCell::new(Environment::new()));
@@ -129,6 +168,17 @@ mod tests {
             .borrow_mut()
             .define("x".to_string(), Value::Number(10.0));
         let inner = Rc::new(RefCell::new(Environment::with_enclosing(Rc::clone(&outer))));
-        assert!(matches!(inner.borrow().get_at(1, "x"), Some(Value::Number(n)) if n == 10.0));
+        assert!(matches!(inner.borrow().get_at(1, 0), Value::Number(n) if n == 10.0));
+    }
+
+    #[test]
+    fn assign_at_depth() {
+        let outer = Rc::new(RefCell::new(Environment::new()));
+        outer
+            .borrow_mut()
+            .define("x".to_string(), Value::Number(1.0));
+        let inner = Rc::new(RefCell::new(Environment::with_enclosing(Rc::clone(&outer))));
+        inner.borrow_mut().assign_at(1, 0, Value::Number(5.0));
+        assert!(matches!(outer.borrow().get_at(0, 0), Value::Number(n) if n == 5.0));
     }
 }
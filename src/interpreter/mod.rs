@@ -5,26 +5,39 @@ pub mod value;
 
 use std::cell::RefCell;
 use std::collections::HashMap;
-use std::io::Write;
+use std::io::{BufWriter, Write};
 use std::rc::Rc;
 
 use crate::ast::*;
 use crate::error::{RuntimeError, StackFrame};
 use crate::interpreter::callable::{Callable, LoxFunction, NativeFunction};
 use crate::interpreter::environment::Environment;
-use crate::interpreter::value::{LoxClass, LoxInstance, Value};
+use crate::interpreter::resolver::Local;
+use crate::interpreter::value::{Interner, LoxClass, LoxInstance, Value};
 
 pub struct Interpreter {
     globals: Rc<RefCell<Environment>>,
     environment: Rc<RefCell<Environment>>,
-    locals: HashMap<ExprId, usize>,
+    locals: HashMap<ExprId, Local>,
+    /// Interns string literals so variable reads clone a pointer, not bytes.
+    interner: Interner,
+    /// Printed lines, populated only in capture mode (`new_capturing`).
     output: Vec<String>,
     /// Writer for print output (allows testing without stdout)
     writer: Box<dyn Write>,
+    /// Capture printed lines into `output` instead of writing them out.
+    /// Opt-in (test harnesses, benchmarks): an unconditional capture would
+    /// grow without bound on long print-heavy runs.
+    capture: bool,
     /// Tracks the active call stack for backtrace on runtime errors.
     call_stack: Vec<StackFrame>,
     /// Source code, retained for computing line numbers in backtraces.
     source: String,
+    /// True while executing a (non-initializer) function body, so `return
+    /// f(...)` may throw a `TailCall` to the enclosing trampoline instead
+    /// of recursing. False at top level and in initializers, which keep
+    /// their ordinary return semantics.
+    tail_calls_enabled: bool,
 }
 
 impl Default for Interpreter {
@@ -51,37 +64,24 @@ impl Interpreter {
             globals: Rc::clone(&globals),
             environment: globals,
             locals: HashMap::new(),
+            interner: Interner::default(),
             output: Vec::new(),
-            writer: Box::new(std::io::stdout()),
+            writer: Box::new(BufWriter::new(std::io::stdout())),
+            capture: false,
             call_stack: Vec::new(),
             source: String::new(),
+            tail_calls_enabled: false,
         }
     }
 
-    /// Create an interpreter that captures output (for testing).
-    #[cfg(test)]
-    fn new_capturing() -> Self {
-        let globals = Rc::new(RefCell::new(Environment::new()));
-        for native in [
-            NativeFunction::Clock,
-            NativeFunction::ReadLine,
-            NativeFunction::ToNumber,
-        ] {
-            globals.borrow_mut().define(
-                native.name().to_string(),
-                Value::Function(Callable::Native(native)),
-            );
-        }
-
-        Self {
-            globals: Rc::clone(&globals),
-            environment: globals,
-            locals: HashMap::new(),
-            output: Vec::new(),
-            writer: Box::new(Vec::<u8>::new()),
-            call_stack: Vec::new(),
-            source: String::new(),
-        }
+    /// Create an interpreter that captures printed lines in
+    /// [`Interpreter::output`] instead of writing them to stdout (for test
+    /// harnesses and benchmarks).
+    pub fn new_capturing() -> Self {
+        let mut interp = Self::new();
+        interp.writer = Box::new(std::io::sink());
+        interp.capture = true;
+        interp
     }
 
     /// Set the source code for line-number computation in backtraces.
@@ -92,15 +92,13 @@ impl Interpreter {
     pub fn interpret(
         &mut self,
         program: &Program,
-        locals: HashMap<ExprId, usize>,
+        locals: HashMap<ExprId, Local>,
     ) -> Result<(), RuntimeError> {
         self.locals = locals;
-        for decl in &program.declarations {
-            self.execute_decl(decl)?;
-        }
-        Ok(())
+        self.interpret_additional(program)
     }
 
+    /// Printed lines captured so far; empty unless built via `new_capturing`.
     pub fn output(&self) -> &[String] {
         &self.output
     }
@@ -111,23 +109,34 @@ impl Interpreter {
     }
 
     /// Merge additional locals (for REPL line-by-line resolution).
-    pub fn merge_locals(&mut self, locals: HashMap<ExprId, usize>) {
+    pub fn merge_locals(&mut self, locals: HashMap<ExprId, Local>) {
         self.locals.extend(locals);
     }
 
     /// Execute additional declarations without resetting the environment (for REPL).
+    ///
+    /// The program's arena must contain the nodes of every earlier line
+    /// too (the REPL parses each line into one cumulative arena), since
+    /// previously defined functions reference their ids through it.
     pub fn interpret_additional(&mut self, program: &Program) -> Result<(), RuntimeError> {
+        let mut result = Ok(());
         for decl in &program.declarations {
-            self.execute_decl(decl)?;
+            if let Err(e) = self.execute_decl(&program.exprs, decl) {
+                result = Err(e);
+                break;
+            }
         }
-        Ok(())
+        // One flush per batch: prints go through a BufWriter, not a
+        // syscall per line, and the REPL prompt still follows its output.
+        self.writer.flush().expect("flush should succeed");
+        result
     }
 
-    fn execute_decl(&mut self, decl: &Decl) -> Result<(), RuntimeError> {
+    fn execute_decl(&mut self, ast: &ExprArena, decl: &Decl) -> Result<(), RuntimeError> {
         match decl {
             Decl::Var(v) => {
-                let value = match &v.initializer {
-                    Some(init) => self.evaluate_expr(init)?,
+                let value = match v.initializer {
+                    Some(init) => self.evaluate_expr(ast, init)?,
                     None => Value::Nil,
                 };
                 self.environment.borrow_mut().define(v.name.clone(), value);
@@ -146,7 +155,7 @@ impl Interpreter {
                 Ok(())
             }
             Decl::Class(c) => self.execute_class(c),
-            Decl::Statement(s) => self.execute_stmt(s),
+            Decl::Statement(s) => self.execute_stmt(ast, s),
         }
     }
 
@@ -212,22 +221,59 @@ impl Interpreter {
         Ok(())
     }
 
-    fn execute_stmt(&mut self, stmt: &Stmt) -> Result<(), RuntimeError> {
+    fn execute_stmt(&mut self, ast: &ExprArena, stmt: &Stmt) -> Result<(), RuntimeError> {
         match stmt {
             Stmt::Expression(e) => {
-                self.evaluate_expr(&e.expression)?;
+                self.evaluate_expr(ast, e.expression)?;
                 Ok(())
             }
             Stmt::Print(p) => {
-                let value = self.evaluate_expr(&p.expression)?;
-                let text = format!("{value}");
-                writeln!(self.writer, "{text}").expect("write should succeed");
-                self.output.push(text);
+                let value = self.evaluate_expr(ast, p.expression)?;
+                if self.capture {
+                    self.output.push(format!("{value}"));
+                } else {
+                    writeln!(self.writer, "{value}").expect("write should succeed");
+                }
                 Ok(())
             }
             Stmt::Return(r) => {
-                let value = match &r.value {
-                    Some(val) => self.evaluate_expr(val)?,
+                // A call in tail position is not performed here: the callee
+                // and arguments are evaluated, then thrown to the enclosing
+                // `call_function`, whose trampoline re-enters the next body
+                // instead of recursing — so accumulator-style recursion runs
+                // in constant Rust stack.
+                if self.tail_calls_enabled
+                    && let Some(val) = r.value
+                    && let Expr::Call(c) = ast.get(val)
+                {
+                    let callee = self.evaluate_expr(ast, c.callee)?;
+                    let mut args = Vec::new();
+                    for &arg in &c.arguments {
+                        args.push(self.evaluate_expr(ast, arg)?);
+                    }
+                    if let Value::Function(Callable::User(func)) = callee {
+                        if args.len() != func.declaration.params.len() {
+                            return Err(RuntimeError::with_span(
+                                format!(
+                                    "expected {} arguments but got {}",
+                                    func.declaration.params.len(),
+                                    args.len()
+                                ),
+                                c.span,
+                            ));
+                        }
+                        return Err(RuntimeError::TailCall {
+                            function: Box::new(func),
+                            args,
+                        });
+                    }
+                    // Natives and classes complete immediately; return their
+                    // result the ordinary way.
+                    let value = self.call_value(ast, callee, args, c.span)?;
+                    return Err(RuntimeError::Return { value });
+                }
+                let value = match r.value {
+                    Some(val) => self.evaluate_expr(ast, val)?,
                     None => Value::Nil,
                 };
                 Err(RuntimeError::Return { value })
@@ -236,21 +282,21 @@ impl Interpreter {
                 let env = Rc::new(RefCell::new(Environment::with_enclosing(Rc::clone(
                     &self.environment,
                 ))));
-                self.execute_block(&b.declarations, env)
+                self.execute_block(ast, &b.declarations, env)
             }
             Stmt::If(i) => {
-                let condition = self.evaluate_expr(&i.condition)?;
+                let condition = self.evaluate_expr(ast, i.condition)?;
                 if condition.is_truthy() {
-                    self.execute_stmt(&i.then_branch)
+                    self.execute_stmt(ast, &i.then_branch)
                 } else if let Some(ref else_branch) = i.else_branch {
-                    self.execute_stmt(else_branch)
+                    self.execute_stmt(ast, else_branch)
                 } else {
                     Ok(())
                 }
             }
             Stmt::While(w) => {
-                while self.evaluate_expr(&w.condition)?.is_truthy() {
-                    self.execute_stmt(&w.body)?;
+                while self.evaluate_expr(ast, w.condition)?.is_truthy() {
+                    self.execute_stmt(ast, &w.body)?;
                 }
                 Ok(())
             }
@@ -259,27 +305,30 @@ impl Interpreter {
 
     fn execute_block(
         &mut self,
+        ast: &ExprArena,
         declarations: &[Decl],
         env: Rc<RefCell<Environment>>,
     ) -> Result<(), RuntimeError> {
         let previous = Rc::clone(&self.environment);
         self.environment = env;
-        let result = declarations.iter().try_for_each(|d| self.execute_decl(d));
+        let result = declarations
+            .iter()
+            .try_for_each(|d| self.execute_decl(ast, d));
         self.environment = previous;
         result
     }
 
-    fn evaluate_expr(&mut self, expr: &Expr) -> Result<Value, RuntimeError> {
-        match expr {
+    fn evaluate_expr(&mut self, ast: &ExprArena, id: ExprId) -> Result<Value, RuntimeError> {
+        match ast.get(id) {
             Expr::Literal(l) => Ok(match &l.value {
                 LiteralValue::Number(n) => Value::Number(*n),
-                LiteralValue::String(s) => Value::Str(s.clone()),
+                LiteralValue::String(s) => Value::Str(self.interner.intern(s)),
                 LiteralValue::Bool(b) => Value::Bool(*b),
                 LiteralValue::Nil => Value::Nil,
             }),
-            Expr::Grouping(g) => self.evaluate_expr(&g.expression),
+            Expr::Grouping(g) => self.evaluate_expr(ast, g.expression),
             Expr::Unary(u) => {
-                let operand = self.evaluate_expr(&u.operand)?;
+                let operand = self.evaluate_expr(ast, u.operand)?;
                 match u.operator {
                     UnaryOp::Negate => match operand {
                         Value::Number(n) => Ok(Value::Number(-n)),
@@ -288,14 +337,16 @@ impl Interpreter {
                     UnaryOp::Not => Ok(Value::Bool(!operand.is_truthy())),
                 }
             }
-            Expr::Binary(b) => self.evaluate_binary(b),
+            Expr::Binary(b) => self.evaluate_binary(ast, b),
             Expr::Variable(v) => self.look_up_variable(&v.name, v.id, v.span),
             Expr::Assign(a) => {
-                let value = self.evaluate_expr(&a.value)?;
-                if let Some(&distance) = self.locals.get(&a.id) {
-                    self.environment
-                        .borrow_mut()
-                        .assign_at(distance, &a.name, value.clone());
+                let value = self.evaluate_expr(ast, a.value)?;
+                if let Some(&local) = self.locals.get(&a.id) {
+                    self.environment.borrow_mut().assign_at(
+                        local.distance,
+                        local.slot,
+                        value.clone(),
+                    );
                 } else {
                     let ok = self.globals.borrow_mut().assign(&a.name, value.clone());
                     if !ok {
@@ -308,7 +359,7 @@ impl Interpreter {
                 Ok(value)
             }
             Expr::Logical(l) => {
-                let left = self.evaluate_expr(&l.left)?;
+                let left = self.evaluate_expr(ast, l.left)?;
                 match l.operator {
                     LogicalOp::Or => {
                         if left.is_truthy() {
@@ -321,11 +372,11 @@ impl Interpreter {
                         }
                     }
                 }
-                self.evaluate_expr(&l.right)
+                self.evaluate_expr(ast, l.right)
             }
-            Expr::Call(c) => self.evaluate_call(c),
+            Expr::Call(c) => self.evaluate_call(ast, c),
             Expr::Get(g) => {
-                let object = self.evaluate_expr(&g.object)?;
+                let object = self.evaluate_expr(ast, g.object)?;
                 match object {
                     Value::Instance(inst) => {
                         let val = inst.borrow().get(&g.name, Rc::clone(&inst));
@@ -343,10 +394,10 @@ impl Interpreter {
                 }
             }
             Expr::Set(s) => {
-                let object = self.evaluate_expr(&s.object)?;
+                let object = self.evaluate_expr(ast, s.object)?;
                 match object {
                     Value::Instance(inst) => {
-                        let value = self.evaluate_expr(&s.value)?;
+                        let value = self.evaluate_expr(ast, s.value)?;
                         inst.borrow_mut().set(s.name.clone(), value.clone());
                         Ok(value)
                     }
@@ -358,20 +409,14 @@ impl Interpreter {
             }
             Expr::This(t) => self.look_up_variable("this", t.id, t.span),
             Expr::Super(s) => {
-                let distance = *self
+                let local = *self
                     .locals
                     .get(&s.id)
                     .expect("resolver should have resolved 'super'");
-                let superclass = self
-                    .environment
-                    .borrow()
-                    .get_at(distance, "super")
-                    .expect("resolver guarantees 'super' exists");
-                let object = self
-                    .environment
-                    .borrow()
-                    .get_at(distance - 1, "this")
-                    .expect("resolver guarantees 'this' exists");
+                let superclass = self.environment.borrow().get_at(local.distance, local.slot);
+                // "this" is the sole entry (slot 0) of the scope just inside
+                // the "super" scope.
+                let object = self.environment.borrow().get_at(local.distance - 1, 0);
 
                 if let (Value::Class(sc), Value::Instance(inst)) = (superclass, object) {
                     let method = sc.find_method(&s.method).ok_or_else(|| {
@@ -388,14 +433,16 @@ impl Interpreter {
         }
     }
 
-    fn evaluate_binary(&mut self, b: &BinaryExpr) -> Result<Value, RuntimeError> {
-        let left = self.evaluate_expr(&b.left)?;
-        let right = self.evaluate_expr(&b.right)?;
+    fn evaluate_binary(&mut self, ast: &ExprArena, b: &BinaryExpr) -> Result<Value, RuntimeError> {
+        let left = self.evaluate_expr(ast, b.left)?;
+        let right = self.evaluate_expr(ast, b.right)?;
 
         match b.operator {
             BinaryOp::Add => match (&left, &right) {
                 (Value::Number(a), Value::Number(b_val)) => Ok(Value::Number(a + b_val)),
-                (Value::Str(a), Value::Str(b_val)) => Ok(Value::Str(format!("{a}{b_val}"))),
+                (Value::Str(a), Value::Str(b_val)) => {
+                    Ok(Value::Str(Rc::from(format!("{a}{b_val}"))))
+                }
                 _ => Err(RuntimeError::with_span(
                     "operands must be two numbers or two strings",
                     b.span,
@@ -413,23 +460,34 @@ impl Interpreter {
         }
     }
 
-    fn evaluate_call(&mut self, c: &CallExpr) -> Result<Value, RuntimeError> {
-        let callee = self.evaluate_expr(&c.callee)?;
+    fn evaluate_call(&mut self, ast: &ExprArena, c: &CallExpr) -> Result<Value, RuntimeError> {
+        let callee = self.evaluate_expr(ast, c.callee)?;
 
         let mut args = Vec::new();
-        for arg in &c.arguments {
-            args.push(self.evaluate_expr(arg)?);
+        for &arg in &c.arguments {
+            args.push(self.evaluate_expr(ast, arg)?);
         }
 
+        self.call_value(ast, callee, args, c.span)
+    }
+
+    /// Invoke an already-evaluated callee with evaluated arguments.
+    fn call_value(
+        &mut self,
+        ast: &ExprArena,
+        callee: Value,
+        args: Vec<Value>,
+        span: crate::scanner::token::Span,
+    ) -> Result<Value, RuntimeError> {
         match callee {
             Value::Function(func) => {
                 if args.len() != func.arity() {
                     return Err(RuntimeError::with_span(
                         format!("expected {} arguments but got {}", func.arity(), args.len()),
-                        c.span,
+                        span,
                     ));
                 }
-                self.call_function(&func, args, c.span)
+                self.call_function(ast, &func, args, span)
             }
             Value::Class(class) => {
                 let instance = Rc::new(RefCell::new(LoxInstance::new(Rc::clone(&class))));
@@ -437,22 +495,22 @@ impl Interpreter {
                     if args.len() != init.arity() {
                         return Err(RuntimeError::with_span(
                             format!("expected {} arguments but got {}", init.arity(), args.len()),
-                            c.span,
+                            span,
                         ));
                     }
                     let bound = init.bind(Rc::clone(&instance));
-                    self.call_function(&bound, args, c.span)?;
+                    self.call_function(ast, &bound, args, span)?;
                 } else if !args.is_empty() {
                     return Err(RuntimeError::with_span(
                         format!("expected 0 arguments but got {}", args.len()),
-                        c.span,
+                        span,
                     ));
                 }
                 Ok(Value::Instance(instance))
             }
             _ => Err(RuntimeError::with_span(
                 "can only call functions and classes",
-                c.span,
+                span,
             )),
         }
     }
@@ -476,6 +534,7 @@ impl Interpreter {
 
     fn call_function(
         &mut self,
+        ast: &ExprArena,
         func: &Callable,
         args: Vec<Value>,
         call_site_span: crate::scanner::token::Span,
@@ -488,37 +547,61 @@ impl Interpreter {
                     line: self.offset_to_line(call_site_span.offset),
                 };
                 self.call_stack.push(frame);
+                let prev_tail = self.tail_calls_enabled;
+
+                // Trampoline: a `TailCall` thrown from the body swaps in the
+                // next function and arguments and re-enters the loop, so a
+                // chain of calls in tail position shares one Rust frame.
+                let mut next: Option<LoxFunction> = None;
+                let mut args = args;
+                let result = loop {
+                    let func = next.as_ref().unwrap_or(user_fn);
+                    self.tail_calls_enabled = !func.is_initializer;
+
+                    let env = Rc::new(RefCell::new(Environment::with_enclosing(Rc::clone(
+                        &func.closure,
+                    ))));
+                    for (param, arg) in func
+                        .declaration
+                        .params
+                        .iter()
+                        .zip(std::mem::take(&mut args))
+                    {
+                        env.borrow_mut().define(param.clone(), arg);
+                    }
 
-                let env = Rc::new(RefCell::new(Environment::with_enclosing(Rc::clone(
-                    &user_fn.closure,
-                ))));
-                for (param, arg) in user_fn.declaration.params.iter().zip(args) {
-                    env.borrow_mut().define(param.clone(), arg);
-                }
-
-                let result = self.execute_block(&user_fn.declaration.body, env);
+                    match self.execute_block(ast, &func.declaration.body, env) {
+                        Err(RuntimeError::TailCall {
+                            function,
+                            args: next_args,
+                        }) => {
+                            let frame = self.call_stack.last_mut().expect("frame pushed above");
+                            frame.function_name = function.declaration.name.clone();
+                            args = next_args;
+                            next = Some(*function);
+                        }
+                        other => break other,
+                    }
+                };
+                self.tail_calls_enabled = prev_tail;
+                // The last function to run determines the return semantics.
+                let func = next.as_ref().unwrap_or(user_fn);
 
                 match result {
                     Ok(()) => {
                         self.call_stack.pop();
-                        if user_fn.is_initializer {
-                            Ok(user_fn
-                                .closure
-                                .borrow()
-                                .get_at(0, "this")
-                                .expect("init closure has 'this'"))
+                        if func.is_initializer {
+                            // "this" is the sole entry (slot 0) of the bind scope.
+                            Ok(func.closure.borrow().get_at(0, 0))
                         } else {
                             Ok(Value::Nil)
                         }
                     }
                     Err(RuntimeError::Return { value }) => {
                         self.call_stack.pop();
-                        if user_fn.is_initializer {
-                            Ok(user_fn
-                                .closure
-                                .borrow()
-                                .get_at(0, "this")
-                                .expect("init closure has 'this'"))
+                        if func.is_initializer {
+                            // "this" is the sole entry (slot 0) of the bind scope.
+                            Ok(func.closure.borrow().get_at(0, 0))
                         } else {
                             Ok(value)
                         }
@@ -544,12 +627,8 @@ impl Interpreter {
         id: ExprId,
         span: crate::scanner::token::Span,
     ) -> Result<Value, RuntimeError> {
-        if let Some(&distance) = self.locals.get(&id) {
-            Ok(self
-                .environment
-                .borrow()
-                .get_at(distance, name)
-                .expect("resolver guarantees variable exists"))
+        if let Some(&local) = self.locals.get(&id) {
+            Ok(self.environment.borrow().get_at(local.distance, local.slot))
         } else {
             self.globals.borrow().get(name).ok_or_else(|| {
                 RuntimeError::with_span(format!("undefined variable '{name}'"), span)
@@ -793,4 +872,39 @@ mod tests {
             vec!["0", "1", "1", "2", "3", "5", "8", "13", "21", "34"]
         );
     }
+
+    #[test]
+    fn tail_recursion_runs_in_constant_stack() {
+        // 100k frames of ordinary recursion would overflow the Rust stack;
+        // the trampoline in call_function keeps tail calls flat.
+        let output = run("fun sum(n, acc) {
+                if (n == 0) return acc;
+                return sum(n - 1, acc + n);
+            }
+            print sum(100000, 0);");
+        assert_eq!(output, vec!["5000050000"]);
+    }
+
+    #[test]
+    fn mutual_tail_recursion() {
+        let output = run(
+            "fun isEven(n) { if (n == 0) return true; return isOdd(n - 1); }
+            fun isOdd(n) { if (n == 0) return false; return isEven(n - 1); }
+            print isEven(100001);",
+        );
+        assert_eq!(output, vec!["false"]);
+    }
+
+    #[test]
+    fn tail_call_to_native_returns_its_result() {
+        let output = run("fun now() { return clock(); } print now();");
+        assert_eq!(output.len(), 1);
+        assert!(output[0].parse::<f64>().is_ok());
+    }
+
+    #[test]
+    fn tail_call_wrong_arity_error() {
+        let err = run_err("fun f(a) { return a; } fun g() { return f(1, 2); } g();");
+        assert!(err.to_string().contains("expected 1 arguments but got 2"));
+    }
 }
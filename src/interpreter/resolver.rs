@@ -18,9 +18,19 @@ enum ClassType {
     Subclass,
 }
 
+/// Where the resolver found a local variable: how many environments up,
+/// and which slot within that environment's frame. Slots are assigned in
+/// declaration order, which matches runtime definition order.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct Local {
+    pub distance: usize,
+    pub slot: usize,
+}
+
 pub struct Resolver {
-    scopes: Vec<HashMap<String, bool>>,
-    locals: HashMap<ExprId, usize>,
+    /// One entry per declared name: `(name, defined)`, in slot order.
+    scopes: Vec<Vec<(String, bool)>>,
+    locals: HashMap<ExprId, Local>,
     current_function: FunctionType,
     current_class: ClassType,
     errors: Vec<CompileError>,
@@ -46,9 +56,9 @@ impl Resolver {
     pub fn resolve(
         mut self,
         program: &Program,
-    ) -> Result<HashMap<ExprId, usize>, Vec<CompileError>> {
+    ) -> Result<HashMap<ExprId, Local>, Vec<CompileError>> {
         for decl in &program.declarations {
-            self.resolve_decl(decl);
+            self.resolve_decl(&program.exprs, decl);
         }
         if self.errors.is_empty() {
             Ok(self.locals)
@@ -58,7 +68,7 @@ impl Resolver {
     }
 
     fn begin_scope(&mut self) {
-        self.scopes.push(HashMap::new());
+        self.scopes.push(Vec::new());
     }
 
     fn end_scope(&mut self) {
@@ -67,46 +77,51 @@ impl Resolver {
 
     fn declare(&mut self, name: &str, span: crate::scanner::token::Span) {
         if let Some(scope) = self.scopes.last_mut() {
-            if scope.contains_key(name) {
+            if scope.iter().any(|(declared, _)| declared == name) {
                 self.errors.push(CompileError::resolve(
                     format!("variable '{name}' already declared in this scope"),
                     span.offset,
                     span.len,
                 ));
             }
-            scope.insert(name.to_string(), false);
+            scope.push((name.to_string(), false));
         }
     }
 
     fn define(&mut self, name: &str) {
-        if let Some(scope) = self.scopes.last_mut() {
-            scope.insert(name.to_string(), true);
+        if let Some(scope) = self.scopes.last_mut()
+            && let Some(entry) = scope
+                .iter_mut()
+                .rev()
+                .find(|(declared, _)| declared == name)
+        {
+            entry.1 = true;
         }
     }
 
     fn resolve_local(&mut self, id: ExprId, name: &str) {
-        for (i, scope) in self.scopes.iter().rev().enumerate() {
-            if scope.contains_key(name) {
-                self.locals.insert(id, i);
+        for (distance, scope) in self.scopes.iter().rev().enumerate() {
+            if let Some(slot) = scope.iter().rposition(|(declared, _)| declared == name) {
+                self.locals.insert(id, Local { distance, slot });
                 return;
             }
         }
         // Not found in any scope: assume global
     }
 
-    fn resolve_decl(&mut self, decl: &Decl) {
+    fn resolve_decl(&mut self, ast: &ExprArena, decl: &Decl) {
         match decl {
             Decl::Var(v) => {
                 self.declare(&v.name, v.span);
-                if let Some(ref init) = v.initializer {
-                    self.resolve_expr(init);
+                if let Some(init) = v.initializer {
+                    self.resolve_expr(ast, init);
                 }
                 self.define(&v.name);
             }
             Decl::Fun(f) => {
                 self.declare(&f.function.name, f.span);
                 self.define(&f.function.name);
-                self.resolve_function(&f.function, FunctionType::Function);
+                self.resolve_function(ast, &f.function, FunctionType::Function);
             }
             Decl::Class(c) => {
                 let enclosing_class = self.current_class;
@@ -124,19 +139,22 @@ impl Resolver {
                         ));
                     }
                     self.current_class = ClassType::Subclass;
-                    self.resolve_local(0, superclass); // ID doesn't matter for superclass lookup
                     self.begin_scope();
+                    // "super" is the only entry in its scope, so it always
+                    // lands in slot 0 — mirrored by Interpreter::execute_class.
                     self.scopes
                         .last_mut()
                         .expect("just pushed scope")
-                        .insert("super".to_string(), true);
+                        .push(("super".to_string(), true));
                 }
 
                 self.begin_scope();
+                // "this" is the only entry in its scope, so it always lands
+                // in slot 0 — mirrored by Callable::bind.
                 self.scopes
                     .last_mut()
                     .expect("just pushed scope")
-                    .insert("this".to_string(), true);
+                    .push(("this".to_string(), true));
 
                 for method in &c.methods {
                     let func_type = if method.name == "init" {
@@ -144,7 +162,7 @@ impl Resolver {
                     } else {
                         FunctionType::Method
                     };
-                    self.resolve_function(method, func_type);
+                    self.resolve_function(ast, method, func_type);
                 }
 
                 self.end_scope();
@@ -153,11 +171,11 @@ impl Resolver {
                 }
                 self.current_class = enclosing_class;
             }
-            Decl::Statement(s) => self.resolve_stmt(s),
+            Decl::Statement(s) => self.resolve_stmt(ast, s),
         }
     }
 
-    fn resolve_function(&mut self, function: &Function, func_type: FunctionType) {
+    fn resolve_function(&mut self, ast: &ExprArena, function: &Function, func_type: FunctionType) {
         let enclosing = self.current_function;
         self.current_function = func_type;
         self.begin_scope();
@@ -166,16 +184,16 @@ impl Resolver {
             self.define(param);
         }
         for decl in &function.body {
-            self.resolve_decl(decl);
+            self.resolve_decl(ast, decl);
         }
         self.end_scope();
         self.current_function = enclosing;
     }
 
-    fn resolve_stmt(&mut self, stmt: &Stmt) {
+    fn resolve_stmt(&mut self, ast: &ExprArena, stmt: &Stmt) {
         match stmt {
-            Stmt::Expression(e) => self.resolve_expr(&e.expression),
-            Stmt::Print(p) => self.resolve_expr(&p.expression),
+            Stmt::Expression(e) => self.resolve_expr(ast, e.expression),
+            Stmt::Print(p) => self.resolve_expr(ast, p.expression),
             Stmt::Return(r) => {
                 if self.current_function == FunctionType::None {
                     self.errors.push(CompileError::resolve(
@@ -184,7 +202,7 @@ impl Resolver {
                         r.span.len,
                     ));
                 }
-                if let Some(ref val) = r.value {
+                if let Some(val) = r.value {
                     if self.current_function == FunctionType::Initializer {
                         self.errors.push(CompileError::resolve(
                             "can't return a value from an initializer",
@@ -192,35 +210,39 @@ impl Resolver {
                             r.span.len,
                         ));
                     }
-                    self.resolve_expr(val);
+                    self.resolve_expr(ast, val);
                 }
             }
             Stmt::Block(b) => {
                 self.begin_scope();
                 for decl in &b.declarations {
-                    self.resolve_decl(decl);
+                    self.resolve_decl(ast, decl);
                 }
                 self.end_scope();
             }
             Stmt::If(i) => {
-                self.resolve_expr(&i.condition);
-                self.resolve_stmt(&i.then_branch);
+                self.resolve_expr(ast, i.condition);
+                self.resolve_stmt(ast, &i.then_branch);
                 if let Some(ref else_branch) = i.else_branch {
-                    self.resolve_stmt(else_branch);
+                    self.resolve_stmt(ast, else_branch);
                 }
             }
             Stmt::While(w) => {
-                self.resolve_expr(&w.condition);
-                self.resolve_stmt(&w.body);
+                self.resolve_expr(ast, w.condition);
+                self.resolve_stmt(ast, &w.body);
             }
         }
     }
 
-    fn resolve_expr(&mut self, expr: &Expr) {
-        match expr {
+    fn resolve_expr(&mut self, ast: &ExprArena, id: ExprId) {
+        match ast.get(id) {
             Expr::Variable(v) => {
                 if let Some(scope) = self.scopes.last()
-                    && scope.get(&v.name) == Some(&false)
+                    && scope
+                        .iter()
+                        .rev()
+                        .find(|(declared, _)| *declared == v.name)
+                        .is_some_and(|&(_, defined)| !defined)
                 {
                     self.errors.push(CompileError::resolve(
                         "can't read local variable in its own initializer",
@@ -231,35 +253,35 @@ impl Resolver {
                 self.resolve_local(v.id, &v.name);
             }
             Expr::Assign(a) => {
-                self.resolve_expr(&a.value);
+                self.resolve_expr(ast, a.value);
                 self.resolve_local(a.id, &a.name);
             }
             Expr::Binary(b) => {
-                self.resolve_expr(&b.left);
-                self.resolve_expr(&b.right);
+                self.resolve_expr(ast, b.left);
+                self.resolve_expr(ast, b.right);
             }
             Expr::Unary(u) => {
-                self.resolve_expr(&u.operand);
+                self.resolve_expr(ast, u.operand);
             }
             Expr::Logical(l) => {
-                self.resolve_expr(&l.left);
-                self.resolve_expr(&l.right);
+                self.resolve_expr(ast, l.left);
+                self.resolve_expr(ast, l.right);
             }
             Expr::Call(c) => {
-                self.resolve_expr(&c.callee);
-                for arg in &c.arguments {
-                    self.resolve_expr(arg);
+                self.resolve_expr(ast, c.callee);
+                for &arg in &c.arguments {
+                    self.resolve_expr(ast, arg);
                 }
             }
             Expr::Get(g) => {
-                self.resolve_expr(&g.object);
+                self.resolve_expr(ast, g.object);
             }
             Expr::Set(s) => {
-                self.resolve_expr(&s.value);
-                self.resolve_expr(&s.object);
+                self.resolve_expr(ast, s.value);
+                self.resolve_expr(ast, s.object);
             }
             Expr::Grouping(g) => {
-                self.resolve_expr(&g.expression);
+                self.resolve_expr(ast, g.expression);
             }
             Expr::This(t) => {
                 if self.current_class == ClassType::None {
@@ -1,5 +1,5 @@
 use std::cell::RefCell;
-use std::collections::HashMap;
+use std::collections::{HashMap, HashSet};
 use std::fmt;
 use std::rc::Rc;
 
@@ -8,7 +8,7 @@ use crate::interpreter::callable::Callable;
 #[derive(Clone, Debug)]
 pub enum Value {
     Number(f64),
-    Str(String),
+    Str(Rc<str>),
     Bool(bool),
     Nil,
     Function(Callable),
@@ -30,7 +30,9 @@ impl Value {
             (Self::Nil, Self::Nil) => true,
             (Self::Bool(a), Self::Bool(b)) => a == b,
             (Self::Number(a), Self::Number(b)) => a == b,
-            (Self::Str(a), Self::Str(b)) => a == b,
+            // Interned strings share an allocation, so pointer identity
+            // usually settles equality without comparing bytes.
+            (Self::Str(a), Self::Str(b)) => Rc::ptr_eq(a, b) || a == b,
             _ => false,
         }
     }
@@ -112,3 +114,47 @@ impl fmt::Display for LoxInstance {
         write!(f, "{} instance", self.class.name)
     }
 }
+
+/// Interns strings so repeated literals share one allocation. Cloning a
+/// `Value::Str` is then a refcount bump rather than a heap copy, and
+/// equality between interned strings short-circuits on pointer identity.
+///
+/// Only source literals are interned; computed strings (concatenation,
+/// `readLine`) get a plain `Rc<str>` so the table doesn't grow without
+/// bound over a long-running program.
+#[derive(Debug, Default)]
+pub struct Interner {
+    strings: HashSet<Rc<str>>,
+}
+
+impl Interner {
+    pub fn intern(&mut self, s: &str) -> Rc<str> {
+        if let Some(existing) = self.strings.get(s) {
+            return Rc::clone(existing);
+        }
+        let interned: Rc<str> = Rc::from(s);
+        self.strings.insert(Rc::clone(&interned));
+        interned
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn intern_returns_shared_allocation() {
+        let mut interner = Interner::default();
+        let a = interner.intern("hello");
+        let b = interner.intern("hello");
+        assert!(Rc::ptr_eq(&a, &b));
+    }
+
+    #[test]
+    fn interned_and_computed_strings_compare_equal() {
+        let mut interner = Interner::default();
+        let interned = Value::Str(interner.intern("ab"));
+        let computed = Value::Str(Rc::from(format!("{}{}", "a", "b")));
+        assert!(interned.is_equal(&computed));
+    }
+}
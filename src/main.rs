@@ -1,4 +1,4 @@
-use std::path::PathBuf;
+use std::path::{Path, PathBuf};
 
 use anyhow::{Context, Result, bail};
 use clap::{CommandFactory, Parser};
@@ -8,7 +8,7 @@ use vibe_lox::interpreter::Interpreter;
 use vibe_lox::interpreter::resolver::Resolver;
 use vibe_lox::parser::Parser as LoxParser;
 use vibe_lox::scanner;
-use vibe_lox::vm::chunk;
+use vibe_lox::vm::{blox, chunk};
 
 #[derive(Parser, Debug)]
 #[command(name = "vibe-lox", about = "A Lox language interpreter and compiler")]
@@ -44,6 +44,16 @@ struct Cli {
     #[arg(short = 'o', long = "output")]
     output: Option<PathBuf>,
 
+    /// Compile every .lox file under a directory in parallel
+    /// (with --compile-bytecode or --compile-llvm; outputs are derived per file)
+    #[arg(long, value_name = "DIR", conflicts_with = "file")]
+    batch: Option<PathBuf>,
+
+    /// LLVM optimization level for --compile / --compile-llvm
+    /// (default: 2 for --compile, 0 for --compile-llvm)
+    #[arg(short = 'O', value_name = "LEVEL", value_parser = clap::value_parser!(u8).range(0..=2))]
+    opt_level: Option<u8>,
+
     /// Suppress informational output
     #[arg(short = 'q')]
     quiet: bool,
@@ -51,6 +61,10 @@ struct Cli {
     /// Disassemble bytecode (from source or saved file) and print
     #[arg(long)]
     disassemble: bool,
+
+    /// Run via the bytecode VM with profiling and print a report at exit
+    #[arg(long, conflicts_with_all = ["compile", "compile_llvm", "compile_bytecode", "disassemble", "dump_tokens", "dump_ast"])]
+    profile: bool,
 }
 
 fn read_source(cli: &Cli) -> Result<String> {
@@ -89,52 +103,30 @@ fn run_source(source: &str, filename: &str) -> Result<()> {
     Ok(())
 }
 
-/// Magic number at the start of every `.blox` file: ASCII "blox"
-const BLOX_MAGIC: &[u8; 4] = b"blox";
-
-fn save_chunk(compiled: &chunk::Chunk, path: &PathBuf) -> Result<()> {
-    let payload = rmp_serde::to_vec(compiled).context("serialize bytecode to MessagePack")?;
-    let mut bytes = Vec::with_capacity(BLOX_MAGIC.len() + payload.len());
-    bytes.extend_from_slice(BLOX_MAGIC);
-    bytes.extend_from_slice(&payload);
-    std::fs::write(path, bytes).with_context(|| format!("write bytecode to '{}'", path.display()))
-}
-
-fn load_chunk(path: &PathBuf) -> Result<chunk::Chunk> {
-    let bytes =
-        std::fs::read(path).with_context(|| format!("read bytecode from '{}'", path.display()))?;
-    if bytes.len() < BLOX_MAGIC.len() || &bytes[..BLOX_MAGIC.len()] != BLOX_MAGIC {
-        bail!(
-            "'{}' is not a valid .blox file (missing magic header)",
-            path.display()
-        );
-    }
-    rmp_serde::from_slice(&bytes[BLOX_MAGIC.len()..])
-        .context("deserialize bytecode from MessagePack")
-}
-
-fn is_bytecode_file(path: &PathBuf) -> Result<bool> {
-    let file =
-        std::fs::File::open(path).with_context(|| format!("open file '{}'", path.display()))?;
-    let mut header = [0u8; 4];
-    use std::io::Read;
-    match file.take(4).read(&mut header) {
-        Ok(4) => Ok(&header == BLOX_MAGIC),
-        _ => Ok(false),
-    }
-}
-
 fn report_compile_errors(
     errors: Vec<vibe_lox::error::CompileError>,
     filename: &str,
     source: &str,
 ) -> anyhow::Error {
     let count = errors.len();
+    eprint!("{}", render_compile_errors(errors, filename, source));
+    anyhow::anyhow!("{} compile error(s)", count)
+}
+
+fn render_compile_errors(
+    errors: Vec<vibe_lox::error::CompileError>,
+    filename: &str,
+    source: &str,
+) -> String {
+    use std::fmt::Write;
+
+    let mut rendered = String::new();
     for error in errors {
         let error_with_src = error.with_source_code(filename, source);
-        eprintln!("{:?}", miette::Report::new(error_with_src));
+        writeln!(rendered, "{:?}", miette::Report::new(error_with_src))
+            .expect("writing to a String cannot fail");
     }
-    anyhow::anyhow!("{} compile error(s)", count)
+    rendered
 }
 
 fn report_runtime_error(
@@ -165,6 +157,135 @@ fn report_runtime_error(
     anyhow::anyhow!("execution failed")
 }
 
+/// Compile every `.lox` file under `dir` in parallel across cores.
+///
+/// Workers pull file indices from a shared atomic counter, so a handful of
+/// slow files cannot leave the other cores idle behind a static split. Each
+/// `--compile-llvm` worker creates a single LLVM context up front and reuses
+/// it for every file it compiles. Failures are collected and reported after
+/// the pool drains, keeping per-file diagnostics from interleaving.
+fn run_batch(cli: &Cli, dir: &Path) -> Result<()> {
+    use std::sync::Mutex;
+    use std::sync::atomic::{AtomicUsize, Ordering};
+
+    let files = collect_lox_files(dir)
+        .with_context(|| format!("scan batch directory '{}'", dir.display()))?;
+    if files.is_empty() {
+        bail!("no .lox files found under '{}'", dir.display());
+    }
+
+    let workers = std::thread::available_parallelism()
+        .map(std::num::NonZero::get)
+        .unwrap_or(1)
+        .min(files.len());
+    let next = AtomicUsize::new(0);
+    let failures = Mutex::new(Vec::new());
+
+    std::thread::scope(|scope| {
+        for _ in 0..workers {
+            scope.spawn(|| {
+                // One context per worker: LLVM contexts are not thread-safe,
+                // but creating one per file would waste most of the batch win.
+                let context = cli.compile_llvm.then(inkwell::context::Context::create);
+                loop {
+                    let index = next.fetch_add(1, Ordering::Relaxed);
+                    let Some(path) = files.get(index) else {
+                        break;
+                    };
+                    if let Err(rendered) = compile_batch_file(cli, path, context.as_ref()) {
+                        failures
+                            .lock()
+                            .expect("a worker panicking would abort the batch")
+                            .push((path, rendered));
+                    }
+                }
+            });
+        }
+    });
+
+    let mut failures = failures
+        .into_inner()
+        .expect("all workers have finished with the failure list");
+    failures.sort_by(|a, b| a.0.cmp(b.0));
+    for (path, rendered) in &failures {
+        eprintln!("{}:", path.display());
+        eprint!("{rendered}");
+    }
+    if !cli.quiet {
+        println!(
+            "Compiled {} of {} files ({} workers)",
+            files.len() - failures.len(),
+            files.len(),
+            workers
+        );
+    }
+    if !failures.is_empty() {
+        bail!(
+            "{} of {} files failed to compile",
+            failures.len(),
+            files.len()
+        );
+    }
+    Ok(())
+}
+
+/// Recursively collect `.lox` files under `dir`, sorted for deterministic
+/// scheduling and reporting.
+fn collect_lox_files(dir: &Path) -> Result<Vec<PathBuf>> {
+    let mut files = Vec::new();
+    let mut pending = vec![dir.to_path_buf()];
+    while let Some(dir) = pending.pop() {
+        let entries = std::fs::read_dir(&dir)
+            .with_context(|| format!("read directory '{}'", dir.display()))?;
+        for entry in entries {
+            let path = entry
+                .with_context(|| format!("read directory entry in '{}'", dir.display()))?
+                .path();
+            if path.is_dir() {
+                pending.push(path);
+            } else if path.extension().is_some_and(|ext| ext == "lox") {
+                files.push(path);
+            }
+        }
+    }
+    files.sort();
+    Ok(files)
+}
+
+/// Compile one file of a batch; errors come back pre-rendered so the caller
+/// can print them without holding sources alive across the pool.
+fn compile_batch_file(
+    cli: &Cli,
+    path: &Path,
+    context: Option<&inkwell::context::Context>,
+) -> Result<(), String> {
+    let source = std::fs::read_to_string(path).map_err(|e| format!("read source file: {e}\n"))?;
+    let filename = path.display().to_string();
+
+    if cli.compile_llvm {
+        let tokens =
+            scanner::scan(&source).map_err(|e| render_compile_errors(e, &filename, &source))?;
+        let program = LoxParser::new(tokens)
+            .parse()
+            .map_err(|e| render_compile_errors(e, &filename, &source))?;
+        let level = vibe_lox::codegen::OptLevel::from_flag(cli.opt_level.unwrap_or(0));
+        let context = context.expect("--compile-llvm workers create a context up front");
+        let module = vibe_lox::codegen::compile_to_module(context, &program, &source)
+            .map_err(|e| format!("compile to LLVM module: {e:#}\n"))?;
+        vibe_lox::codegen::optimize_module(&module, level)
+            .map_err(|e| format!("optimize LLVM module: {e:#}\n"))?;
+        let ir = module.print_to_string().to_string();
+        let output_path = path.with_extension("ll");
+        std::fs::write(&output_path, &ir)
+            .map_err(|e| format!("write LLVM IR to '{}': {e}\n", output_path.display()))?;
+    } else {
+        let compiled = vibe_lox::vm::compile_to_chunk(&source)
+            .map_err(|e| render_compile_errors(vec![e], &filename, &source))?;
+        blox::save(&compiled, &path.with_extension("blox")).map_err(|e| format!("{e:#}\n"))?;
+    }
+    Ok(())
+}
+
 fn main() -> Result<()> {
     let cli = Cli::parse();
 
@@ -182,6 +303,20 @@ fn main() -> Result<()> {
         bail!("--output/-o can only be used with --compile-bytecode, --compile-llvm, or --compile");
     }
 
+    if cli.opt_level.is_some() && !cli.compile_llvm && !cli.compile {
+        bail!("-O can only be used with --compile or --compile-llvm");
+    }
+
+    if let Some(ref dir) = cli.batch {
+        if !cli.compile_bytecode && !cli.compile_llvm {
+            bail!("--batch requires --compile-bytecode or --compile-llvm");
+        }
+        if cli.output.is_some() {
+            bail!("--output/-o cannot be used with --batch; outputs are derived per file");
+        }
+        return run_batch(&cli, dir);
+    }
+
     if cli.dump_tokens {
         let source = read_source(&cli)?;
         let filename = get_filename(&cli);
@@ -215,9 +350,9 @@ fn main() -> Result<()> {
     if cli.disassemble {
         // autodetect whether input is bytecode or source
         if let Some(ref path) = cli.file
-            && is_bytecode_file(path)?
+            && blox::is_bytecode_file(path)?
         {
-            let compiled = load_chunk(path)?;
+            let compiled = blox::load(path)?;
             print!(
                 "{}",
                 chunk::disassemble(&compiled, &path.display().to_string())
@@ -252,7 +387,7 @@ fn main() -> Result<()> {
             .unwrap_or_else(|| input_path.with_extension("blox"));
         let source = read_source(&cli)?;
         let compiled = compile_source(&source)?;
-        save_chunk(&compiled, &output_path)?;
+        blox::save(&compiled, &output_path)?;
         if !cli.quiet {
             println!("Wrote bytecode to {}", output_path.display());
         }
@@ -264,7 +399,7 @@ fn main() -> Result<()> {
             .file
             .as_ref()
             .context("--compile requires an input file")?;
-        if is_bytecode_file(input_path)? {
+        if blox::is_bytecode_file(input_path)? {
             bail!("cannot compile .blox bytecode to a native executable; use a .lox source file");
         }
         let output_path = cli.output.clone().unwrap_or_else(|| {
@@ -278,10 +413,11 @@ fn main() -> Result<()> {
         let program = LoxParser::new(tokens)
             .parse()
             .map_err(|e| report_compile_errors(e, &filename, &source))?;
+        let level = vibe_lox::codegen::OptLevel::from_flag(cli.opt_level.unwrap_or(2));
         let context = inkwell::context::Context::create();
         let module = vibe_lox::codegen::compile_to_module(&context, &program, &source)
             .context("compile to LLVM module")?;
-        vibe_lox::codegen::native::compile_to_executable(&module, &output_path)
+        vibe_lox::codegen::native::compile_to_executable(&module, &output_path, level)
             .context("compile to native executable")?;
         if !cli.quiet {
             println!("Compiled native executable: {}", output_path.display());
@@ -305,7 +441,14 @@ fn main() -> Result<()> {
         let program = LoxParser::new(tokens)
             .parse()
             .map_err(|e| report_compile_errors(e, &filename, &source))?;
-        let ir = vibe_lox::codegen::compile(&program, &source).context("compile to LLVM IR")?;
+        // -O0 by default so the written IR stays readable; pass -O1/-O2 to
+        // see (or execute) the optimized module.
+        let level = vibe_lox::codegen::OptLevel::from_flag(cli.opt_level.unwrap_or(0));
+        let context = inkwell::context::Context::create();
+        let module = vibe_lox::codegen::compile_to_module(&context, &program, &source)
+            .context("compile to LLVM module")?;
+        vibe_lox::codegen::optimize_module(&module, level).context("optimize LLVM module")?;
+        let ir = module.print_to_string().to_string();
         std::fs::write(&output_path, &ir)
             .with_context(|| format!("write LLVM IR to '{}'", output_path.display()))?;
         if !cli.quiet {
@@ -314,14 +457,42 @@ fn main() -> Result<()> {
         return Ok(());
     }
 
+    // Profiling always runs via the VM (the profiler hooks live in its
+    // dispatch loop), whether the input is source or saved bytecode.
+    if cli.profile {
+        let path = cli
+            .file
+            .as_ref()
+            .context("--profile requires an input file")?;
+        let compiled = if blox::is_bytecode_file(path)? {
+            blox::load(path)?
+        } else {
+            let source = read_source(&cli)?;
+            compile_source(&source)?
+        };
+        let mut vm = vibe_lox::vm::vm::Vm::new();
+        vm.enable_profiler();
+        let result = vm
+            .interpret(compiled)
+            .map_err(|e| report_runtime_error(&e, None));
+        // Report even after a runtime error: a profile of the run so far
+        // is usually still what the user came for.
+        eprint!(
+            "{}",
+            vm.profile_report()
+                .expect("profiler enabled before the run")
+        );
+        return result;
+    }
+
     match cli.file {
         Some(ref path) => {
             // Autodetect: if the file starts with the "blox" magic, run via VM
-            if is_bytecode_file(path)? {
+            if blox::is_bytecode_file(path)? {
                 if !cli.quiet {
                     println!("Running VM for {}", path.display());
                 }
-                let compiled = load_chunk(path)?;
+                let compiled = blox::load(path)?;
                 let mut vm = vibe_lox::vm::vm::Vm::new();
                 vm.interpret(compiled)
                     .map_err(|e| report_runtime_error(&e, None))?;
@@ -1,27 +1,31 @@
-use std::sync::atomic::{AtomicUsize, Ordering};
-
 use crate::ast::*;
 use crate::error::CompileError;
 use crate::scanner::token::{Span, Token, TokenKind};
 
-static NEXT_EXPR_ID: AtomicUsize = AtomicUsize::new(0);
-
-fn next_id() -> ExprId {
-    NEXT_EXPR_ID.fetch_add(1, Ordering::Relaxed)
-}
-
-pub struct Parser {
-    tokens: Vec<Token>,
+/// Recursive descent parser over tokens borrowing source with lifetime `'s`.
+/// The produced AST owns its strings, so it is independent of the source
+/// buffer once `parse` returns.
+pub struct Parser<'s> {
+    tokens: Vec<Token<'s>>,
     current: usize,
     errors: Vec<CompileError>,
+    arena: ExprArena,
 }
 
-impl Parser {
-    pub fn new(tokens: Vec<Token>) -> Self {
+impl<'s> Parser<'s> {
+    pub fn new(tokens: Vec<Token<'s>>) -> Self {
+        Self::with_arena(tokens, ExprArena::new())
+    }
+
+    /// Parse into an existing arena, continuing its id sequence. The REPL
+    /// uses this so expression ids stay unique across lines and earlier
+    /// definitions keep resolving into the grown arena.
+    pub fn with_arena(tokens: Vec<Token<'s>>, arena: ExprArena) -> Self {
         Self {
             tokens,
             current: 0,
             errors: Vec::new(),
+            arena,
         }
     }
 
@@ -37,12 +41,19 @@ impl Parser {
             }
         }
         if self.errors.is_empty() {
-            Ok(Program { declarations })
+            Ok(Program {
+                declarations,
+                exprs: self.arena,
+            })
         } else {
             Err(self.errors)
         }
     }
 
+    fn expr_span(&self, id: ExprId) -> Span {
+        self.arena.get(id).span()
+    }
+
     fn declaration(&mut self) -> Result<Decl, CompileError> {
         if self.check(TokenKind::Class) {
             self.class_declaration()
@@ -268,7 +279,7 @@ impl Parser {
         } else {
             let expr = self.expression()?;
             self.consume(TokenKind::Semicolon, "';' after for initializer")?;
-            let span = expr.span();
+            let span = self.expr_span(expr);
             Some(Decl::Statement(Stmt::Expression(ExprStmt {
                 expression: expr,
                 span,
@@ -278,10 +289,13 @@ impl Parser {
         let condition = if !self.check(TokenKind::Semicolon) {
             self.expression()?
         } else {
-            Expr::Literal(LiteralExpr {
-                id: next_id(),
-                value: LiteralValue::Bool(true),
-                span: self.current_span(),
+            let span = self.current_span();
+            self.arena.alloc(|id| {
+                Expr::Literal(LiteralExpr {
+                    id,
+                    value: LiteralValue::Bool(true),
+                    span,
+                })
             })
         };
         self.consume(TokenKind::Semicolon, "';' after for condition")?;
@@ -297,7 +311,7 @@ impl Parser {
 
         // Append increment to body
         if let Some(inc) = increment {
-            let inc_span = inc.span();
+            let inc_span = self.expr_span(inc);
             body = Stmt::Block(BlockStmt {
                 declarations: vec![
                     Decl::Statement(body),
@@ -333,40 +347,48 @@ impl Parser {
     fn expression_statement(&mut self) -> Result<Stmt, CompileError> {
         let expression = self.expression()?;
         self.consume(TokenKind::Semicolon, "';' after expression")?;
-        let span = expression.span();
+        let span = self.expr_span(expression);
         Ok(Stmt::Expression(ExprStmt { expression, span }))
     }
 
-    fn expression(&mut self) -> Result<Expr, CompileError> {
+    fn expression(&mut self) -> Result<ExprId, CompileError> {
         self.assignment()
     }
 
-    fn assignment(&mut self) -> Result<Expr, CompileError> {
+    fn assignment(&mut self) -> Result<ExprId, CompileError> {
         let expr = self.or()?;
 
         if self.match_token(TokenKind::Equal) {
             let value = self.assignment()?;
+            let expr_span = self.expr_span(expr);
+            let value_span = self.expr_span(value);
             let span = Span::new(
-                expr.span().offset,
-                value.span().offset + value.span().len - expr.span().offset,
+                expr_span.offset,
+                value_span.offset + value_span.len - expr_span.offset,
             );
 
-            match expr {
+            // The target node stays in the arena unused; only its pieces
+            // move into the new Assign/Set node.
+            match self.arena.get(expr).clone() {
                 Expr::Variable(v) => {
-                    return Ok(Expr::Assign(AssignExpr {
-                        id: next_id(),
-                        name: v.name,
-                        value: Box::new(value),
-                        span,
+                    return Ok(self.arena.alloc(|id| {
+                        Expr::Assign(AssignExpr {
+                            id,
+                            name: v.name,
+                            value,
+                            span,
+                        })
                     }));
                 }
                 Expr::Get(g) => {
-                    return Ok(Expr::Set(SetExpr {
-                        id: next_id(),
-                        object: g.object,
-                        name: g.name,
-                        value: Box::new(value),
-                        span,
+                    return Ok(self.arena.alloc(|id| {
+                        Expr::Set(SetExpr {
+                            id,
+                            object: g.object,
+                            name: g.name,
+                            value,
+                            span,
+                        })
                     }));
                 }
                 _ => {
@@ -382,64 +404,52 @@ impl Parser {
         Ok(expr)
     }
 
-    fn or(&mut self) -> Result<Expr, CompileError> {
+    fn or(&mut self) -> Result<ExprId, CompileError> {
         let mut expr = self.and()?;
         while self.match_token(TokenKind::Or) {
             let right = self.and()?;
-            let span = Span::new(
-                expr.span().offset,
-                right.span().offset + right.span().len - expr.span().offset,
-            );
-            expr = Expr::Logical(LogicalExpr {
-                id: next_id(),
-                left: Box::new(expr),
-                operator: LogicalOp::Or,
-                right: Box::new(right),
-                span,
+            let span = self.binary_span(expr, right);
+            expr = self.arena.alloc(|id| {
+                Expr::Logical(LogicalExpr {
+                    id,
+                    left: expr,
+                    operator: LogicalOp::Or,
+                    right,
+                    span,
+                })
             });
         }
         Ok(expr)
     }
 
-    fn and(&mut self) -> Result<Expr, CompileError> {
+    fn and(&mut self) -> Result<ExprId, CompileError> {
         let mut expr = self.equality()?;
         while self.match_token(TokenKind::And) {
             let right = self.equality()?;
-            let span = Span::new(
-                expr.span().offset,
-                right.span().offset + right.span().len - expr.span().offset,
-            );
-            expr = Expr::Logical(LogicalExpr {
-                id: next_id(),
-                left: Box::new(expr),
-                operator: LogicalOp::And,
-                right: Box::new(right),
-                span,
+            let span = self.binary_span(expr, right);
+            expr = self.arena.alloc(|id| {
+                Expr::Logical(LogicalExpr {
+                    id,
+                    left: expr,
+                    operator: LogicalOp::And,
+                    right,
+                    span,
+                })
             });
         }
         Ok(expr)
     }
 
-    fn equality(&mut self) -> Result<Expr, CompileError> {
+    fn equality(&mut self) -> Result<ExprId, CompileError> {
         let mut expr = self.comparison()?;
         while let Some(op) = self.match_binary_op(&[TokenKind::EqualEqual, TokenKind::BangEqual]) {
             let right = self.comparison()?;
-            let span = Span::new(
-                expr.span().offset,
-                right.span().offset + right.span().len - expr.span().offset,
-            );
-            expr = Expr::Binary(BinaryExpr {
-                id: next_id(),
-                left: Box::new(expr),
-                operator: op,
-                right: Box::new(right),
-                span,
-            });
+            expr = self.alloc_binary(expr, op, right);
         }
         Ok(expr)
     }
 
-    fn comparison(&mut self) -> Result<Expr, CompileError> {
+    fn comparison(&mut self) -> Result<ExprId, CompileError> {
         let mut expr = self.term()?;
         while let Some(op) = self.match_binary_op(&[
             TokenKind::Greater,
@@ -448,60 +458,53 @@ impl Parser {
             TokenKind::LessEqual,
         ]) {
             let right = self.term()?;
-            let span = Span::new(
-                expr.span().offset,
-                right.span().offset + right.span().len - expr.span().offset,
-            );
-            expr = Expr::Binary(BinaryExpr {
-                id: next_id(),
-                left: Box::new(expr),
-                operator: op,
-                right: Box::new(right),
-                span,
-            });
+            expr = self.alloc_binary(expr, op, right);
         }
         Ok(expr)
     }
 
-    fn term(&mut self) -> Result<Expr, CompileError> {
+    fn term(&mut self) -> Result<ExprId, CompileError> {
         let mut expr = self.factor()?;
         while let Some(op) = self.match_binary_op(&[TokenKind::Plus, TokenKind::Minus]) {
             let right = self.factor()?;
-            let span = Span::new(
-                expr.span().offset,
-                right.span().offset + right.span().len - expr.span().offset,
-            );
-            expr = Expr::Binary(BinaryExpr {
-                id: next_id(),
-                left: Box::new(expr),
-                operator: op,
-                right: Box::new(right),
-                span,
-            });
+            expr = self.alloc_binary(expr, op, right);
         }
         Ok(expr)
     }
 
-    fn factor(&mut self) -> Result<Expr, CompileError> {
+    fn factor(&mut self) -> Result<ExprId, CompileError> {
         let mut expr = self.unary()?;
         while let Some(op) = self.match_binary_op(&[TokenKind::Star, TokenKind::Slash]) {
             let right = self.unary()?;
-            let span = Span::new(
-                expr.span().offset,
-                right.span().offset + right.span().len - expr.span().offset,
-            );
-            expr = Expr::Binary(BinaryExpr {
-                id: next_id(),
-                left: Box::new(expr),
-                operator: op,
-                right: Box::new(right),
-                span,
-            });
+            expr = self.alloc_binary(expr, op, right);
         }
         Ok(expr)
     }
 
-    fn unary(&mut self) -> Result<Expr, CompileError> {
+    /// Span covering both operands of a binary/logical expression.
+    fn binary_span(&self, left: ExprId, right: ExprId) -> Span {
+        let left_span = self.expr_span(left);
+        let right_span = self.expr_span(right);
+        Span::new(
+            left_span.offset,
+            right_span.offset + right_span.len - left_span.offset,
+        )
+    }
+
+    fn alloc_binary(&mut self, left: ExprId, operator: BinaryOp, right: ExprId) -> ExprId {
+        let span = self.binary_span(left, right);
+        self.arena.alloc(|id| {
+            Expr::Binary(BinaryExpr {
+                id,
+                left,
+                operator,
+                right,
+                span,
+            })
+        })
+    }
+
+    fn unary(&mut self) -> Result<ExprId, CompileError> {
         if self.check(TokenKind::Bang) || self.check(TokenKind::Minus) {
             let start = self.current_span();
             let op = if self.match_token(TokenKind::Bang) {
@@ -511,21 +514,24 @@ impl Parser {
                 UnaryOp::Negate
             };
             let operand = self.unary()?;
+            let operand_span = self.expr_span(operand);
             let span = Span::new(
                 start.offset,
-                operand.span().offset + operand.span().len - start.offset,
+                operand_span.offset + operand_span.len - start.offset,
             );
-            return Ok(Expr::Unary(UnaryExpr {
-                id: next_id(),
-                operator: op,
-                operand: Box::new(operand),
-                span,
+            return Ok(self.arena.alloc(|id| {
+                Expr::Unary(UnaryExpr {
+                    id,
+                    operator: op,
+                    operand,
+                    span,
+                })
             }));
         }
         self.call()
     }
 
-    fn call(&mut self) -> Result<Expr, CompileError> {
+    fn call(&mut self) -> Result<ExprId, CompileError> {
         let mut expr = self.primary()?;
 
         loop {
@@ -533,15 +539,18 @@ impl Parser {
                 expr = self.finish_call(expr)?;
             } else if self.match_token(TokenKind::Dot) {
                 let name = self.expect_identifier("property name")?;
+                let expr_span = self.expr_span(expr);
                 let span = Span::new(
-                    expr.span().offset,
-                    self.previous_span().offset + self.previous_span().len - expr.span().offset,
+                    expr_span.offset,
+                    self.previous_span().offset + self.previous_span().len - expr_span.offset,
                 );
-                expr = Expr::Get(GetExpr {
-                    id: next_id(),
-                    object: Box::new(expr),
-                    name,
-                    span,
+                expr = self.arena.alloc(|id| {
+                    Expr::Get(GetExpr {
+                        id,
+                        object: expr,
+                        name,
+                        span,
+                    })
                 });
             } else {
                 break;
@@ -551,7 +560,7 @@ impl Parser {
         Ok(expr)
     }
 
-    fn finish_call(&mut self, callee: Expr) -> Result<Expr, CompileError> {
+    fn finish_call(&mut self, callee: ExprId) -> Result<ExprId, CompileError> {
         let mut arguments = Vec::new();
         if !self.check(TokenKind::RightParen) {
             loop {
@@ -570,19 +579,22 @@ impl Parser {
             }
         }
         self.consume(TokenKind::RightParen, "')' after arguments")?;
+        let callee_span = self.expr_span(callee);
         let span = Span::new(
-            callee.span().offset,
-            self.previous_span().offset + self.previous_span().len - callee.span().offset,
+            callee_span.offset,
+            self.previous_span().offset + self.previous_span().len - callee_span.offset,
         );
-        Ok(Expr::Call(CallExpr {
-            id: next_id(),
-            callee: Box::new(callee),
-            arguments,
-            span,
+        Ok(self.arena.alloc(|id| {
+            Expr::Call(CallExpr {
+                id,
+                callee,
+                arguments,
+                span,
+            })
         }))
     }
 
-    fn primary(&mut self) -> Result<Expr, CompileError> {
+    fn primary(&mut self) -> Result<ExprId, CompileError> {
         let token = self.peek().clone();
         match token.kind {
             TokenKind::Number => {
@@ -591,49 +603,61 @@ impl Parser {
                     .lexeme
                     .parse()
                     .expect("scanner guarantees valid number");
-                Ok(Expr::Literal(LiteralExpr {
-                    id: next_id(),
-                    value: LiteralValue::Number(value),
-                    span: token.span,
+                Ok(self.arena.alloc(|id| {
+                    Expr::Literal(LiteralExpr {
+                        id,
+                        value: LiteralValue::Number(value),
+                        span: token.span,
+                    })
                 }))
             }
             TokenKind::String => {
                 self.advance();
-                Ok(Expr::Literal(LiteralExpr {
-                    id: next_id(),
-                    value: LiteralValue::String(token.lexeme),
-                    span: token.span,
+                Ok(self.arena.alloc(|id| {
+                    Expr::Literal(LiteralExpr {
+                        id,
+                        value: LiteralValue::String(token.lexeme.into_owned()),
+                        span: token.span,
+                    })
                 }))
             }
             TokenKind::True => {
                 self.advance();
-                Ok(Expr::Literal(LiteralExpr {
-                    id: next_id(),
-                    value: LiteralValue::Bool(true),
-                    span: token.span,
+                Ok(self.arena.alloc(|id| {
+                    Expr::Literal(LiteralExpr {
+                        id,
+                        value: LiteralValue::Bool(true),
+                        span: token.span,
+                    })
                 }))
             }
             TokenKind::False => {
                 self.advance();
-                Ok(Expr::Literal(LiteralExpr {
-                    id: next_id(),
-                    value: LiteralValue::Bool(false),
-                    span: token.span,
+                Ok(self.arena.alloc(|id| {
+                    Expr::Literal(LiteralExpr {
+                        id,
+                        value: LiteralValue::Bool(false),
+                        span: token.span,
+                    })
                 }))
             }
             TokenKind::Nil => {
                 self.advance();
-                Ok(Expr::Literal(LiteralExpr {
-                    id: next_id(),
-                    value: LiteralValue::Nil,
-                    span: token.span,
+                Ok(self.arena.alloc(|id| {
+                    Expr::Literal(LiteralExpr {
+                        id,
+                        value: LiteralValue::Nil,
+                        span: token.span,
+                    })
                 }))
             }
             TokenKind::This => {
                 self.advance();
-                Ok(Expr::This(ThisExpr {
-                    id: next_id(),
-                    span: token.span,
+                Ok(self.arena.alloc(|id| {
+                    Expr::This(ThisExpr {
+                        id,
+                        span: token.span,
+                    })
                 }))
             }
             TokenKind::Super => {
@@ -644,18 +668,18 @@ impl Parser {
                     token.span.offset,
                     self.previous_span().offset + self.previous_span().len - token.span.offset,
                 );
-                Ok(Expr::Super(SuperExpr {
-                    id: next_id(),
-                    method,
-                    span,
-                }))
+                Ok(self
+                    .arena
+                    .alloc(|id| Expr::Super(SuperExpr { id, method, span })))
             }
             TokenKind::Identifier => {
                 self.advance();
-                Ok(Expr::Variable(VariableExpr {
-                    id: next_id(),
-                    name: token.lexeme,
-                    span: token.span,
+                Ok(self.arena.alloc(|id| {
+                    Expr::Variable(VariableExpr {
+                        id,
+                        name: token.lexeme.into_owned(),
+                        span: token.span,
+                    })
                 }))
             }
             TokenKind::LeftParen => {
@@ -666,10 +690,12 @@ impl Parser {
                     token.span.offset,
                     self.previous_span().offset + self.previous_span().len - token.span.offset,
                 );
-                Ok(Expr::Grouping(GroupingExpr {
-                    id: next_id(),
-                    expression: Box::new(expr),
-                    span,
+                Ok(self.arena.alloc(|id| {
+                    Expr::Grouping(GroupingExpr {
+                        id,
+                        expression: expr,
+                        span,
+                    })
                 }))
             }
             _ => Err(CompileError::parse(
@@ -682,7 +708,7 @@ impl Parser {
 
     // --- Helper methods ---
 
-    fn peek(&self) -> &Token {
+    fn peek(&self) -> &Token<'s> {
         &self.tokens[self.current]
     }
 
@@ -690,7 +716,7 @@ impl Parser {
         self.peek().kind == TokenKind::Eof
     }
 
-    fn advance(&mut self) -> &Token {
+    fn advance(&mut self) -> &Token<'s> {
         if !self.is_at_end() {
             self.current += 1;
         }
@@ -720,7 +746,7 @@ impl Parser {
         None
     }
 
-    fn consume(&mut self, kind: TokenKind, message: &str) -> Result<&Token, CompileError> {
+    fn consume(&mut self, kind: TokenKind, message: &str) -> Result<&Token<'s>, CompileError> {
         if self.check(kind) {
             Ok(self.advance())
         } else {
@@ -744,7 +770,7 @@ impl Parser {
     fn expect_identifier(&mut self, context: &str) -> Result<String, CompileError> {
         if self.check(TokenKind::Identifier) {
             let token = self.advance().clone();
-            Ok(token.lexeme)
+            Ok(token.lexeme.into_owned())
         } else {
             let token = self.peek();
             Err(CompileError::parse(
@@ -1,3 +1,4 @@
+use std::collections::HashMap;
 use std::io::{self, Write};
 
 use rustyline::completion::{Completer, Pair};
@@ -6,6 +7,8 @@ use rustyline::hint::Hinter;
 use rustyline::validate::Validator;
 use rustyline::{CompletionType, Config, Context, Editor, Helper};
 
+use crate::ast::{Decl, ExprArena, Program};
+use crate::error::RuntimeError;
 use crate::interpreter::Interpreter;
 use crate::interpreter::resolver::Resolver;
 use crate::parser::Parser;
@@ -59,6 +62,19 @@ pub fn run_repl() {
 
     let mut interpreter = Interpreter::new();
 
+    // One arena grows across all REPL lines so expression ids stay unique:
+    // functions defined on earlier lines keep ids that remain valid in the
+    // (superset) arena passed to `interpret_additional` on later lines.
+    let mut arena = ExprArena::new();
+
+    // Cache of already-compiled lines, keyed on the (wrapped) source. Long
+    // sessions re-enter the same few definitions and calls over and over;
+    // a hit replays the cached declarations against the grown arena and
+    // skips scanning, parsing, and resolving entirely, so re-running a
+    // line costs the same no matter how large the session has become. Only
+    // the delta -- a genuinely new line -- is ever parsed and resolved.
+    let mut line_cache: HashMap<String, Vec<Decl>> = HashMap::new();
+
     loop {
         let line = match rl.readline("> ") {
             Ok(l) => l,
@@ -96,6 +112,25 @@ pub fn run_repl() {
             trimmed.to_string()
         };
 
+        if let Some(declarations) = line_cache.get(&source) {
+            // The cached declarations' expression ids live in the session
+            // arena, and their resolver output was merged when the line
+            // first ran. Move the arena into a Program rather than cloning
+            // it; it is moved back once interpretation finishes.
+            let program = Program {
+                declarations: declarations.clone(),
+                exprs: std::mem::take(&mut arena),
+            };
+            interpreter.set_source(&source);
+            if let Err(e) = interpreter.interpret_additional(&program)
+                && !e.is_return()
+            {
+                report_runtime_error(&e, &source);
+            }
+            arena = program.exprs;
+            continue;
+        }
+
         let tokens = match scanner::scan(&source) {
             Ok(t) => t,
             Err(errors) => {
@@ -107,7 +142,10 @@ pub fn run_repl() {
             }
         };
 
-        let program = match Parser::new(tokens).parse() {
+        // Clone so a parse or resolve error leaves the session arena
+        // untouched; on success the program's extended arena moves back
+        // into `arena` below, as on the cache-hit path.
+        let program = match Parser::with_arena(tokens, arena.clone()).parse() {
             Ok(p) => p,
             Err(errors) => {
                 for error in errors {
@@ -131,16 +169,23 @@ pub fn run_repl() {
 
         interpreter.merge_locals(locals);
         interpreter.set_source(&source);
+        line_cache.insert(source.clone(), program.declarations.clone());
         if let Err(e) = interpreter.interpret_additional(&program)
             && !e.is_return()
         {
-            eprintln!("{}", e.display_with_line(&source));
-            if crate::error::backtrace_enabled() {
-                let bt = crate::error::format_backtrace(e.backtrace_frames());
-                if !bt.is_empty() {
-                    eprint!("{bt}");
-                }
-            }
+            report_runtime_error(&e, &source);
+        }
+        arena = program.exprs;
+    }
+}
+
+/// Print a runtime error (and its backtrace when enabled) for a REPL line.
+fn report_runtime_error(e: &RuntimeError, source: &str) {
+    eprintln!("{}", e.display_with_line(source));
+    if crate::error::backtrace_enabled() {
+        let bt = crate::error::format_backtrace(e.backtrace_frames());
+        if !bt.is_empty() {
+            eprint!("{bt}");
         }
     }
 }
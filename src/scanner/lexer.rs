@@ -1,3 +1,5 @@
+use std::borrow::Cow;
+
 use winnow::combinator::{alt, opt};
 use winnow::error::ContextError;
 use winnow::prelude::*;
@@ -35,63 +37,55 @@ fn whitespace_and_comments<'a>(input: &mut Input<'a>) -> ModalResult<()> {
     Ok(())
 }
 
-fn string_literal<'a>(input: &mut Input<'a>) -> ModalResult<Token> {
+fn string_literal<'a>(input: &mut Input<'a>) -> ModalResult<Token<'a>> {
+    fn cut(_: winnow::error::ErrMode<ContextError>) -> winnow::error::ErrMode<ContextError> {
+        winnow::error::ErrMode::Cut(ContextError::new())
+    }
+
     let start = input.current_token_start();
     '"'.parse_next(input)?;
-    let mut s = String::new();
-    loop {
-        let c = any
-            .parse_next(input)
-            .map_err(|_: winnow::error::ErrMode<ContextError>| {
-                winnow::error::ErrMode::Cut(ContextError::new())
-            })?;
-        match c {
-            '"' => break,
-            '\\' => {
-                let esc =
-                    any.parse_next(input)
-                        .map_err(|_: winnow::error::ErrMode<ContextError>| {
-                            winnow::error::ErrMode::Cut(ContextError::new())
-                        })?;
-                match esc {
-                    'n' => s.push('\n'),
-                    't' => s.push('\t'),
-                    '\\' => s.push('\\'),
-                    '"' => s.push('"'),
-                    other => {
-                        s.push('\\');
-                        s.push(other);
-                    }
+    // Borrow the contents directly when the literal has no escapes; only
+    // fall back to building an owned, unescaped copy on the first backslash.
+    let chunk: &str = take_till(0.., ['"', '\\']).parse_next(input)?;
+    let lexeme = if any.parse_next(input).map_err(cut)? == '"' {
+        Cow::Borrowed(chunk)
+    } else {
+        let mut s = String::from(chunk);
+        loop {
+            let esc = any.parse_next(input).map_err(cut)?;
+            match esc {
+                'n' => s.push('\n'),
+                't' => s.push('\t'),
+                '\\' => s.push('\\'),
+                '"' => s.push('"'),
+                other => {
+                    s.push('\\');
+                    s.push(other);
                 }
             }
-            other => s.push(other),
+            let chunk: &str = take_till(0.., ['"', '\\']).parse_next(input)?;
+            s.push_str(chunk);
+            if any.parse_next(input).map_err(cut)? == '"' {
+                break;
+            }
         }
-    }
+        Cow::Owned(s)
+    };
     let end = input.current_token_start();
     let span = Span::new(start, end - start);
-    Ok(Token::new(TokenKind::String, s, span))
+    Ok(Token::new(TokenKind::String, lexeme, span))
 }
 
-fn number_literal<'a>(input: &mut Input<'a>) -> ModalResult<Token> {
+fn number_literal<'a>(input: &mut Input<'a>) -> ModalResult<Token<'a>> {
     let start = input.current_token_start();
-    let whole: &str = take_while(1.., |c: char| c.is_ascii_digit()).parse_next(input)?;
-    let mut lexeme = whole.to_string();
-
-    let checkpoint = input.checkpoint();
-    let dot_result: Result<char, winnow::error::ErrMode<ContextError>> = '.'.parse_next(input);
-    if dot_result.is_ok() {
-        match take_while::<_, _, ContextError>(1.., |c: char| c.is_ascii_digit()).parse_next(input)
-        {
-            Ok(frac) => {
-                lexeme.push('.');
-                lexeme.push_str(frac);
-            }
-            Err(_) => {
-                input.reset(&checkpoint);
-            }
-        }
-    }
-
+    // `opt` backtracks past the dot when no fraction digits follow, so
+    // `42.foo` still lexes as NUMBER DOT IDENTIFIER.
+    let lexeme: &str = (
+        take_while(1.., |c: char| c.is_ascii_digit()),
+        opt(('.', take_while(1.., |c: char| c.is_ascii_digit()))),
+    )
+        .take()
+        .parse_next(input)?;
     let end = input.current_token_start();
     Ok(Token::new(
         TokenKind::Number,
@@ -100,22 +94,20 @@ fn number_literal<'a>(input: &mut Input<'a>) -> ModalResult<Token> {
     ))
 }
 
-fn identifier_or_keyword<'a>(input: &mut Input<'a>) -> ModalResult<Token> {
+fn identifier_or_keyword<'a>(input: &mut Input<'a>) -> ModalResult<Token<'a>> {
     let start = input.current_token_start();
-    let first: char = any
-        .verify(|c: &char| c.is_ascii_alphabetic() || *c == '_')
+    let lexeme: &str = (
+        any.verify(|c: &char| c.is_ascii_alphabetic() || *c == '_'),
+        take_while(0.., |c: char| c.is_ascii_alphanumeric() || c == '_'),
+    )
+        .take()
         .parse_next(input)?;
-    let rest: &str =
-        take_while(0.., |c: char| c.is_ascii_alphanumeric() || c == '_').parse_next(input)?;
     let end = input.current_token_start();
-    let mut lexeme = String::with_capacity(1 + rest.len());
-    lexeme.push(first);
-    lexeme.push_str(rest);
-    let kind = keyword_kind(&lexeme).unwrap_or(TokenKind::Identifier);
+    let kind = keyword_kind(lexeme).unwrap_or(TokenKind::Identifier);
     Ok(Token::new(kind, lexeme, Span::new(start, end - start)))
 }
 
-fn two_char_token<'a>(input: &mut Input<'a>) -> ModalResult<Token> {
+fn two_char_token<'a>(input: &mut Input<'a>) -> ModalResult<Token<'a>> {
     let start = input.current_token_start();
     let (kind, lexeme) = alt((
         "!=".value((TokenKind::BangEqual, "!=")),
@@ -127,10 +119,11 @@ fn two_char_token<'a>(input: &mut Input<'a>) -> ModalResult<Token> {
     Ok(Token::new(kind, lexeme, Span::new(start, 2)))
 }
 
-fn single_char_token<'a>(input: &mut Input<'a>) -> ModalResult<Token> {
+fn single_char_token<'a>(input: &mut Input<'a>) -> ModalResult<Token<'a>> {
     let start = input.current_token_start();
-    let c = any
+    let (c, lexeme) = any
         .verify(|c: &char| "(){}.,;-+/*!=<>".contains(*c))
+        .with_taken()
         .parse_next(input)?;
     let kind = match c {
         '(' => TokenKind::LeftParen,
@@ -150,10 +143,10 @@ fn single_char_token<'a>(input: &mut Input<'a>) -> ModalResult<Token> {
         '>' => TokenKind::Greater,
         _ => unreachable!("verify guarantees valid char"),
     };
-    Ok(Token::new(kind, c.to_string(), Span::new(start, 1)))
+    Ok(Token::new(kind, lexeme, Span::new(start, 1)))
 }
 
-fn scan_token<'a>(input: &mut Input<'a>) -> ModalResult<Token> {
+fn scan_token<'a>(input: &mut Input<'a>) -> ModalResult<Token<'a>> {
     alt((
         string_literal,
         number_literal,
@@ -165,7 +158,9 @@ fn scan_token<'a>(input: &mut Input<'a>) -> ModalResult<Token> {
 }
 
 /// Scan all tokens from source, returning either a token list or scan errors.
-pub fn scan_all(source: &str) -> Result<Vec<Token>, Vec<CompileError>> {
+/// Tokens borrow the source buffer, so scanning allocates only for string
+/// literals that contain escape sequences.
+pub fn scan_all(source: &str) -> Result<Vec<Token<'_>>, Vec<CompileError>> {
     let mut input = LocatingSlice::new(source);
     let _ = opt(shebang).parse_next(&mut input);
     let mut tokens = Vec::new();
@@ -207,11 +202,11 @@ pub fn scan_all(source: &str) -> Result<Vec<Token>, Vec<CompileError>> {
 mod tests {
     use super::*;
 
-    fn scan_ok(source: &str) -> Vec<Token> {
+    fn scan_ok(source: &str) -> Vec<Token<'_>> {
         scan_all(source).expect("scan should succeed")
     }
 
-    fn kinds(tokens: &[Token]) -> Vec<TokenKind> {
+    fn kinds(tokens: &[Token<'_>]) -> Vec<TokenKind> {
         tokens.iter().map(|t| t.kind).collect()
     }
 
@@ -4,7 +4,8 @@ pub mod token;
 use crate::error::CompileError;
 use token::Token;
 
-/// Scan source code into a list of tokens.
-pub fn scan(source: &str) -> Result<Vec<Token>, Vec<CompileError>> {
+/// Scan source code into a list of tokens. Tokens borrow `source`, so it
+/// must outlive them; see [`lexer::scan_all`].
+pub fn scan(source: &str) -> Result<Vec<Token<'_>>, Vec<CompileError>> {
     lexer::scan_all(source)
 }
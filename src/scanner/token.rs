@@ -1,3 +1,4 @@
+use std::borrow::Cow;
 use std::fmt;
 
 #[derive(Debug, Clone, Copy, PartialEq, Eq)]
@@ -115,15 +116,17 @@ impl From<Span> for miette::SourceSpan {
     }
 }
 
+/// A scanned token. The lexeme borrows the source buffer where possible;
+/// only string literals containing escapes carry an owned, unescaped copy.
 #[derive(Debug, Clone, PartialEq)]
-pub struct Token {
+pub struct Token<'s> {
     pub kind: TokenKind,
-    pub lexeme: String,
+    pub lexeme: Cow<'s, str>,
     pub span: Span,
 }
 
-impl Token {
-    pub fn new(kind: TokenKind, lexeme: impl Into<String>, span: Span) -> Self {
+impl<'s> Token<'s> {
+    pub fn new(kind: TokenKind, lexeme: impl Into<Cow<'s, str>>, span: Span) -> Self {
         Self {
             kind,
             lexeme: lexeme.into(),
@@ -132,7 +135,7 @@ impl Token {
     }
 }
 
-impl fmt::Display for Token {
+impl fmt::Display for Token<'_> {
     fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
         write!(f, "{:?} '{}' @{}", self.kind, self.lexeme, self.span.offset)
     }
@@ -0,0 +1,321 @@
+//! On-disk `.blox` container formats for compiled bytecode.
+//!
+//! v3 (current, magic `blx2`): a flat little-endian layout designed for
+//! memory-mapped loading. [`load`] maps the file and decodes it by slicing:
+//! code bytes are one bounds-checked copy straight out of the map, and
+//! string constants are referenced by offset/length rather than parsed
+//! through a general-purpose deserializer. Short-lived processes spend
+//! their startup on `mmap` and a few memcpys instead of walking
+//! MessagePack structure.
+//!
+//! v1 (legacy, magic `blox`): the original MessagePack encoding of
+//! [`Chunk`]; existing files keep loading through the fallback path.
+//!
+//! Layout after the 4-byte magic and 1-byte version:
+//!
+//! ```text
+//! chunk    := u32 code_len, code bytes,
+//!             u32 run_count, (u32 line, u32 count)*,   -- line table runs
+//!             u32 global_count, str*,
+//!             u32 constant_count, constant*
+//! constant := 0x00, f64 le                             -- number
+//!           | 0x01, str                                -- string
+//!           | 0x02, str name, u32 arity, u32 upvalue_count, chunk
+//! str      := u32 len, utf-8 bytes
+//! ```
+
+use std::path::Path;
+
+use anyhow::{Context, Result, bail};
+
+use crate::vm::chunk::{Chunk, Constant, LineTable};
+
+/// Magic for legacy MessagePack `.blox` files.
+const LEGACY_MAGIC: &[u8; 4] = b"blox";
+/// Magic for the mappable container.
+const MAGIC: &[u8; 4] = b"blx2";
+/// Container version, bumped on layout changes. v3 widened the naming
+/// opcodes (closure, class, method, property and super access) to 16-bit
+/// constant-pool operands and the global opcodes to 16-bit slot operands;
+/// v2 files are rejected rather than misdecoded.
+const VERSION: u8 = 3;
+
+const TAG_NUMBER: u8 = 0;
+const TAG_STRING: u8 = 1;
+const TAG_FUNCTION: u8 = 2;
+
+/// Write `chunk` to `path` in the v3 container format.
+pub fn save(chunk: &Chunk, path: &Path) -> Result<()> {
+    std::fs::write(path, to_bytes(chunk))
+        .with_context(|| format!("write bytecode to '{}'", path.display()))
+}
+
+/// Memory-map `path` and decode it, accepting either container version.
+pub fn load(path: &Path) -> Result<Chunk> {
+    let file =
+        std::fs::File::open(path).with_context(|| format!("open file '{}'", path.display()))?;
+    // Safety: the mapping is read-only and dropped before this function
+    // returns. Mutating the file while it is mapped is undefined behavior
+    // per memmap2's contract; bytecode files are not rewritten in place.
+    let map = unsafe { memmap2::Mmap::map(&file) }
+        .with_context(|| format!("memory-map '{}'", path.display()))?;
+    from_bytes(&map).with_context(|| format!("load bytecode from '{}'", path.display()))
+}
+
+/// Whether the file at `path` starts with either `.blox` magic.
+pub fn is_bytecode_file(path: &Path) -> Result<bool> {
+    let file =
+        std::fs::File::open(path).with_context(|| format!("open file '{}'", path.display()))?;
+    let mut header = [0u8; 4];
+    use std::io::Read;
+    match file.take(4).read(&mut header) {
+        Ok(4) => Ok(&header == MAGIC || &header == LEGACY_MAGIC),
+        _ => Ok(false),
+    }
+}
+
+/// Serialize `chunk` into a v3 container byte buffer.
+pub fn to_bytes(chunk: &Chunk) -> Vec<u8> {
+    let mut out = Vec::new();
+    out.extend_from_slice(MAGIC);
+    out.push(VERSION);
+    encode_chunk(chunk, &mut out);
+    out
+}
+
+/// Decode a container byte buffer, dispatching on the magic header.
+pub fn from_bytes(bytes: &[u8]) -> Result<Chunk> {
+    if bytes.starts_with(MAGIC) {
+        decode_v3(&bytes[MAGIC.len()..])
+    } else if bytes.starts_with(LEGACY_MAGIC) {
+        rmp_serde::from_slice(&bytes[LEGACY_MAGIC.len()..])
+            .context("deserialize legacy bytecode from MessagePack")
+    } else {
+        bail!("not a .blox file (missing magic header)")
+    }
+}
+
+fn write_u32(out: &mut Vec<u8>, value: usize) {
+    let value = u32::try_from(value).expect("bytecode section length fits in u32");
+    out.extend_from_slice(&value.to_le_bytes());
+}
+
+fn write_str(out: &mut Vec<u8>, s: &str) {
+    write_u32(out, s.len());
+    out.extend_from_slice(s.as_bytes());
+}
+
+fn encode_chunk(chunk: &Chunk, out: &mut Vec<u8>) {
+    write_u32(out, chunk.code.len());
+    out.extend_from_slice(&chunk.code);
+    let runs = chunk.lines.runs();
+    write_u32(out, runs.len());
+    for &(line, count) in runs {
+        write_u32(out, line);
+        write_u32(out, count);
+    }
+    write_u32(out, chunk.globals.len());
+    for name in &chunk.globals {
+        write_str(out, name);
+    }
+    write_u32(out, chunk.constants.len());
+    for constant in &chunk.constants {
+        match constant {
+            Constant::Number(n) => {
+                out.push(TAG_NUMBER);
+                out.extend_from_slice(&n.to_le_bytes());
+            }
+            Constant::String(s) => {
+                out.push(TAG_STRING);
+                write_str(out, s);
+            }
+            Constant::Function {
+                name,
+                arity,
+                upvalue_count,
+                chunk,
+            } => {
+                out.push(TAG_FUNCTION);
+                write_str(out, name);
+                write_u32(out, *arity);
+                write_u32(out, *upvalue_count);
+                encode_chunk(chunk, out);
+            }
+        }
+    }
+}
+
+/// Bounds-checked cursor over the mapped bytes; every read is a slice at
+/// the current offset, so decoding never copies more than the payload.
+struct Reader<'a> {
+    bytes: &'a [u8],
+    pos: usize,
+}
+
+impl<'a> Reader<'a> {
+    fn slice(&mut self, len: usize) -> Result<&'a [u8]> {
+        let end = self
+            .pos
+            .checked_add(len)
+            .filter(|&end| end <= self.bytes.len())
+            .ok_or_else(|| anyhow::anyhow!("truncated bytecode at offset {}", self.pos))?;
+        let slice = &self.bytes[self.pos..end];
+        self.pos = end;
+        Ok(slice)
+    }
+
+    fn u8(&mut self) -> Result<u8> {
+        Ok(self.slice(1)?[0])
+    }
+
+    fn u32(&mut self) -> Result<usize> {
+        let bytes = self.slice(4)?.try_into().expect("slice is 4 bytes");
+        Ok(u32::from_le_bytes(bytes) as usize)
+    }
+
+    fn f64(&mut self) -> Result<f64> {
+        let bytes = self.slice(8)?.try_into().expect("slice is 8 bytes");
+        Ok(f64::from_le_bytes(bytes))
+    }
+
+    fn str(&mut self) -> Result<String> {
+        let len = self.u32()?;
+        let bytes = self.slice(len)?;
+        Ok(std::str::from_utf8(bytes)
+            .context("string constant is not valid UTF-8")?
+            .to_string())
+    }
+}
+
+fn decode_v3(bytes: &[u8]) -> Result<Chunk> {
+    let mut reader = Reader { bytes, pos: 0 };
+    let version = reader.u8()?;
+    if version != VERSION {
+        bail!("unsupported .blox container version {version} (expected {VERSION})");
+    }
+    let chunk = decode_chunk(&mut reader)?;
+    if reader.pos != bytes.len() {
+        bail!("trailing bytes after bytecode");
+    }
+    Ok(chunk)
+}
+
+fn decode_chunk(reader: &mut Reader) -> Result<Chunk> {
+    let code_len = reader.u32()?;
+    let code = reader.slice(code_len)?.to_vec();
+    let run_count = reader.u32()?;
+    let mut runs = Vec::with_capacity(run_count);
+    for _ in 0..run_count {
+        let line = reader.u32()?;
+        let count = reader.u32()?;
+        runs.push((line, count));
+    }
+    let global_count = reader.u32()?;
+    let mut globals = Vec::with_capacity(global_count);
+    for _ in 0..global_count {
+        globals.push(reader.str()?);
+    }
+    let constant_count = reader.u32()?;
+    let mut constants = Vec::with_capacity(constant_count);
+    for _ in 0..constant_count {
+        constants.push(match reader.u8()? {
+            TAG_NUMBER => Constant::Number(reader.f64()?),
+            TAG_STRING => Constant::String(reader.str()?),
+            TAG_FUNCTION => Constant::Function {
+                name: reader.str()?,
+                arity: reader.u32()?,
+                upvalue_count: reader.u32()?,
+                chunk: decode_chunk(reader)?,
+            },
+            tag => bail!("unknown constant tag {tag}"),
+        });
+    }
+
+    let mut chunk = Chunk::new();
+    chunk.code = code;
+    chunk.constants = constants;
+    chunk.lines = LineTable::from_runs(runs);
+    chunk.globals = globals;
+    Ok(chunk)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::vm::chunk::OpCode;
+
+    fn sample_chunk() -> Chunk {
+        let mut inner = Chunk::new();
+        let idx = inner.add_constant(Constant::Number(1.0)) as u8;
+        inner.write_op(OpCode::Constant, 2);
+        inner.write_byte(idx, 2);
+        inner.write_op(OpCode::Return, 2);
+
+        let mut chunk = Chunk::new();
+        let num = chunk.add_constant(Constant::Number(42.0)) as u8;
+        let text = chunk.add_constant(Constant::String("hello".to_string())) as u8;
+        chunk.add_constant(Constant::Function {
+            name: "one".to_string(),
+            arity: 0,
+            upvalue_count: 1,
+            chunk: inner,
+        });
+        chunk.write_op(OpCode::Constant, 1);
+        chunk.write_byte(num, 1);
+        chunk.write_op(OpCode::Constant, 1);
+        chunk.write_byte(text, 1);
+        chunk.write_op(OpCode::Return, 3);
+        chunk.globals = vec!["a".to_string(), "b".to_string()];
+        chunk
+    }
+
+    #[test]
+    fn v3_roundtrip_preserves_chunk() {
+        let chunk = sample_chunk();
+        let bytes = to_bytes(&chunk);
+        assert!(bytes.starts_with(MAGIC));
+        let loaded = from_bytes(&bytes).expect("decode");
+        assert_eq!(loaded, chunk);
+    }
+
+    #[test]
+    fn legacy_format_still_loads() {
+        let chunk = sample_chunk();
+        let mut bytes = LEGACY_MAGIC.to_vec();
+        bytes.extend(rmp_serde::to_vec(&chunk).expect("serialize"));
+        let loaded = from_bytes(&bytes).expect("decode legacy");
+        assert_eq!(loaded, chunk);
+    }
+
+    #[test]
+    fn rejects_unknown_magic() {
+        let err = from_bytes(b"nope....").unwrap_err();
+        assert!(err.to_string().contains("missing magic header"));
+    }
+
+    #[test]
+    fn rejects_future_version() {
+        let mut bytes = to_bytes(&sample_chunk());
+        bytes[MAGIC.len()] = VERSION + 1;
+        let err = from_bytes(&bytes).unwrap_err();
+        assert!(err.to_string().contains("unsupported .blox container"));
+    }
+
+    #[test]
+    fn rejects_truncated_input() {
+        let bytes = to_bytes(&sample_chunk());
+        let err = from_bytes(&bytes[..bytes.len() - 3]).unwrap_err();
+        assert!(err.to_string().contains("truncated bytecode"));
+    }
+
+    #[test]
+    fn save_and_load_through_mmap() {
+        let chunk = sample_chunk();
+        let path = std::env::temp_dir().join(format!("vibe-lox-blox-{}.blox", std::process::id()));
+        save(&chunk, &path).expect("save");
+        assert!(is_bytecode_file(&path).expect("probe"));
+        let loaded = load(&path).expect("load");
+        std::fs::remove_file(&path).expect("cleanup");
+        assert_eq!(loaded, chunk);
+    }
+}
@@ -1,5 +1,6 @@
 use anyhow::Result;
 use serde::{Deserialize, Serialize};
+use std::collections::HashMap;
 use std::fmt;
 
 /// A bytecode instruction.
@@ -44,8 +45,39 @@ pub enum OpCode {
     Class,
     Inherit,
     Method,
+    /// Like `Constant` but with a 16-bit pool index, emitted once a chunk
+    /// outgrows single-byte operands.
+    ConstantLong,
+    // Fused and rewritten forms produced by the peephole optimizer in
+    // `src/vm/optimizer.rs`; the compiler never emits these directly.
+    /// `less; not` — pops two numbers, pushes `a >= b`.
+    GreaterEqual,
+    /// `greater; not` — pops two numbers, pushes `a <= b`.
+    LessEqual,
+    /// `equal; not` — pops two values, pushes `a != b`.
+    NotEqual,
+    /// `get_local; constant; add` — operands: local slot, constant index.
+    LocalAddConstant,
+    /// `less; jump_if_false` — pushes the comparison result and branches
+    /// on it, leaving the stack as the unfused pair would.
+    LessJumpIfFalse,
+    /// `greater; jump_if_false`.
+    GreaterJumpIfFalse,
+    /// `equal; jump_if_false`.
+    EqualJumpIfFalse,
+    /// Like `Call`, but emitted for `return f(...)`: a closure callee
+    /// reuses the current frame, so tail recursion runs in constant frame
+    /// space. Appended after the fused forms to keep the numbering of
+    /// existing opcodes (and thus `.blox` files) stable.
+    TailCall,
 }
 
+/// Cache-slot operand marking a property access site that skips inline
+/// caching. The compiler emits it for sites past the one-byte slot limit,
+/// so large functions still compile and merely fall back to the method
+/// table at those sites.
+pub const UNCACHED_SLOT: u8 = u8::MAX;
+
 impl fmt::Display for OpCode {
     fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
         write!(f, "{self:?}")
@@ -56,7 +88,7 @@ impl TryFrom<u8> for OpCode {
     type Error = u8;
 
     fn try_from(byte: u8) -> Result<Self, Self::Error> {
-        if byte <= OpCode::Method as u8 {
+        if byte <= OpCode::TailCall as u8 {
             // Safety: OpCode is repr(u8) and we've verified byte is in range
             Ok(unsafe { std::mem::transmute::<u8, OpCode>(byte) })
         } else {
@@ -107,12 +139,90 @@ impl fmt::Display for Constant {
     }
 }
 
+/// Hashable identity of a poolable constant, used to dedup `add_constant`.
+/// Numbers key on their raw bits; function constants are never duplicated.
+#[derive(Debug, Clone, PartialEq, Eq, Hash)]
+enum ConstantKey {
+    Number(u64),
+    String(String),
+}
+
+/// Run-length encoded line table: one `(line, count)` run per stretch of
+/// consecutive code bytes from the same source line. Far smaller than one
+/// entry per byte, both in memory and in serialized `.blox` files.
+#[derive(Debug, Clone, PartialEq, Default, Serialize, Deserialize)]
+pub struct LineTable {
+    runs: Vec<(usize, usize)>,
+}
+
+impl LineTable {
+    /// Record the source line of the next code byte.
+    pub fn push(&mut self, line: usize) {
+        if let Some((last, count)) = self.runs.last_mut()
+            && *last == line
+        {
+            *count += 1;
+        } else {
+            self.runs.push((line, 1));
+        }
+    }
+
+    /// Source line of the code byte at `offset`, or `None` past the end.
+    pub fn line_at(&self, offset: usize) -> Option<usize> {
+        let mut covered = 0;
+        for &(line, count) in &self.runs {
+            covered += count;
+            if offset < covered {
+                return Some(line);
+            }
+        }
+        None
+    }
+
+    /// The `(line, count)` runs, for external serializers.
+    pub(crate) fn runs(&self) -> &[(usize, usize)] {
+        &self.runs
+    }
+
+    /// Rebuild a table from previously serialized `(line, count)` runs.
+    pub(crate) fn from_runs(runs: Vec<(usize, usize)>) -> Self {
+        Self { runs }
+    }
+
+    /// Total number of code bytes covered.
+    pub fn len(&self) -> usize {
+        self.runs.iter().map(|&(_, count)| count).sum()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.runs.is_empty()
+    }
+}
+
 /// A chunk of bytecode: instructions + constant pool + line info.
-#[derive(Debug, Clone, PartialEq, Serialize, Deserialize)]
+#[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct Chunk {
     pub code: Vec<u8>,
     pub constants: Vec<Constant>,
-    pub lines: Vec<usize>,
+    pub lines: LineTable,
+    /// Global variable names indexed by slot. Populated only on the top-level
+    /// script chunk; global opcodes carry slot indices into this table, and
+    /// the names are kept for error messages and disassembly.
+    pub globals: Vec<String>,
+    /// Compile-time index for constant dedup; rebuilt lazily, never serialized.
+    #[serde(skip)]
+    constant_index: HashMap<ConstantKey, u16>,
+}
+
+/// Equality ignores the transient dedup index so a deserialized chunk
+/// compares equal to the one that was saved.
+impl PartialEq for Chunk {
+    fn eq(&self, other: &Self) -> bool {
+        self.code == other.code
+            && self.constants == other.constants
+            && self.lines == other.lines
+            && self.globals == other.globals
+    }
 }
 
 impl Default for Chunk {
@@ -126,7 +236,9 @@ impl Chunk {
         Self {
             code: Vec::new(),
             constants: Vec::new(),
-            lines: Vec::new(),
+            lines: LineTable::default(),
+            globals: Vec::new(),
+            constant_index: HashMap::new(),
         }
     }
 
@@ -147,11 +259,28 @@ impl Chunk {
         self.lines.push(line);
     }
 
-    pub fn add_constant(&mut self, constant: Constant) -> u8 {
+    /// Add a constant to the pool, reusing an existing entry when an equal
+    /// number or string is already pooled. Returns the pool index; indices
+    /// above 255 require the `ConstantLong` encoding.
+    pub fn add_constant(&mut self, constant: Constant) -> u16 {
+        let key = match &constant {
+            Constant::Number(n) => Some(ConstantKey::Number(n.to_bits())),
+            Constant::String(s) => Some(ConstantKey::String(s.clone())),
+            Constant::Function { .. } => None,
+        };
+        if let Some(key) = &key
+            && let Some(&idx) = self.constant_index.get(key)
+        {
+            return idx;
+        }
         self.constants.push(constant);
-        (self.constants.len() - 1)
+        let idx: u16 = (self.constants.len() - 1)
             .try_into()
-            .expect("constant pool overflow (max 256)")
+            .expect("constant pool overflow (max 65536)");
+        if let Some(key) = key {
+            self.constant_index.insert(key, idx);
+        }
+        idx
     }
 
     pub fn read_u16(&self, offset: usize) -> u16 {
@@ -168,12 +297,19 @@ impl Chunk {
 pub fn disassemble(chunk: &Chunk, source_name: &str) -> Result<String> {
     let mut out = String::new();
     out.push_str(&format!("Compiled from \"{source_name}\"\n"));
-    disassemble_chunk(chunk, "script", 0, &mut out)?;
+    disassemble_chunk(chunk, "script", 0, &chunk.globals, &mut out)?;
     Ok(out)
 }
 
 /// Recursively disassemble a single chunk (script or function body).
-fn disassemble_chunk(chunk: &Chunk, name: &str, arity: usize, out: &mut String) -> Result<()> {
+/// `globals` is the script chunk's slot table, shared by nested functions.
+fn disassemble_chunk(
+    chunk: &Chunk,
+    name: &str,
+    arity: usize,
+    globals: &[String],
+    out: &mut String,
+) -> Result<()> {
     // Function header
     if name == "script" {
         out.push_str("script;\n");
@@ -202,8 +338,16 @@ fn disassemble_chunk(chunk: &Chunk, name: &str, arity: usize, out: &mut String)
     // Code section
     out.push_str("  Code:\n");
     let mut offset = 0;
+    let mut prev_line = None;
     while offset < chunk.code.len() {
-        offset = disassemble_instruction(chunk, offset, out)?;
+        let line = chunk.lines.line_at(offset).unwrap_or(0);
+        if prev_line == Some(line) {
+            out.push_str("     ");
+        } else {
+            out.push_str(&format!("{line:>4} "));
+        }
+        prev_line = Some(line);
+        offset = disassemble_instruction(chunk, offset, globals, out)?;
     }
     out.push('\n');
 
@@ -216,7 +360,7 @@ fn disassemble_chunk(chunk: &Chunk, name: &str, arity: usize, out: &mut String)
             ..
         } = constant
         {
-            disassemble_chunk(fn_chunk, name, *arity, out)?;
+            disassemble_chunk(fn_chunk, name, *arity, globals, out)?;
         }
     }
 
@@ -224,22 +368,41 @@ fn disassemble_chunk(chunk: &Chunk, name: &str, arity: usize, out: &mut String)
 }
 
 /// Format a single instruction into `out`, returning the next offset.
-fn disassemble_instruction(chunk: &Chunk, offset: usize, out: &mut String) -> Result<usize> {
+fn disassemble_instruction(
+    chunk: &Chunk,
+    offset: usize,
+    globals: &[String],
+    out: &mut String,
+) -> Result<usize> {
     let byte = chunk.code[offset];
     let op = OpCode::try_from(byte)
         .map_err(|b| anyhow::anyhow!("invalid opcode {b} at offset {offset}"))?;
     let name = op.as_ref();
 
     match op {
-        OpCode::Constant
-        | OpCode::DefineGlobal
-        | OpCode::GetGlobal
-        | OpCode::SetGlobal
-        | OpCode::Class
-        | OpCode::GetProperty
-        | OpCode::SetProperty
-        | OpCode::Method
-        | OpCode::GetSuper => {
+        OpCode::DefineGlobal | OpCode::GetGlobal | OpCode::SetGlobal => {
+            let slot = chunk.read_u16(offset + 1);
+            let comment = globals
+                .get(slot as usize)
+                .map(String::as_str)
+                .unwrap_or("?");
+            out.push_str(&format!(
+                "    {:>3}: {:<18} {:<6} // {comment}\n",
+                offset, name, slot
+            ));
+            Ok(offset + 3)
+        }
+        OpCode::GetProperty => {
+            let idx = chunk.read_u16(offset + 1);
+            let cache = chunk.code[offset + 3];
+            let comment = &chunk.constants[idx as usize];
+            out.push_str(&format!(
+                "    {:>3}: {:<18} #{:<5} // {comment} (cache {cache})\n",
+                offset, name, idx
+            ));
+            Ok(offset + 4)
+        }
+        OpCode::Constant => {
             let idx = chunk.code[offset + 1];
             let comment = &chunk.constants[idx as usize];
             out.push_str(&format!(
@@ -248,16 +411,50 @@ fn disassemble_instruction(chunk: &Chunk, offset: usize, out: &mut String) -> Re
             ));
             Ok(offset + 2)
         }
+        // Naming opcodes carry 16-bit pool indices.
+        OpCode::Class | OpCode::SetProperty | OpCode::Method | OpCode::GetSuper => {
+            let idx = chunk.read_u16(offset + 1);
+            let comment = &chunk.constants[idx as usize];
+            out.push_str(&format!(
+                "    {:>3}: {:<18} #{:<5} // {comment}\n",
+                offset, name, idx
+            ));
+            Ok(offset + 3)
+        }
+        OpCode::LocalAddConstant => {
+            let slot = chunk.code[offset + 1];
+            let idx = chunk.code[offset + 2];
+            let comment = &chunk.constants[idx as usize];
+            out.push_str(&format!(
+                "    {:>3}: {:<18} {slot} #{:<5} // {comment}\n",
+                offset, name, idx
+            ));
+            Ok(offset + 3)
+        }
+        OpCode::ConstantLong => {
+            let idx = chunk.read_u16(offset + 1);
+            let comment = &chunk.constants[idx as usize];
+            out.push_str(&format!(
+                "    {:>3}: {:<18} #{:<5} // {comment}\n",
+                offset, name, idx
+            ));
+            Ok(offset + 3)
+        }
         OpCode::GetLocal
         | OpCode::SetLocal
         | OpCode::Call
+        | OpCode::TailCall
         | OpCode::GetUpvalue
         | OpCode::SetUpvalue => {
             let slot = chunk.code[offset + 1];
             out.push_str(&format!("    {:>3}: {:<18} {slot}\n", offset, name));
             Ok(offset + 2)
         }
-        OpCode::Jump | OpCode::JumpIfFalse => {
+        OpCode::Jump
+        | OpCode::JumpIfFalse
+        | OpCode::LessJumpIfFalse
+        | OpCode::GreaterJumpIfFalse
+        | OpCode::EqualJumpIfFalse => {
             let jump = chunk.read_u16(offset + 1);
             let target = offset + 3 + jump as usize;
             out.push_str(&format!("    {:>3}: {:<18} -> {target}\n", offset, name));
@@ -270,23 +467,23 @@ fn disassemble_instruction(chunk: &Chunk, offset: usize, out: &mut String) -> Re
             Ok(offset + 3)
         }
         OpCode::Invoke | OpCode::SuperInvoke => {
-            let name_idx = chunk.code[offset + 1];
-            let arg_count = chunk.code[offset + 2];
+            let name_idx = chunk.read_u16(offset + 1);
+            let arg_count = chunk.code[offset + 3];
             let comment = &chunk.constants[name_idx as usize];
             out.push_str(&format!(
                 "    {:>3}: {:<18} #{:<5} // ({arg_count} args) {comment}\n",
                 offset, name, name_idx
             ));
-            Ok(offset + 3)
+            Ok(offset + 4)
         }
         OpCode::Closure => {
-            let idx = chunk.code[offset + 1];
+            let idx = chunk.read_u16(offset + 1);
             let comment = &chunk.constants[idx as usize];
             out.push_str(&format!(
                 "    {:>3}: {:<18} #{:<5} // {comment}\n",
                 offset, name, idx
             ));
-            let mut off = offset + 2;
+            let mut off = offset + 3;
             if let Constant::Function { upvalue_count, .. } = &chunk.constants[idx as usize] {
                 for _ in 0..*upvalue_count {
                     let is_local = chunk.code[off];
@@ -314,7 +511,7 @@ mod tests {
         let mut chunk = Chunk::new();
         let idx = chunk.add_constant(Constant::Number(1.2));
         chunk.write_op(OpCode::Constant, 1);
-        chunk.write_byte(idx, 1);
+        chunk.write_byte(idx as u8, 1);
 
         assert_eq!(chunk.code.len(), 2);
         assert_eq!(chunk.code[0], OpCode::Constant as u8);
@@ -326,7 +523,7 @@ mod tests {
         let mut chunk = Chunk::new();
         let idx = chunk.add_constant(Constant::Number(42.0));
         chunk.write_op(OpCode::Constant, 1);
-        chunk.write_byte(idx, 1);
+        chunk.write_byte(idx as u8, 1);
         chunk.write_op(OpCode::Return, 1);
 
         let text = disassemble(&chunk, "test").expect("valid bytecode");
@@ -382,9 +579,32 @@ mod tests {
         chunk.write_op(OpCode::Return, 2);
 
         assert_eq!(chunk.lines.len(), 3);
-        assert_eq!(chunk.lines[0], 1);
-        assert_eq!(chunk.lines[1], 1);
-        assert_eq!(chunk.lines[2], 2);
+        assert_eq!(chunk.lines.line_at(0), Some(1));
+        assert_eq!(chunk.lines.line_at(1), Some(1));
+        assert_eq!(chunk.lines.line_at(2), Some(2));
+        assert_eq!(chunk.lines.line_at(3), None);
+    }
+
+    #[test]
+    fn line_table_run_length_encodes() {
+        let mut table = LineTable::default();
+        for _ in 0..100 {
+            table.push(7);
+        }
+        for _ in 0..50 {
+            table.push(8);
+        }
+        assert_eq!(table.len(), 150);
+        assert_eq!(table.line_at(0), Some(7));
+        assert_eq!(table.line_at(99), Some(7));
+        assert_eq!(table.line_at(100), Some(8));
+        // Two runs serialize to a handful of bytes, not one entry per byte.
+        let serialized = rmp_serde::to_vec(&table).expect("serialize");
+        assert!(
+            serialized.len() < 16,
+            "serialized {} bytes",
+            serialized.len()
+        );
     }
 
     // ========== Constant Pool ==========
@@ -420,22 +640,48 @@ mod tests {
     }
 
     #[test]
-    fn constant_pool_max_255() {
+    fn constant_pool_grows_past_256() {
         let mut chunk = Chunk::new();
-        for i in 0..255 {
+        for i in 0..300 {
             let idx = chunk.add_constant(Constant::Number(i as f64));
-            assert_eq!(idx, i as u8);
+            assert_eq!(idx, i as u16);
         }
-        assert_eq!(chunk.constants.len(), 255);
+        assert_eq!(chunk.constants.len(), 300);
+    }
+
+    #[test]
+    fn add_constant_dedups_equal_values() {
+        let mut chunk = Chunk::new();
+        let a = chunk.add_constant(Constant::Number(1.0));
+        let b = chunk.add_constant(Constant::String("x".to_string()));
+        assert_eq!(chunk.add_constant(Constant::Number(1.0)), a);
+        assert_eq!(chunk.add_constant(Constant::String("x".to_string())), b);
+        // Distinct values still get fresh slots
+        assert_eq!(chunk.add_constant(Constant::Number(2.0)), 2);
+        assert_eq!(chunk.constants.len(), 3);
     }
 
     #[test]
     #[should_panic(expected = "constant pool overflow")]
     fn constant_pool_overflow() {
         let mut chunk = Chunk::new();
-        for i in 0..257 {
+        for i in 0..=65536 {
+            chunk.add_constant(Constant::Number(i as f64));
+        }
+    }
+
+    #[test]
+    fn disassemble_constant_long() {
+        let mut chunk = Chunk::new();
+        for i in 0..300 {
             chunk.add_constant(Constant::Number(i as f64));
         }
+        chunk.write_op(OpCode::ConstantLong, 1);
+        chunk.write_u16(299, 1);
+
+        let text = disassemble(&chunk, "test").expect("valid bytecode");
+        assert!(text.contains("constant_long"));
+        assert!(text.contains("#299"));
     }
 
     // ========== U16 Operations ==========
@@ -494,7 +740,7 @@ mod tests {
         let mut chunk = Chunk::new();
         let idx = chunk.add_constant(Constant::Number(123.45));
         chunk.write_op(OpCode::Constant, 1);
-        chunk.write_byte(idx, 1);
+        chunk.write_byte(idx as u8, 1);
 
         let text = disassemble(&chunk, "test").expect("valid bytecode");
         assert!(text.contains("constant"));
@@ -507,7 +753,7 @@ mod tests {
         let mut chunk = Chunk::new();
         let idx = chunk.add_constant(Constant::String("hello world".to_string()));
         chunk.write_op(OpCode::Constant, 1);
-        chunk.write_byte(idx, 1);
+        chunk.write_byte(idx as u8, 1);
 
         let text = disassemble(&chunk, "test").expect("valid bytecode");
         assert!(text.contains("hello world"));
@@ -663,7 +909,7 @@ mod tests {
             chunk: inner_chunk,
         });
         chunk.write_op(OpCode::Closure, 1);
-        chunk.write_byte(fn_idx, 1);
+        chunk.write_u16(fn_idx, 1);
         chunk.write_op(OpCode::Return, 1);
 
         let text = disassemble(&chunk, "test.lox").expect("valid bytecode");
@@ -704,7 +950,7 @@ mod tests {
             chunk: inner_chunk,
         });
         chunk.write_op(OpCode::Closure, 1);
-        chunk.write_byte(fn_idx, 1);
+        chunk.write_u16(fn_idx, 1);
         // upvalue 0: local slot 1
         chunk.write_byte(1, 1);
         chunk.write_byte(1, 1);
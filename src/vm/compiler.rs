@@ -1,6 +1,8 @@
+use std::collections::HashMap;
+
 use crate::ast::*;
 use crate::error::CompileError;
-use crate::vm::chunk::{Chunk, Constant, OpCode};
+use crate::vm::chunk::{Chunk, Constant, OpCode, UNCACHED_SLOT};
 
 #[derive(Debug, Clone)]
 struct Local {
@@ -30,6 +32,9 @@ struct CompilerState {
     upvalues: Vec<Upvalue>,
     scope_depth: i32,
     line: usize,
+    /// Number of property access sites emitted so far; each gets an inline
+    /// cache slot in the VM.
+    property_sites: usize,
 }
 
 impl CompilerState {
@@ -41,6 +46,7 @@ impl CompilerState {
             upvalues: Vec::new(),
             scope_depth: 0,
             line: 1,
+            property_sites: 0,
         };
         // Slot 0 is reserved for 'this' in methods, empty string otherwise
         let slot_name = if function_type == FunctionType::Method
@@ -61,22 +67,58 @@ impl CompilerState {
 
 pub struct Compiler {
     states: Vec<CompilerState>,
+    /// Global variable names in slot order; becomes the script chunk's table.
+    global_names: Vec<String>,
+    global_slots: HashMap<String, u16>,
 }
 
 impl Compiler {
     pub fn new() -> Self {
         Self {
             states: vec![CompilerState::new(FunctionType::Script)],
+            global_names: Vec::new(),
+            global_slots: HashMap::new(),
         }
     }
 
     pub fn compile(mut self, program: &Program) -> Result<Chunk, CompileError> {
         for decl in &program.declarations {
-            self.compile_decl(decl)?;
+            self.compile_decl(&program.exprs, decl)?;
         }
         self.emit_op(OpCode::Nil);
         self.emit_op(OpCode::Return);
-        Ok(self.states.pop().expect("should have script state").chunk)
+        let mut chunk = self.states.pop().expect("should have script state").chunk;
+        chunk.globals = self.global_names;
+        Ok(chunk)
+    }
+
+    /// Allocate the next inline-cache slot for a property access site.
+    /// Sites past the one-byte operand range share the [`UNCACHED_SLOT`]
+    /// sentinel and skip caching instead of failing to compile.
+    fn next_cache_slot(&mut self) -> u8 {
+        let slot = self.current().property_sites;
+        self.current_mut().property_sites += 1;
+        u8::try_from(slot)
+            .ok()
+            .filter(|&slot| slot != UNCACHED_SLOT)
+            .unwrap_or(UNCACHED_SLOT)
+    }
+
+    /// Look up or assign the numeric slot for a global variable name, so
+    /// global opcodes index a flat table instead of hashing names at runtime.
+    /// Slots are 16-bit, matching the wide operand the global opcodes carry.
+    fn global_slot(&mut self, name: &str) -> u16 {
+        if let Some(&slot) = self.global_slots.get(name) {
+            return slot;
+        }
+        let slot: u16 = self
+            .global_names
+            .len()
+            .try_into()
+            .expect("global table overflow (max 65536)");
+        self.global_names.push(name.to_string());
+        self.global_slots.insert(name.to_string(), slot);
+        slot
     }
 
     fn current(&self) -> &CompilerState {
@@ -99,10 +141,21 @@ impl Compiler {
         self.current_mut().chunk.write_byte(byte, line);
     }
 
+    fn emit_u16(&mut self, value: u16) {
+        let line = self.current().line;
+        self.current_mut().chunk.write_u16(value, line);
+    }
+
     fn emit_constant(&mut self, constant: Constant) {
         let idx = self.current_mut().chunk.add_constant(constant);
-        self.emit_op(OpCode::Constant);
-        self.emit_byte(idx);
+        if let Ok(short) = u8::try_from(idx) {
+            self.emit_op(OpCode::Constant);
+            self.emit_byte(short);
+        } else {
+            self.emit_op(OpCode::ConstantLong);
+            let line = self.current().line;
+            self.current_mut().chunk.write_u16(idx, line);
+        }
     }
 
     fn emit_jump(&mut self, op: OpCode) -> usize {
@@ -209,49 +262,44 @@ impl Compiler {
         idx
     }
 
-    fn compile_decl(&mut self, decl: &Decl) -> Result<(), CompileError> {
+    fn compile_decl(&mut self, ast: &ExprArena, decl: &Decl) -> Result<(), CompileError> {
         match decl {
             Decl::Var(v) => {
                 self.current_mut().line = line_from_span(v.span);
-                if let Some(ref init) = v.initializer {
-                    self.compile_expr(init)?;
+                if let Some(init) = v.initializer {
+                    self.compile_expr(ast, init)?;
                 } else {
                     self.emit_op(OpCode::Nil);
                 }
                 if self.current().scope_depth > 0 {
                     self.add_local(v.name.clone());
                 } else {
-                    let idx = self
-                        .current_mut()
-                        .chunk
-                        .add_constant(Constant::String(v.name.clone()));
+                    let slot = self.global_slot(&v.name);
                     self.emit_op(OpCode::DefineGlobal);
-                    self.emit_byte(idx);
+                    self.emit_u16(slot);
                 }
                 Ok(())
             }
             Decl::Fun(f) => {
                 self.current_mut().line = line_from_span(f.span);
-                self.compile_function(&f.function, FunctionType::Function)?;
+                self.compile_function(ast, &f.function, FunctionType::Function)?;
                 if self.current().scope_depth > 0 {
                     self.add_local(f.function.name.clone());
                 } else {
-                    let idx = self
-                        .current_mut()
-                        .chunk
-                        .add_constant(Constant::String(f.function.name.clone()));
+                    let slot = self.global_slot(&f.function.name);
                     self.emit_op(OpCode::DefineGlobal);
-                    self.emit_byte(idx);
+                    self.emit_u16(slot);
                 }
                 Ok(())
             }
-            Decl::Class(c) => self.compile_class(c),
-            Decl::Statement(s) => self.compile_stmt(s),
+            Decl::Class(c) => self.compile_class(ast, c),
+            Decl::Statement(s) => self.compile_stmt(ast, s),
         }
     }
 
     fn compile_function(
         &mut self,
+        ast: &ExprArena,
         function: &Function,
         func_type: FunctionType,
     ) -> Result<(), CompileError> {
@@ -263,7 +311,7 @@ impl Compiler {
         }
 
         for decl in &function.body {
-            self.compile_decl(decl)?;
+            self.compile_decl(ast, decl)?;
         }
 
         // Implicit nil return
@@ -285,7 +333,7 @@ impl Compiler {
         };
         let idx = self.current_mut().chunk.add_constant(func_constant);
         self.emit_op(OpCode::Closure);
-        self.emit_byte(idx);
+        self.emit_u16(idx);
 
         // Emit upvalue info
         for uv in &state.upvalues {
@@ -296,20 +344,21 @@ impl Compiler {
         Ok(())
     }
 
-    fn compile_class(&mut self, class: &ClassDecl) -> Result<(), CompileError> {
+    fn compile_class(&mut self, ast: &ExprArena, class: &ClassDecl) -> Result<(), CompileError> {
         self.current_mut().line = line_from_span(class.span);
         let name_idx = self
             .current_mut()
             .chunk
             .add_constant(Constant::String(class.name.clone()));
         self.emit_op(OpCode::Class);
-        self.emit_byte(name_idx);
+        self.emit_u16(name_idx);
 
         if self.current().scope_depth > 0 {
             self.add_local(class.name.clone());
         } else {
+            let slot = self.global_slot(&class.name);
             self.emit_op(OpCode::DefineGlobal);
-            self.emit_byte(name_idx);
+            self.emit_u16(slot);
         }
 
         if let Some(ref superclass) = class.superclass {
@@ -332,9 +381,9 @@ impl Compiler {
             } else {
                 FunctionType::Method
             };
-            self.compile_function(method, func_type)?;
+            self.compile_function(ast, method, func_type)?;
             self.emit_op(OpCode::Method);
-            self.emit_byte(method_name_idx);
+            self.emit_u16(method_name_idx);
         }
 
         self.emit_op(OpCode::Pop); // Pop the class
@@ -346,23 +395,23 @@ impl Compiler {
         Ok(())
     }
 
-    fn compile_stmt(&mut self, stmt: &Stmt) -> Result<(), CompileError> {
+    fn compile_stmt(&mut self, ast: &ExprArena, stmt: &Stmt) -> Result<(), CompileError> {
         match stmt {
             Stmt::Expression(e) => {
                 self.current_mut().line = line_from_span(e.span);
-                self.compile_expr(&e.expression)?;
+                self.compile_expr(ast, e.expression)?;
                 self.emit_op(OpCode::Pop);
                 Ok(())
             }
             Stmt::Print(p) => {
                 self.current_mut().line = line_from_span(p.span);
-                self.compile_expr(&p.expression)?;
+                self.compile_expr(ast, p.expression)?;
                 self.emit_op(OpCode::Print);
                 Ok(())
             }
             Stmt::Return(r) => {
                 self.current_mut().line = line_from_span(r.span);
-                if let Some(ref val) = r.value {
+                if let Some(val) = r.value {
                     if self.current().function_type == FunctionType::Initializer {
                         return Err(CompileError::resolve(
                             "can't return a value from an initializer",
@@ -370,7 +419,21 @@ impl Compiler {
                             r.span.len,
                         ));
                     }
-                    self.compile_expr(val)?;
+                    // `return f(...)`: compile the callee and arguments, then
+                    // let TailCall reuse the current frame. The Return that
+                    // follows only executes when the callee wasn't a plain
+                    // closure and the VM fell back to an ordinary call.
+                    if let Expr::Call(c) = ast.get(val) {
+                        self.compile_expr(ast, c.callee)?;
+                        for &arg in &c.arguments {
+                            self.compile_expr(ast, arg)?;
+                        }
+                        self.emit_op(OpCode::TailCall);
+                        self.emit_byte(c.arguments.len() as u8);
+                        self.emit_op(OpCode::Return);
+                        return Ok(());
+                    }
+                    self.compile_expr(ast, val)?;
                 } else if self.current().function_type == FunctionType::Initializer {
                     self.emit_op(OpCode::GetLocal);
                     self.emit_byte(0);
@@ -384,33 +447,51 @@ impl Compiler {
                 self.current_mut().line = line_from_span(b.span);
                 self.begin_scope();
                 for decl in &b.declarations {
-                    self.compile_decl(decl)?;
+                    self.compile_decl(ast, decl)?;
                 }
                 self.end_scope();
                 Ok(())
             }
             Stmt::If(i) => {
                 self.current_mut().line = line_from_span(i.span);
-                self.compile_expr(&i.condition)?;
+                // Constant condition: only the branch that can run is
+                // emitted (the condition is literal-only, so dropping it
+                // loses no side effects).
+                if let Some(cond) = fold_constant(ast, i.condition) {
+                    return if literal_truthy(&cond) {
+                        self.compile_stmt(ast, &i.then_branch)
+                    } else if let Some(ref else_branch) = i.else_branch {
+                        self.compile_stmt(ast, else_branch)
+                    } else {
+                        Ok(())
+                    };
+                }
+                self.compile_expr(ast, i.condition)?;
                 let then_jump = self.emit_jump(OpCode::JumpIfFalse);
                 self.emit_op(OpCode::Pop);
-                self.compile_stmt(&i.then_branch)?;
+                self.compile_stmt(ast, &i.then_branch)?;
                 let else_jump = self.emit_jump(OpCode::Jump);
                 self.patch_jump(then_jump);
                 self.emit_op(OpCode::Pop);
                 if let Some(ref else_branch) = i.else_branch {
-                    self.compile_stmt(else_branch)?;
+                    self.compile_stmt(ast, else_branch)?;
                 }
                 self.patch_jump(else_jump);
                 Ok(())
             }
             Stmt::While(w) => {
                 self.current_mut().line = line_from_span(w.span);
+                // A constant-false condition means the body can never run.
+                if let Some(cond) = fold_constant(ast, w.condition)
+                    && !literal_truthy(&cond)
+                {
+                    return Ok(());
+                }
                 let loop_start = self.current().chunk.code.len();
-                self.compile_expr(&w.condition)?;
+                self.compile_expr(ast, w.condition)?;
                 let exit_jump = self.emit_jump(OpCode::JumpIfFalse);
                 self.emit_op(OpCode::Pop);
-                self.compile_stmt(&w.body)?;
+                self.compile_stmt(ast, &w.body)?;
                 self.emit_loop(loop_start);
                 self.patch_jump(exit_jump);
                 self.emit_op(OpCode::Pop);
@@ -419,24 +500,37 @@ impl Compiler {
         }
     }
 
-    fn compile_expr(&mut self, expr: &Expr) -> Result<(), CompileError> {
-        match expr {
+    /// Emit the single instruction (or constant load) producing a literal.
+    fn emit_literal(&mut self, value: &LiteralValue) {
+        match value {
+            LiteralValue::Number(n) => self.emit_constant(Constant::Number(*n)),
+            LiteralValue::String(s) => self.emit_constant(Constant::String(s.clone())),
+            LiteralValue::Bool(true) => self.emit_op(OpCode::True),
+            LiteralValue::Bool(false) => self.emit_op(OpCode::False),
+            LiteralValue::Nil => self.emit_op(OpCode::Nil),
+        }
+    }
+
+    fn compile_expr(&mut self, ast: &ExprArena, id: ExprId) -> Result<(), CompileError> {
+        // Fold first: an operator tree built entirely from literals
+        // compiles to one constant load instead of being re-evaluated on
+        // every run.
+        if !matches!(ast.get(id), Expr::Literal(_))
+            && let Some(value) = fold_constant(ast, id)
+        {
+            self.current_mut().line = line_from_span(ast.get(id).span());
+            self.emit_literal(&value);
+            return Ok(());
+        }
+        match ast.get(id) {
             Expr::Literal(l) => {
                 self.current_mut().line = line_from_span(l.span);
-                match &l.value {
-                    LiteralValue::Number(n) => self.emit_constant(Constant::Number(*n)),
-                    LiteralValue::String(s) => {
-                        self.emit_constant(Constant::String(s.clone()));
-                    }
-                    LiteralValue::Bool(true) => self.emit_op(OpCode::True),
-                    LiteralValue::Bool(false) => self.emit_op(OpCode::False),
-                    LiteralValue::Nil => self.emit_op(OpCode::Nil),
-                }
+                self.emit_literal(&l.value);
                 Ok(())
             }
-            Expr::Grouping(g) => self.compile_expr(&g.expression),
+            Expr::Grouping(g) => self.compile_expr(ast, g.expression),
             Expr::Unary(u) => {
-                self.compile_expr(&u.operand)?;
+                self.compile_expr(ast, u.operand)?;
                 match u.operator {
                     UnaryOp::Negate => self.emit_op(OpCode::Negate),
                     UnaryOp::Not => self.emit_op(OpCode::Not),
@@ -444,8 +538,8 @@ impl Compiler {
                 Ok(())
             }
             Expr::Binary(b) => {
-                self.compile_expr(&b.left)?;
-                self.compile_expr(&b.right)?;
+                self.compile_expr(ast, b.left)?;
+                self.compile_expr(ast, b.right)?;
                 match b.operator {
                     BinaryOp::Add => self.emit_op(OpCode::Add),
                     BinaryOp::Subtract => self.emit_op(OpCode::Subtract),
@@ -475,7 +569,7 @@ impl Compiler {
             }
             Expr::Assign(a) => {
                 self.current_mut().line = line_from_span(a.span);
-                self.compile_expr(&a.value)?;
+                self.compile_expr(ast, a.value)?;
                 if let Some(slot) = self.resolve_local(&a.name) {
                     self.emit_op(OpCode::SetLocal);
                     self.emit_byte(slot);
@@ -483,22 +577,19 @@ impl Compiler {
                     self.emit_op(OpCode::SetUpvalue);
                     self.emit_byte(idx);
                 } else {
-                    let idx = self
-                        .current_mut()
-                        .chunk
-                        .add_constant(Constant::String(a.name.clone()));
+                    let slot = self.global_slot(&a.name);
                     self.emit_op(OpCode::SetGlobal);
-                    self.emit_byte(idx);
+                    self.emit_u16(slot);
                 }
                 Ok(())
             }
             Expr::Logical(l) => {
-                self.compile_expr(&l.left)?;
+                self.compile_expr(ast, l.left)?;
                 match l.operator {
                     LogicalOp::And => {
                         let end_jump = self.emit_jump(OpCode::JumpIfFalse);
                         self.emit_op(OpCode::Pop);
-                        self.compile_expr(&l.right)?;
+                        self.compile_expr(ast, l.right)?;
                         self.patch_jump(end_jump);
                     }
                     LogicalOp::Or => {
@@ -506,40 +597,42 @@ impl Compiler {
                         let end_jump = self.emit_jump(OpCode::Jump);
                         self.patch_jump(else_jump);
                         self.emit_op(OpCode::Pop);
-                        self.compile_expr(&l.right)?;
+                        self.compile_expr(ast, l.right)?;
                         self.patch_jump(end_jump);
                     }
                 }
                 Ok(())
             }
             Expr::Call(c) => {
-                self.compile_expr(&c.callee)?;
-                for arg in &c.arguments {
-                    self.compile_expr(arg)?;
+                self.compile_expr(ast, c.callee)?;
+                for &arg in &c.arguments {
+                    self.compile_expr(ast, arg)?;
                 }
                 self.emit_op(OpCode::Call);
                 self.emit_byte(c.arguments.len() as u8);
                 Ok(())
             }
             Expr::Get(g) => {
-                self.compile_expr(&g.object)?;
+                self.compile_expr(ast, g.object)?;
                 let idx = self
                     .current_mut()
                     .chunk
                     .add_constant(Constant::String(g.name.clone()));
+                let cache_slot = self.next_cache_slot();
                 self.emit_op(OpCode::GetProperty);
-                self.emit_byte(idx);
+                self.emit_u16(idx);
+                self.emit_byte(cache_slot);
                 Ok(())
             }
             Expr::Set(s) => {
-                self.compile_expr(&s.object)?;
-                self.compile_expr(&s.value)?;
+                self.compile_expr(ast, s.object)?;
+                self.compile_expr(ast, s.value)?;
                 let idx = self
                     .current_mut()
                     .chunk
                     .add_constant(Constant::String(s.name.clone()));
                 self.emit_op(OpCode::SetProperty);
-                self.emit_byte(idx);
+                self.emit_u16(idx);
                 Ok(())
             }
             Expr::This(t) => {
@@ -562,7 +655,7 @@ impl Compiler {
                 self.compile_named_variable("this")?;
                 self.compile_named_variable("super")?;
                 self.emit_op(OpCode::GetSuper);
-                self.emit_byte(method_idx);
+                self.emit_u16(method_idx);
                 Ok(())
             }
         }
@@ -576,12 +669,9 @@ impl Compiler {
             self.emit_op(OpCode::GetUpvalue);
             self.emit_byte(idx);
         } else {
-            let idx = self
-                .current_mut()
-                .chunk
-                .add_constant(Constant::String(name.to_string()));
+            let slot = self.global_slot(name);
             self.emit_op(OpCode::GetGlobal);
-            self.emit_byte(idx);
+            self.emit_u16(slot);
         }
         Ok(())
     }
@@ -598,6 +688,72 @@ fn line_from_span(span: crate::scanner::token::Span) -> usize {
     span.offset + 1
 }
 
+/// Evaluate an expression at compile time if it is built entirely from
+/// literals. Mirrors the VM's runtime semantics exactly: only shapes the VM
+/// evaluates without error fold (so `1 + "a"` stays a runtime error, while
+/// division by zero folds to the same infinity the VM would produce), and
+/// `and`/`or` fold through their short-circuit rules.
+fn fold_constant(ast: &ExprArena, id: ExprId) -> Option<LiteralValue> {
+    use BinaryOp::*;
+    use LiteralValue::*;
+    match ast.get(id) {
+        Expr::Literal(l) => Some(l.value.clone()),
+        Expr::Grouping(g) => fold_constant(ast, g.expression),
+        Expr::Unary(u) => match (u.operator, fold_constant(ast, u.operand)?) {
+            (UnaryOp::Negate, Number(n)) => Some(Number(-n)),
+            (UnaryOp::Negate, _) => None,
+            (UnaryOp::Not, v) => Some(Bool(!literal_truthy(&v))),
+        },
+        Expr::Binary(b) => {
+            let left = fold_constant(ast, b.left)?;
+            let right = fold_constant(ast, b.right)?;
+            match (b.operator, left, right) {
+                (Add, Number(a), Number(c)) => Some(Number(a + c)),
+                (Add, String(a), String(c)) => Some(String(a + &c)),
+                (Subtract, Number(a), Number(c)) => Some(Number(a - c)),
+                (Multiply, Number(a), Number(c)) => Some(Number(a * c)),
+                (Divide, Number(a), Number(c)) => Some(Number(a / c)),
+                (Less, Number(a), Number(c)) => Some(Bool(a < c)),
+                (LessEqual, Number(a), Number(c)) => Some(Bool(a <= c)),
+                (Greater, Number(a), Number(c)) => Some(Bool(a > c)),
+                (GreaterEqual, Number(a), Number(c)) => Some(Bool(a >= c)),
+                (Equal, a, c) => Some(Bool(literals_equal(&a, &c))),
+                (NotEqual, a, c) => Some(Bool(!literals_equal(&a, &c))),
+                _ => None,
+            }
+        }
+        Expr::Logical(l) => {
+            let left = fold_constant(ast, l.left)?;
+            let short_circuits = match l.operator {
+                LogicalOp::And => !literal_truthy(&left),
+                LogicalOp::Or => literal_truthy(&left),
+            };
+            if short_circuits {
+                Some(left)
+            } else {
+                fold_constant(ast, l.right)
+            }
+        }
+        _ => None,
+    }
+}
+
+/// Lox truthiness: only `nil` and `false` are falsey.
+fn literal_truthy(value: &LiteralValue) -> bool {
+    !matches!(value, LiteralValue::Nil | LiteralValue::Bool(false))
+}
+
+/// Lox equality over literals; values of different types are never equal.
+fn literals_equal(a: &LiteralValue, b: &LiteralValue) -> bool {
+    match (a, b) {
+        (LiteralValue::Number(x), LiteralValue::Number(y)) => x == y,
+        (LiteralValue::String(x), LiteralValue::String(y)) => x == y,
+        (LiteralValue::Bool(x), LiteralValue::Bool(y)) => x == y,
+        (LiteralValue::Nil, LiteralValue::Nil) => true,
+        _ => false,
+    }
+}
+
 #[cfg(test)]
 mod tests {
     use super::*;
@@ -654,6 +810,59 @@ mod tests {
         assert_eq!(chunk.constants[0], Constant::Number(42.0));
     }
 
+    #[test]
+    fn compile_dedups_repeated_literals() {
+        let chunk = compile("print 1; print 1; print \"hi\"; print \"hi\";").expect("compile");
+        assert_eq!(
+            chunk.constants,
+            vec![Constant::Number(1.0), Constant::String("hi".to_string())]
+        );
+    }
+
+    #[test]
+    fn compile_wide_constants_use_constant_long() {
+        let source: String = (0..300).map(|i| format!("print {i}.5;")).collect();
+        let chunk = compile(&source).expect("compile");
+        assert_eq!(chunk.constants.len(), 300);
+        assert!(has_opcode(&chunk, OpCode::ConstantLong));
+    }
+
+    #[test]
+    fn compile_names_past_byte_index() {
+        // 300 distinct literals crowd the low pool indices before any name
+        // constant is pooled; naming operands are 16-bit, so declarations
+        // and property access still compile.
+        let mut source: String = (0..300).map(|i| format!("print {i}.5;")).collect();
+        source.push_str("fun f() { return 1; } class C { m() { return 2; } } print C().m;");
+        let chunk = compile(&source).expect("compile");
+        assert!(has_opcode(&chunk, OpCode::Closure));
+        assert!(has_opcode(&chunk, OpCode::Class));
+        assert!(has_opcode(&chunk, OpCode::Method));
+        assert!(has_opcode(&chunk, OpCode::GetProperty));
+    }
+
+    #[test]
+    fn compile_globals_past_byte_slot() {
+        // Global slots are 16-bit, so a script with more than 256 top-level
+        // variables compiles instead of overflowing the slot table.
+        let source: String = (0..300).map(|i| format!("var g{i} = {i};")).collect();
+        let chunk = compile(&source).expect("compile");
+        assert_eq!(chunk.globals.len(), 300);
+        assert!(has_opcode(&chunk, OpCode::DefineGlobal));
+    }
+
+    #[test]
+    fn compile_property_sites_past_cache_limit() {
+        // Sites past the one-byte cache range reuse the sentinel slot and
+        // compile instead of overflowing the cache table.
+        let mut source = String::from("class C {} var o = C(); o.f = 1;");
+        for _ in 0..300 {
+            source.push_str("print o.f;");
+        }
+        let chunk = compile(&source).expect("compile");
+        assert!(has_opcode(&chunk, OpCode::GetProperty));
+    }
+
     #[test]
     fn compile_string_literal() {
         let chunk = compile_expr("\"hello\"").expect("compile should succeed");
@@ -687,7 +896,7 @@ mod tests {
 
     #[test]
     fn compile_addition() {
-        let chunk = compile_expr("1 + 2").expect("compile should succeed");
+        let chunk = compile("var a = 1; print a + 2;").expect("compile should succeed");
         assert!(has_opcode(&chunk, OpCode::Add));
         // Should have at least 2 number constants
         let num_constants = chunk
@@ -700,31 +909,31 @@ mod tests {
 
     #[test]
     fn compile_subtraction() {
-        let chunk = compile_expr("5 - 3").expect("compile should succeed");
+        let chunk = compile_expr("a - 3").expect("compile should succeed");
         assert!(has_opcode(&chunk, OpCode::Subtract));
     }
 
     #[test]
     fn compile_multiplication() {
-        let chunk = compile_expr("2 * 3").expect("compile should succeed");
+        let chunk = compile_expr("a * 3").expect("compile should succeed");
         assert!(has_opcode(&chunk, OpCode::Multiply));
     }
 
     #[test]
     fn compile_division() {
-        let chunk = compile_expr("10 / 2").expect("compile should succeed");
+        let chunk = compile_expr("a / 2").expect("compile should succeed");
         assert!(has_opcode(&chunk, OpCode::Divide));
     }
 
     #[test]
     fn compile_negation() {
-        let chunk = compile_expr("-42").expect("compile should succeed");
+        let chunk = compile_expr("-a").expect("compile should succeed");
         assert!(has_opcode(&chunk, OpCode::Negate));
     }
 
     #[test]
     fn compile_not() {
-        let chunk = compile_expr("!true").expect("compile should succeed");
+        let chunk = compile_expr("!a").expect("compile should succeed");
         assert!(has_opcode(&chunk, OpCode::Not));
     }
 
@@ -732,13 +941,13 @@ mod tests {
 
     #[test]
     fn compile_equal() {
-        let chunk = compile_expr("1 == 2").expect("compile should succeed");
+        let chunk = compile_expr("a == 2").expect("compile should succeed");
         assert!(has_opcode(&chunk, OpCode::Equal));
     }
 
     #[test]
     fn compile_not_equal() {
-        let chunk = compile_expr("1 != 2").expect("compile should succeed");
+        let chunk = compile_expr("a != 2").expect("compile should succeed");
         // != is compiled as == followed by Not
         assert!(has_opcode(&chunk, OpCode::Equal));
         assert!(has_opcode(&chunk, OpCode::Not));
@@ -746,13 +955,13 @@ mod tests {
 
     #[test]
     fn compile_less_than() {
-        let chunk = compile_expr("1 < 2").expect("compile should succeed");
+        let chunk = compile_expr("a < 2").expect("compile should succeed");
         assert!(has_opcode(&chunk, OpCode::Less));
     }
 
     #[test]
     fn compile_less_equal() {
-        let chunk = compile_expr("1 <= 2").expect("compile should succeed");
+        let chunk = compile_expr("a <= 2").expect("compile should succeed");
         // <= is compiled as > followed by Not
         assert!(has_opcode(&chunk, OpCode::Greater));
         assert!(has_opcode(&chunk, OpCode::Not));
@@ -760,13 +969,13 @@ mod tests {
 
     #[test]
     fn compile_greater_than() {
-        let chunk = compile_expr("1 > 2").expect("compile should succeed");
+        let chunk = compile_expr("a > 2").expect("compile should succeed");
         assert!(has_opcode(&chunk, OpCode::Greater));
     }
 
     #[test]
     fn compile_greater_equal() {
-        let chunk = compile_expr("1 >= 2").expect("compile should succeed");
+        let chunk = compile_expr("a >= 2").expect("compile should succeed");
         // >= is compiled as < followed by Not
         assert!(has_opcode(&chunk, OpCode::Less));
         assert!(has_opcode(&chunk, OpCode::Not));
@@ -778,13 +987,8 @@ mod tests {
     fn compile_global_variable() {
         let chunk = compile("var x = 42;").expect("compile should succeed");
         assert!(has_opcode(&chunk, OpCode::DefineGlobal));
-        // Should have constant for variable name "x"
-        assert!(
-            chunk
-                .constants
-                .iter()
-                .any(|c| matches!(c, Constant::String(s) if s == "x"))
-        );
+        // Variable name should have a slot in the globals table
+        assert_eq!(chunk.globals, vec!["x"]);
     }
 
     #[test]
@@ -824,14 +1028,14 @@ mod tests {
 
     #[test]
     fn compile_if_statement() {
-        let chunk = compile("if (true) print 1;").expect("compile should succeed");
+        let chunk = compile("if (a) print 1;").expect("compile should succeed");
         assert!(has_opcode(&chunk, OpCode::JumpIfFalse));
         assert!(has_opcode(&chunk, OpCode::Jump));
     }
 
     #[test]
     fn compile_if_else_statement() {
-        let chunk = compile("if (true) print 1; else print 2;").expect("compile should succeed");
+        let chunk = compile("if (a) print 1; else print 2;").expect("compile should succeed");
         // Should have JumpIfFalse for then branch and Jump for else
         assert_eq!(count_opcode(&chunk, OpCode::JumpIfFalse), 1);
         assert_eq!(count_opcode(&chunk, OpCode::Jump), 1);
@@ -846,13 +1050,13 @@ mod tests {
 
     #[test]
     fn compile_logical_and() {
-        let chunk = compile_expr("true and false").expect("compile should succeed");
+        let chunk = compile_expr("a and b").expect("compile should succeed");
         assert!(has_opcode(&chunk, OpCode::JumpIfFalse));
     }
 
     #[test]
     fn compile_logical_or() {
-        let chunk = compile_expr("true or false").expect("compile should succeed");
+        let chunk = compile_expr("a or b").expect("compile should succeed");
         assert!(has_opcode(&chunk, OpCode::JumpIfFalse));
         assert!(has_opcode(&chunk, OpCode::Jump));
     }
@@ -909,6 +1113,132 @@ mod tests {
         }));
     }
 
+    // ========== Tail Calls ==========
+
+    #[test]
+    fn compile_tail_call_in_return_position() {
+        let chunk = compile("fun f(n) { if (n <= 0) return 0; return f(n - 1); }")
+            .expect("compile should succeed");
+        let func_chunk = chunk
+            .constants
+            .iter()
+            .find_map(|c| match c {
+                Constant::Function { chunk, .. } => Some(chunk),
+                _ => None,
+            })
+            .expect("function constant");
+        assert!(has_opcode(func_chunk, OpCode::TailCall));
+    }
+
+    #[test]
+    fn compile_non_tail_call_stays_ordinary() {
+        // The recursive call feeds an addition, so it is not in tail position.
+        let chunk = compile("fun g(n) { return g(n - 1) + 0; }").expect("compile should succeed");
+        let func_chunk = chunk
+            .constants
+            .iter()
+            .find_map(|c| match c {
+                Constant::Function { chunk, .. } => Some(chunk),
+                _ => None,
+            })
+            .expect("function constant");
+        assert!(has_opcode(func_chunk, OpCode::Call));
+        assert!(!has_opcode(func_chunk, OpCode::TailCall));
+    }
+
+    // ========== Constant Folding ==========
+
+    #[test]
+    fn folds_constant_arithmetic_to_one_constant() {
+        let chunk = compile_expr("1 + 2 * 3").expect("compile should succeed");
+        assert!(!has_opcode(&chunk, OpCode::Add));
+        assert!(!has_opcode(&chunk, OpCode::Multiply));
+        assert_eq!(chunk.constants, vec![Constant::Number(7.0)]);
+    }
+
+    #[test]
+    fn folds_string_concatenation() {
+        let chunk = compile_expr("\"con\" + \"fig\"").expect("compile should succeed");
+        assert!(!has_opcode(&chunk, OpCode::Add));
+        assert_eq!(
+            chunk.constants,
+            vec![Constant::String("config".to_string())]
+        );
+    }
+
+    #[test]
+    fn folds_constant_comparison_to_bool() {
+        let chunk = compile_expr("1 < 2").expect("compile should succeed");
+        assert!(!has_opcode(&chunk, OpCode::Less));
+        assert!(has_opcode(&chunk, OpCode::True));
+    }
+
+    #[test]
+    fn folds_short_circuit_logic() {
+        // `and` short-circuits on a constant-false left side, so the right
+        // side is never compiled at all.
+        let chunk = compile_expr("false and someGlobal").expect("compile should succeed");
+        assert!(!has_opcode(&chunk, OpCode::GetGlobal));
+        assert!(has_opcode(&chunk, OpCode::False));
+    }
+
+    #[test]
+    fn mixed_type_add_is_left_for_runtime() {
+        // `1 + "a"` is a runtime error in the VM; folding must not hide it.
+        let chunk = compile_expr("1 + \"a\"").expect("compile should succeed");
+        assert!(has_opcode(&chunk, OpCode::Add));
+    }
+
+    #[test]
+    fn drops_constant_false_branch() {
+        let chunk =
+            compile("if (false) print \"dead\"; print \"live\";").expect("compile should succeed");
+        assert!(!has_opcode(&chunk, OpCode::JumpIfFalse));
+        assert!(
+            !chunk
+                .constants
+                .iter()
+                .any(|c| matches!(c, Constant::String(s) if s == "dead"))
+        );
+        assert!(
+            chunk
+                .constants
+                .iter()
+                .any(|c| matches!(c, Constant::String(s) if s == "live"))
+        );
+    }
+
+    #[test]
+    fn keeps_only_taken_branch_of_constant_if() {
+        let chunk = compile("if (1 < 2) print \"then\"; else print \"else\";")
+            .expect("compile should succeed");
+        assert!(!has_opcode(&chunk, OpCode::Jump));
+        assert!(
+            chunk
+                .constants
+                .iter()
+                .any(|c| matches!(c, Constant::String(s) if s == "then"))
+        );
+        assert!(
+            !chunk
+                .constants
+                .iter()
+                .any(|c| matches!(c, Constant::String(s) if s == "else"))
+        );
+    }
+
+    #[test]
+    fn drops_while_with_constant_false_condition() {
+        let chunk = compile("while (false) print \"dead\";").expect("compile should succeed");
+        assert!(!has_opcode(&chunk, OpCode::Loop));
+        assert!(
+            !chunk
+                .constants
+                .iter()
+                .any(|c| matches!(c, Constant::String(s) if s == "dead"))
+        );
+    }
+
     // ========== Closures ==========
 
     #[test]
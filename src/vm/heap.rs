@@ -0,0 +1,249 @@
+//! Mark-sweep garbage collector backing the VM's object heap.
+//!
+//! All [`VmObject`]s are allocated through [`Heap::alloc`], which hands back
+//! a plain [`ObjRef`] pointer handle. The VM calls [`Heap::collect`] at
+//! instruction boundaries in the dispatch loop — the only points where every
+//! live value is reachable from the VM roots (stack, call frames, globals,
+//! open upvalues) — passing those roots as the initial gray set. The intern
+//! table is weak, not a root: entries whose string died this cycle are
+//! dropped between mark and sweep so runtime-produced strings don't pin
+//! memory. Collection marks everything reachable, frees the rest, and
+//! doubles the allocation threshold so GC cost stays proportional to live
+//! data.
+
+use std::cell::Cell;
+use std::collections::HashMap;
+use std::time::{Duration, Instant};
+
+use crate::vm::value::{GcObject, ObjRef, VmObject, VmUpvalue};
+
+/// Allocations before the first collection; also the threshold floor.
+const INITIAL_THRESHOLD: usize = 1024;
+
+/// Collector counters for monitoring, exposed via `Vm::gc_stats`.
+#[derive(Debug, Default, Clone)]
+pub struct GcStats {
+    pub collections: usize,
+    pub objects_freed: usize,
+    pub last_pause: Duration,
+    pub total_pause: Duration,
+}
+
+/// The VM-owned object heap.
+#[derive(Debug)]
+pub struct Heap {
+    /// Every live allocation; swept in place during collection.
+    objects: Vec<ObjRef>,
+    /// Object count that triggers the next collection.
+    next_gc: usize,
+    pub stats: GcStats,
+}
+
+impl Heap {
+    pub fn new() -> Self {
+        Self {
+            objects: Vec::new(),
+            next_gc: INITIAL_THRESHOLD,
+            stats: GcStats::default(),
+        }
+    }
+
+    /// Move `obj` onto the heap and return its handle.
+    pub fn alloc(&mut self, obj: VmObject) -> ObjRef {
+        let gc = Box::new(GcObject {
+            marked: Cell::new(false),
+            obj,
+        });
+        let handle = ObjRef(Box::into_raw(gc));
+        self.objects.push(handle);
+        handle
+    }
+
+    /// Whether allocation has crossed the collection threshold. The VM
+    /// checks this at dispatch-loop boundaries, never mid-handler.
+    pub fn should_collect(&self) -> bool {
+        self.objects.len() >= self.next_gc
+    }
+
+    pub fn object_count(&self) -> usize {
+        self.objects.len()
+    }
+
+    /// Collect garbage, starting the mark phase from `gray` (the VM roots).
+    /// `strings` is the VM's intern table, treated as a weak map: entries
+    /// left unmarked after tracing are removed before the sweep frees them.
+    pub fn collect(&mut self, mut gray: Vec<ObjRef>, strings: &mut HashMap<String, ObjRef>) {
+        let start = Instant::now();
+
+        // Mark: standard tricolor worklist. An object on `gray` may already
+        // be marked (roots can alias); skip it so each object is traced once.
+        while let Some(obj) = gray.pop() {
+            if obj.is_marked() {
+                continue;
+            }
+            obj.set_marked(true);
+            trace_children(obj, &mut gray);
+        }
+
+        // The intern table must not keep dead strings alive, or every
+        // concatenation result would be pinned for the VM's lifetime. Drop
+        // entries the mark phase didn't reach; they are re-interned on the
+        // next sighting.
+        strings.retain(|_, obj| obj.is_marked());
+
+        // Sweep: free everything unmarked, clear marks on survivors.
+        let before = self.objects.len();
+        self.objects.retain(|&obj| {
+            if obj.is_marked() {
+                obj.set_marked(false);
+                true
+            } else {
+                // Safety: the object is unreachable from the roots, so no
+                // handle to it survives this collection.
+                drop(unsafe { Box::from_raw(obj.0 as *mut GcObject) });
+                false
+            }
+        });
+
+        self.next_gc = (self.objects.len() * 2).max(INITIAL_THRESHOLD);
+        self.stats.collections += 1;
+        self.stats.objects_freed += before - self.objects.len();
+        self.stats.last_pause = start.elapsed();
+        self.stats.total_pause += self.stats.last_pause;
+    }
+}
+
+impl Default for Heap {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl Drop for Heap {
+    fn drop(&mut self) {
+        for obj in self.objects.drain(..) {
+            // Safety: the heap owns every allocation; dropping the VM drops
+            // all handles with it.
+            drop(unsafe { Box::from_raw(obj.0 as *mut GcObject) });
+        }
+    }
+}
+
+/// Push every object directly reachable from `obj` onto the gray worklist.
+fn trace_children(obj: ObjRef, gray: &mut Vec<ObjRef>) {
+    match obj.get() {
+        VmObject::String(_) | VmObject::NativeFunction(_) => {}
+        VmObject::Closure(closure) => {
+            gray.extend_from_slice(&closure.upvalues);
+            // Inline caches hold class/method handles that must stay live.
+            for cache in closure.function.caches.borrow().iter() {
+                gray.extend(cache.entries());
+            }
+        }
+        VmObject::Class(class) => {
+            gray.extend(class.borrow().methods.values().copied());
+        }
+        VmObject::Instance(instance) => {
+            let instance = instance.borrow();
+            gray.push(instance.class);
+            gray.extend(instance.fields.values().filter_map(|v| v.as_obj()));
+        }
+        VmObject::BoundMethod(bound) => {
+            gray.extend(bound.receiver.as_obj());
+            gray.push(bound.method);
+        }
+        VmObject::Upvalue(upvalue) => {
+            if let VmUpvalue::Closed(value) = upvalue.get() {
+                gray.extend(value.as_obj());
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn collect_frees_unreachable_objects() {
+        let mut heap = Heap::new();
+        let live = heap.alloc(VmObject::String("live".to_string()));
+        heap.alloc(VmObject::String("dead".to_string()));
+        assert_eq!(heap.object_count(), 2);
+
+        heap.collect(vec![live], &mut HashMap::new());
+
+        assert_eq!(heap.object_count(), 1);
+        assert_eq!(heap.stats.objects_freed, 1);
+        assert_eq!(heap.stats.collections, 1);
+        assert!(matches!(live.get(), VmObject::String(s) if s == "live"));
+        assert!(!live.is_marked(), "marks are cleared after sweep");
+    }
+
+    #[test]
+    fn collect_drops_dead_intern_entries() {
+        let mut heap = Heap::new();
+        let live = heap.alloc(VmObject::String("live".to_string()));
+        let dead = heap.alloc(VmObject::String("dead".to_string()));
+        let mut strings = HashMap::from([("live".to_string(), live), ("dead".to_string(), dead)]);
+
+        // The table itself is not a root; only "live" survives through it.
+        heap.collect(vec![live], &mut strings);
+
+        assert_eq!(heap.object_count(), 1);
+        assert_eq!(strings.len(), 1);
+        assert!(strings.contains_key("live"));
+    }
+
+    #[test]
+    fn collect_traces_through_instances() {
+        use std::cell::RefCell;
+        use std::collections::HashMap;
+
+        use crate::vm::value::{VmClass, VmInstance, VmValue};
+
+        let mut heap = Heap::new();
+        let class = heap.alloc(VmObject::Class(RefCell::new(VmClass {
+            name: "Node".to_string(),
+            methods: HashMap::new(),
+        })));
+        let field = heap.alloc(VmObject::String("payload".to_string()));
+        let instance = heap.alloc(VmObject::Instance(RefCell::new(VmInstance {
+            class,
+            fields: HashMap::from([("data".to_string(), VmValue::from_obj(field))]),
+        })));
+
+        // Only the instance is a root; its class and field must survive.
+        heap.collect(vec![instance], &mut HashMap::new());
+        assert_eq!(heap.object_count(), 3);
+        assert_eq!(heap.stats.objects_freed, 0);
+    }
+
+    #[test]
+    fn collect_frees_cycles() {
+        use std::cell::RefCell;
+        use std::collections::HashMap;
+
+        use crate::vm::value::{VmClass, VmInstance, VmValue};
+
+        let mut heap = Heap::new();
+        let class = heap.alloc(VmObject::Class(RefCell::new(VmClass {
+            name: "Node".to_string(),
+            methods: HashMap::new(),
+        })));
+        let instance = heap.alloc(VmObject::Instance(RefCell::new(VmInstance {
+            class,
+            fields: HashMap::new(),
+        })));
+        // Self-referential cycle that reference counting could never free.
+        if let VmObject::Instance(cell) = instance.get() {
+            cell.borrow_mut()
+                .fields
+                .insert("next".to_string(), VmValue::from_obj(instance));
+        }
+
+        heap.collect(vec![], &mut HashMap::new());
+        assert_eq!(heap.object_count(), 0);
+        assert_eq!(heap.stats.objects_freed, 2);
+    }
+}
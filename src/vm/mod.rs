@@ -1,14 +1,85 @@
+pub mod blox;
 pub mod chunk;
 pub mod compiler;
+pub mod heap;
+pub mod optimizer;
+pub mod profiler;
+pub mod value;
 #[allow(clippy::module_inception)]
 pub mod vm;
 
+use std::sync::Arc;
+
 use crate::error::{CompileError, RuntimeError};
 use crate::parser::Parser;
 use crate::scanner;
+use crate::vm::chunk::{Chunk, Constant};
 use crate::vm::compiler::Compiler;
+use crate::vm::value::NativeFn;
 use crate::vm::vm::Vm;
 
+/// An immutable compiled program that any number of [`Vm`] instances can
+/// execute without copying — including VMs on different threads, since it
+/// is plain data. Precomputes what `Vm::interpret` otherwise derives per
+/// run: the string constants to intern and the globals slots backed by
+/// native functions. Embedders that build a fresh VM per request for
+/// isolation compile once, wrap the program in an [`Arc`], and hand it to
+/// each VM via [`Vm::interpret_program`].
+pub struct CompiledProgram {
+    /// The script chunk, shared into each VM's script function.
+    pub(crate) chunk: Arc<Chunk>,
+    /// Distinct string constants from the whole chunk tree, collected once
+    /// so each VM interns them without re-walking nested functions.
+    pub(crate) strings: Vec<String>,
+    /// Globals slots whose names match built-in native functions.
+    pub(crate) natives: Vec<(usize, NativeFn)>,
+}
+
+impl CompiledProgram {
+    pub fn new(chunk: Chunk) -> Self {
+        let mut strings = Vec::new();
+        collect_strings(&chunk, &mut strings);
+        strings.sort();
+        strings.dedup();
+        let natives = chunk
+            .globals
+            .iter()
+            .enumerate()
+            .filter_map(|(slot, name)| {
+                let native = match name.as_str() {
+                    "clock" => NativeFn::Clock,
+                    "readLine" => NativeFn::ReadLine,
+                    "toNumber" => NativeFn::ToNumber,
+                    _ => return None,
+                };
+                Some((slot, native))
+            })
+            .collect();
+        Self {
+            chunk: Arc::new(chunk),
+            strings,
+            natives,
+        }
+    }
+
+    /// Compile source straight to a shareable program.
+    pub fn from_source(source: &str) -> Result<Self, CompileError> {
+        compile_to_chunk(source).map(Self::new)
+    }
+}
+
+/// Collect every string constant in a chunk tree, recursing into function
+/// constants.
+fn collect_strings(chunk: &Chunk, out: &mut Vec<String>) {
+    for constant in &chunk.constants {
+        match constant {
+            Constant::String(s) => out.push(s.clone()),
+            Constant::Function { chunk, .. } => collect_strings(chunk, out),
+            Constant::Number(_) => {}
+        }
+    }
+}
+
 /// Interpret source code via the bytecode VM.
 /// Returns RuntimeError for execution errors.
 /// Compile errors are converted to RuntimeError for simplicity.
@@ -31,9 +102,10 @@ pub fn interpret_vm(source: &str) -> Result<(), RuntimeError> {
                 .to_string(),
         )
     })?;
-    let chunk = Compiler::new()
+    let mut chunk = Compiler::new()
         .compile(&program)
         .map_err(|e| RuntimeError::new(e.to_string()))?;
+    optimizer::optimize(&mut chunk);
     let mut vm = Vm::new();
     vm.interpret(chunk)
 }
@@ -45,5 +117,7 @@ pub fn compile_to_chunk(source: &str) -> Result<chunk::Chunk, CompileError> {
     let program = Parser::new(tokens)
         .parse()
         .map_err(|errors| errors.into_iter().next().expect("at least one error"))?;
-    Compiler::new().compile(&program)
+    let mut chunk = Compiler::new().compile(&program)?;
+    optimizer::optimize(&mut chunk);
+    Ok(chunk)
 }
@@ -0,0 +1,312 @@
+//! Peephole optimizer for compiled bytecode.
+//!
+//! Runs over a [`Chunk`] after compilation (and before `.blox`
+//! serialization), rewriting short instruction sequences the compiler
+//! emits naively:
+//!
+//! - inverted comparisons: `less; not` becomes `greater_equal` (and the
+//!   `greater`/`equal` analogues), dropping a dispatch per comparison
+//! - comparison-then-branch: `less; jump_if_false` fuses into
+//!   `less_jump_if_false` (and the `greater`/`equal` analogues), the hot
+//!   exit test of every counted loop
+//! - local-plus-constant: `get_local; constant; add` fuses into
+//!   `local_add_constant`, the usual `i + 1` increment shape
+//!
+//! Fused instructions leave the stack exactly as the original sequence
+//! did, so surrounding code (including the `pop` after a branch) is
+//! unaffected. Rewrites never span a jump target: an instruction that
+//! control flow can land on stays the head of its sequence.
+
+use std::collections::{HashMap, HashSet};
+
+use crate::vm::chunk::{Chunk, Constant, LineTable, OpCode};
+
+/// A decoded instruction, tracked by its original byte offset so jump
+/// targets can be re-resolved after rewrites change the layout.
+struct Instr {
+    op: OpCode,
+    operands: Vec<u8>,
+    line: usize,
+    offset: usize,
+    /// Absolute original target offset for jump/loop instructions.
+    target: Option<usize>,
+}
+
+/// Optimize a chunk in place, recursing into function constants.
+pub fn optimize(chunk: &mut Chunk) {
+    for constant in &mut chunk.constants {
+        if let Constant::Function { chunk, .. } = constant {
+            optimize(chunk);
+        }
+    }
+
+    let mut instrs = decode(chunk);
+    let targets: HashSet<usize> = instrs.iter().filter_map(|i| i.target).collect();
+    while rewrite_pass(&mut instrs, &targets) {}
+    encode(chunk, &instrs);
+}
+
+/// Decode the chunk's code into an instruction list.
+fn decode(chunk: &Chunk) -> Vec<Instr> {
+    let mut instrs = Vec::new();
+    let mut offset = 0;
+    while offset < chunk.code.len() {
+        let op = OpCode::try_from(chunk.code[offset]).expect("compiler emits valid opcodes");
+        let len = operand_len(op, chunk, offset);
+        let operands = chunk.code[offset + 1..offset + 1 + len].to_vec();
+        let target = match op {
+            OpCode::Jump
+            | OpCode::JumpIfFalse
+            | OpCode::LessJumpIfFalse
+            | OpCode::GreaterJumpIfFalse
+            | OpCode::EqualJumpIfFalse => Some(offset + 3 + chunk.read_u16(offset + 1) as usize),
+            OpCode::Loop => Some(offset + 3 - chunk.read_u16(offset + 1) as usize),
+            _ => None,
+        };
+        instrs.push(Instr {
+            op,
+            operands,
+            line: chunk.lines.line_at(offset).unwrap_or(0),
+            offset,
+            target,
+        });
+        offset += 1 + len;
+    }
+    instrs
+}
+
+/// Number of operand bytes following the opcode at `offset`.
+fn operand_len(op: OpCode, chunk: &Chunk, offset: usize) -> usize {
+    match op {
+        OpCode::Constant
+        | OpCode::GetLocal
+        | OpCode::SetLocal
+        | OpCode::GetUpvalue
+        | OpCode::SetUpvalue
+        | OpCode::Call
+        | OpCode::TailCall => 1,
+        // Naming opcodes carry 16-bit pool indices; global opcodes carry
+        // 16-bit slot indices.
+        OpCode::ConstantLong
+        | OpCode::GetGlobal
+        | OpCode::SetGlobal
+        | OpCode::DefineGlobal
+        | OpCode::SetProperty
+        | OpCode::GetSuper
+        | OpCode::Class
+        | OpCode::Method
+        | OpCode::Jump
+        | OpCode::JumpIfFalse
+        | OpCode::Loop
+        | OpCode::LocalAddConstant
+        | OpCode::LessJumpIfFalse
+        | OpCode::GreaterJumpIfFalse
+        | OpCode::EqualJumpIfFalse => 2,
+        // 16-bit name index plus a cache-slot or argument-count byte.
+        OpCode::GetProperty | OpCode::Invoke | OpCode::SuperInvoke => 3,
+        OpCode::Closure => {
+            let idx = chunk.read_u16(offset + 1) as usize;
+            match &chunk.constants[idx] {
+                Constant::Function { upvalue_count, .. } => 2 + 2 * upvalue_count,
+                other => panic!("closure operand must be a function constant, got {other}"),
+            }
+        }
+        _ => 0,
+    }
+}
+
+/// Apply one round of rewrites; returns true if anything changed.
+fn rewrite_pass(instrs: &mut Vec<Instr>, targets: &HashSet<usize>) -> bool {
+    let mut changed = false;
+    let mut i = 0;
+    while i < instrs.len() {
+        // Inner instructions of a fused sequence must not be jump targets.
+        let fusable = |j: usize| j < instrs.len() && !targets.contains(&instrs[j].offset);
+
+        // compare; not  =>  inverted compare
+        if fusable(i + 1) && instrs[i + 1].op == OpCode::Not {
+            let inverted = match instrs[i].op {
+                OpCode::Less => Some(OpCode::GreaterEqual),
+                OpCode::Greater => Some(OpCode::LessEqual),
+                OpCode::Equal => Some(OpCode::NotEqual),
+                _ => None,
+            };
+            if let Some(op) = inverted {
+                instrs[i].op = op;
+                instrs.remove(i + 1);
+                changed = true;
+                continue;
+            }
+        }
+
+        // compare; jump_if_false  =>  fused compare-and-branch
+        if fusable(i + 1) && instrs[i + 1].op == OpCode::JumpIfFalse {
+            let fused = match instrs[i].op {
+                OpCode::Less => Some(OpCode::LessJumpIfFalse),
+                OpCode::Greater => Some(OpCode::GreaterJumpIfFalse),
+                OpCode::Equal => Some(OpCode::EqualJumpIfFalse),
+                _ => None,
+            };
+            if let Some(op) = fused {
+                let jump = instrs.remove(i + 1);
+                instrs[i].op = op;
+                instrs[i].operands = jump.operands;
+                instrs[i].target = jump.target;
+                changed = true;
+                continue;
+            }
+        }
+
+        // get_local; constant; add  =>  local_add_constant
+        if fusable(i + 1)
+            && fusable(i + 2)
+            && instrs[i].op == OpCode::GetLocal
+            && instrs[i + 1].op == OpCode::Constant
+            && instrs[i + 2].op == OpCode::Add
+        {
+            let idx = instrs[i + 1].operands[0];
+            instrs[i].op = OpCode::LocalAddConstant;
+            instrs[i].operands.push(idx);
+            instrs.remove(i + 2);
+            instrs.remove(i + 1);
+            changed = true;
+            continue;
+        }
+
+        i += 1;
+    }
+    changed
+}
+
+/// Re-emit the instruction list into the chunk, re-resolving jump operands
+/// against the new layout.
+fn encode(chunk: &mut Chunk, instrs: &[Instr]) {
+    // First pass: lay out new offsets and map original offsets to them.
+    let mut new_offsets = Vec::with_capacity(instrs.len());
+    let mut offset_map = HashMap::new();
+    let mut offset = 0;
+    for instr in instrs {
+        new_offsets.push(offset);
+        offset_map.insert(instr.offset, offset);
+        offset += 1 + instr.operands.len();
+    }
+
+    let mut code = Vec::with_capacity(offset);
+    let mut lines = LineTable::default();
+    for (instr, &new_offset) in instrs.iter().zip(&new_offsets) {
+        code.push(instr.op as u8);
+        lines.push(instr.line);
+        if let Some(target) = instr.target {
+            let new_target = *offset_map
+                .get(&target)
+                .expect("jump target on instruction boundary");
+            let jump = if instr.op == OpCode::Loop {
+                new_offset + 3 - new_target
+            } else {
+                new_target - (new_offset + 3)
+            };
+            let jump = u16::try_from(jump).expect("jump fits in u16 after rewriting");
+            code.push((jump >> 8) as u8);
+            code.push((jump & 0xff) as u8);
+            lines.push(instr.line);
+            lines.push(instr.line);
+        } else {
+            code.extend_from_slice(&instr.operands);
+            for _ in 0..instr.operands.len() {
+                lines.push(instr.line);
+            }
+        }
+    }
+    chunk.code = code;
+    chunk.lines = lines;
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::parser::Parser;
+    use crate::scanner;
+    use crate::vm::compiler::Compiler;
+    use crate::vm::vm::Vm;
+
+    fn compile(source: &str) -> Chunk {
+        let tokens = scanner::scan(source).expect("scan should succeed");
+        let program = Parser::new(tokens).parse().expect("parse should succeed");
+        Compiler::new().compile(&program).expect("compile")
+    }
+
+    fn run(chunk: Chunk) -> Vec<String> {
+        let mut vm = Vm::new_capturing();
+        vm.interpret(chunk).expect("interpret");
+        vm.output().to_vec()
+    }
+
+    fn count_opcode(chunk: &Chunk, op: OpCode) -> usize {
+        let mut count = 0;
+        let mut offset = 0;
+        while offset < chunk.code.len() {
+            let cur = OpCode::try_from(chunk.code[offset]).expect("valid opcode");
+            if cur == op {
+                count += 1;
+            }
+            offset += 1 + operand_len(cur, chunk, offset);
+        }
+        count
+    }
+
+    #[test]
+    fn fuses_comparison_with_branch() {
+        let mut chunk = compile(
+            "var total = 0; for (var i = 0; i < 5; i = i + 1) { total = total + i; } print total;",
+        );
+        optimize(&mut chunk);
+        assert_eq!(count_opcode(&chunk, OpCode::Less), 0);
+        assert!(count_opcode(&chunk, OpCode::LessJumpIfFalse) > 0);
+        assert_eq!(run(chunk), vec!["10"]);
+    }
+
+    #[test]
+    fn rewrites_inverted_comparisons() {
+        // Variable operands: constant comparisons fold away in the compiler
+        // before this peephole ever sees them.
+        let mut chunk = compile("var a = 1; var b = 2; print a >= b; print b <= a; print a != a;");
+        optimize(&mut chunk);
+        assert_eq!(count_opcode(&chunk, OpCode::Not), 0);
+        assert_eq!(count_opcode(&chunk, OpCode::GreaterEqual), 1);
+        assert_eq!(count_opcode(&chunk, OpCode::LessEqual), 1);
+        assert_eq!(count_opcode(&chunk, OpCode::NotEqual), 1);
+        assert_eq!(run(chunk), vec!["false", "false", "false"]);
+    }
+
+    #[test]
+    fn fuses_local_constant_add() {
+        let source = "fun next(i) { return i + 1; } print next(41);";
+        let mut chunk = compile(source);
+        optimize(&mut chunk);
+        let fused = chunk.constants.iter().any(|c| {
+            matches!(c, Constant::Function { chunk, .. }
+                if count_opcode(chunk, OpCode::LocalAddConstant) > 0)
+        });
+        assert!(fused, "expected local_add_constant inside next()");
+        assert_eq!(run(chunk), vec!["42"]);
+    }
+
+    #[test]
+    fn string_concat_still_works_through_fused_add() {
+        let mut chunk = compile("fun greet(name) { return name + \"!\"; } print greet(\"hi\");");
+        optimize(&mut chunk);
+        assert_eq!(run(chunk), vec!["hi!"]);
+    }
+
+    #[test]
+    fn optimized_output_matches_unoptimized() {
+        let source = r#"
+            fun fib(n) { if (n <= 1) return n; return fib(n - 1) + fib(n - 2); }
+            for (var i = 0; i < 10; i = i + 1) { print fib(i); }
+        "#;
+        let plain = run(compile(source));
+        let mut chunk = compile(source);
+        optimize(&mut chunk);
+        assert_eq!(run(chunk), plain);
+    }
+}
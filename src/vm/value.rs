@@ -0,0 +1,395 @@
+//! NaN-boxed runtime values for the bytecode VM.
+//!
+//! Every value is packed into a single `u64` so a stack slot is 8 bytes:
+//! numbers are stored as their raw IEEE-754 bits, `nil`/`true`/`false` are
+//! quiet-NaN bit patterns, and heap objects are a 48-bit [`ObjRef`] handle
+//! tagged with the sign bit. Objects live on the VM-owned garbage-collected
+//! heap (see `src/vm/heap.rs`), so values are plain `Copy` words — no
+//! reference counting on the hot path.
+
+use std::cell::{Cell, RefCell};
+use std::collections::HashMap;
+use std::rc::Rc;
+use std::sync::Arc;
+
+use crate::vm::chunk::Chunk;
+
+/// Quiet-NaN mask: exponent bits all set plus the two high mantissa bits.
+/// Any `u64` with these bits set cannot be produced by real arithmetic,
+/// which frees the remaining bits for tags and pointers.
+const QNAN: u64 = 0x7ffc_0000_0000_0000;
+const SIGN_BIT: u64 = 0x8000_0000_0000_0000;
+/// Low 48 bits: the payload pointer for object values.
+const PTR_MASK: u64 = 0x0000_ffff_ffff_ffff;
+
+const TAG_NIL: u64 = 1;
+const TAG_FALSE: u64 = 2;
+const TAG_TRUE: u64 = 3;
+
+/// A heap cell: the object payload plus its GC mark bit.
+#[derive(Debug)]
+pub struct GcObject {
+    pub(crate) marked: Cell<bool>,
+    pub(crate) obj: VmObject,
+}
+
+/// Handle to a heap-allocated [`VmObject`], managed by the VM's mark-sweep
+/// collector. Copying a handle is free; the collector keeps an object alive
+/// exactly as long as some VM root (stack, frames, globals, open upvalues,
+/// intern table) can still reach it, so handles must not be stashed outside
+/// the VM across a collection.
+#[derive(Debug, Clone, Copy)]
+pub struct ObjRef(pub(crate) *const GcObject);
+
+impl ObjRef {
+    pub fn get(&self) -> &VmObject {
+        // Safety: the heap only frees objects unreachable from the VM roots,
+        // and handles are never used after their object becomes unreachable
+        // (see the type-level invariant above).
+        unsafe { &(*self.0).obj }
+    }
+
+    pub(crate) fn is_marked(&self) -> bool {
+        // Safety: see get()
+        unsafe { (*self.0).marked.get() }
+    }
+
+    pub(crate) fn set_marked(&self, marked: bool) {
+        // Safety: see get()
+        unsafe { (*self.0).marked.set(marked) }
+    }
+}
+
+/// Handles compare by identity.
+impl PartialEq for ObjRef {
+    fn eq(&self, other: &Self) -> bool {
+        std::ptr::eq(self.0, other.0)
+    }
+}
+
+impl Eq for ObjRef {}
+
+/// A NaN-boxed VM value: number, `nil`, boolean, or [`ObjRef`] handle.
+#[derive(Clone, Copy)]
+pub struct VmValue(u64);
+
+/// Heap-allocated payload behind an object [`VmValue`].
+#[derive(Debug)]
+pub enum VmObject {
+    String(String),
+    Closure(VmClosure),
+    NativeFunction(NativeFn),
+    Class(RefCell<VmClass>),
+    Instance(RefCell<VmInstance>),
+    BoundMethod(VmBoundMethod),
+    /// A captured variable, shared between closures and `Vm::open_upvalues`.
+    /// A `Cell` rather than a `RefCell`: `VmUpvalue` is a `Copy` word pair,
+    /// so reads and writes are plain loads/stores with no borrow-flag
+    /// bookkeeping on the hot get/set-upvalue path.
+    Upvalue(Cell<VmUpvalue>),
+}
+
+#[derive(Debug)]
+pub struct VmFunction {
+    pub name: String,
+    pub arity: usize,
+    #[allow(dead_code)]
+    pub upvalue_count: usize,
+    /// Bytecode is immutable once compiled, so it is shared, not owned:
+    /// `Arc` (rather than `Rc`) lets a [`crate::vm::CompiledProgram`] hand
+    /// the same chunk to VMs on different threads.
+    pub chunk: Arc<Chunk>,
+    /// Inline caches for this function's property/method access sites,
+    /// indexed by the cache-slot operand the compiler assigns per site.
+    /// Grown lazily on first use.
+    pub caches: RefCell<Vec<PropertyCache>>,
+}
+
+/// A polymorphic inline cache for one property access site: (class, method)
+/// pairs keyed on receiver class identity, most recently used first.
+#[derive(Debug, Clone, Default)]
+pub struct PropertyCache {
+    entries: Vec<(ObjRef, ObjRef)>,
+}
+
+impl PropertyCache {
+    /// Entries kept per site before the oldest is evicted.
+    const POLY_LIMIT: usize = 4;
+
+    pub fn lookup(&self, class: ObjRef) -> Option<ObjRef> {
+        self.entries
+            .iter()
+            .find(|&&(cached, _)| cached == class)
+            .map(|&(_, method)| method)
+    }
+
+    pub fn fill(&mut self, class: ObjRef, method: ObjRef) {
+        if self.entries.len() == Self::POLY_LIMIT {
+            self.entries.pop();
+        }
+        self.entries.insert(0, (class, method));
+    }
+
+    /// Cached classes and methods, for GC tracing.
+    pub(crate) fn entries(&self) -> impl Iterator<Item = ObjRef> + '_ {
+        self.entries.iter().flat_map(|&(c, m)| [c, m])
+    }
+}
+
+#[derive(Debug)]
+pub struct VmClosure {
+    pub function: Rc<VmFunction>,
+    /// Each entry is a `VmObject::Upvalue`. A boxed slice, not a `Vec`: the
+    /// count is fixed at closure creation, so there is no spare capacity to
+    /// carry and the handle array is a single exact-size allocation.
+    pub upvalues: Box<[ObjRef]>,
+}
+
+#[derive(Debug, Clone, Copy)]
+pub enum VmUpvalue {
+    Open(usize), // stack index
+    Closed(VmValue),
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum NativeFn {
+    Clock,
+    ReadLine,
+    ToNumber,
+}
+
+#[derive(Debug)]
+pub struct VmClass {
+    pub name: String,
+    /// Method values are always `VmObject::Closure`.
+    pub methods: HashMap<String, ObjRef>,
+}
+
+#[derive(Debug)]
+pub struct VmInstance {
+    /// Always a `VmObject::Class`.
+    pub class: ObjRef,
+    pub fields: HashMap<String, VmValue>,
+}
+
+#[derive(Debug)]
+pub struct VmBoundMethod {
+    pub receiver: VmValue,
+    /// Always a `VmObject::Closure`.
+    pub method: ObjRef,
+}
+
+impl VmObject {
+    /// Unwrap a closure object. Panics if this is not a closure; callers rely
+    /// on invariants maintained by the compiler (e.g. method tables only hold
+    /// closures).
+    pub fn closure(&self) -> &VmClosure {
+        match self {
+            Self::Closure(c) => c,
+            other => panic!("expected closure object, got {other:?}"),
+        }
+    }
+
+    /// Unwrap a class object. Panics if this is not a class.
+    pub fn class(&self) -> &RefCell<VmClass> {
+        match self {
+            Self::Class(c) => c,
+            other => panic!("expected class object, got {other:?}"),
+        }
+    }
+
+    /// Unwrap an upvalue object. Panics if this is not an upvalue.
+    pub fn upvalue(&self) -> &Cell<VmUpvalue> {
+        match self {
+            Self::Upvalue(u) => u,
+            other => panic!("expected upvalue object, got {other:?}"),
+        }
+    }
+}
+
+impl VmValue {
+    pub const NIL: Self = Self(QNAN | TAG_NIL);
+    pub const TRUE: Self = Self(QNAN | TAG_TRUE);
+    pub const FALSE: Self = Self(QNAN | TAG_FALSE);
+
+    pub fn number(n: f64) -> Self {
+        Self(n.to_bits())
+    }
+
+    pub fn from_bool(b: bool) -> Self {
+        if b { Self::TRUE } else { Self::FALSE }
+    }
+
+    /// Box a heap handle.
+    pub fn from_obj(obj: ObjRef) -> Self {
+        let ptr = obj.0 as u64;
+        debug_assert_eq!(ptr & !PTR_MASK, 0, "object pointer exceeds 48 bits");
+        Self(SIGN_BIT | QNAN | ptr)
+    }
+
+    pub fn is_number(&self) -> bool {
+        (self.0 & QNAN) != QNAN
+    }
+
+    pub fn is_nil(&self) -> bool {
+        self.0 == Self::NIL.0
+    }
+
+    pub fn is_object(&self) -> bool {
+        (self.0 & (SIGN_BIT | QNAN)) == (SIGN_BIT | QNAN)
+    }
+
+    pub fn as_number(&self) -> Option<f64> {
+        self.is_number().then(|| f64::from_bits(self.0))
+    }
+
+    /// The heap handle, if this is an object value.
+    pub fn as_obj(&self) -> Option<ObjRef> {
+        self.is_object()
+            .then_some(ObjRef((self.0 & PTR_MASK) as *const GcObject))
+    }
+
+    pub fn as_object(&self) -> Option<&VmObject> {
+        if self.is_object() {
+            // Safety: see ObjRef::get; the borrow is tied to self, which the
+            // caller keeps rooted.
+            Some(unsafe { &(*((self.0 & PTR_MASK) as *const GcObject)).obj })
+        } else {
+            None
+        }
+    }
+
+    pub fn is_falsey(&self) -> bool {
+        self.0 == Self::NIL.0 || self.0 == Self::FALSE.0
+    }
+}
+
+impl PartialEq for VmValue {
+    fn eq(&self, other: &Self) -> bool {
+        match (self.as_number(), other.as_number()) {
+            // Compare as f64 so NaN != NaN and 0.0 == -0.0
+            (Some(a), Some(b)) => a == b,
+            (None, None) => match (self.as_object(), other.as_object()) {
+                // Interned strings normally hit the pointer check; the
+                // content comparison covers uninterned strings.
+                (Some(a), Some(b)) => {
+                    std::ptr::eq(a, b)
+                        || matches!((a, b), (VmObject::String(x), VmObject::String(y)) if x == y)
+                }
+                // nil/bool tags compare bitwise
+                (None, None) => self.0 == other.0,
+                _ => false,
+            },
+            _ => false,
+        }
+    }
+}
+
+impl std::fmt::Display for VmValue {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        if let Some(n) = self.as_number() {
+            if n.fract() == 0.0 {
+                write!(f, "{}", n as i64)
+            } else {
+                write!(f, "{n}")
+            }
+        } else if let Some(obj) = self.as_object() {
+            match obj {
+                VmObject::String(s) => write!(f, "{s}"),
+                VmObject::Closure(c) => write!(f, "<fn {}>", c.function.name),
+                VmObject::NativeFunction(_) => write!(f, "<native fn>"),
+                VmObject::Class(c) => write!(f, "{}", c.borrow().name),
+                VmObject::Instance(i) => {
+                    write!(
+                        f,
+                        "{} instance",
+                        i.borrow().class.get().class().borrow().name
+                    )
+                }
+                VmObject::BoundMethod(bm) => {
+                    write!(f, "<fn {}>", bm.method.get().closure().function.name)
+                }
+                VmObject::Upvalue(_) => write!(f, "<upvalue>"),
+            }
+        } else if self.is_nil() {
+            write!(f, "nil")
+        } else {
+            write!(f, "{}", self.0 == Self::TRUE.0)
+        }
+    }
+}
+
+impl std::fmt::Debug for VmValue {
+    /// Forward to Display; the raw bit pattern is not informative.
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        std::fmt::Display::fmt(self, f)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::vm::heap::Heap;
+
+    #[test]
+    fn number_roundtrip() {
+        let v = VmValue::number(3.5);
+        assert!(v.is_number());
+        assert_eq!(v.as_number(), Some(3.5));
+        assert!(!v.is_object());
+        assert!(!v.is_nil());
+    }
+
+    #[test]
+    fn negative_and_nan_numbers_stay_numbers() {
+        assert_eq!(VmValue::number(-1.5).as_number(), Some(-1.5));
+        let nan = VmValue::number(f64::NAN);
+        assert!(nan.is_number());
+        assert!(nan.as_number().expect("still a number").is_nan());
+    }
+
+    #[test]
+    fn singleton_tags() {
+        assert!(VmValue::NIL.is_nil());
+        assert!(VmValue::NIL.is_falsey());
+        assert!(VmValue::FALSE.is_falsey());
+        assert!(!VmValue::TRUE.is_falsey());
+        assert!(!VmValue::number(0.0).is_falsey());
+        assert_eq!(VmValue::from_bool(true), VmValue::TRUE);
+        assert_eq!(VmValue::from_bool(false), VmValue::FALSE);
+    }
+
+    #[test]
+    fn object_roundtrip() {
+        let mut heap = Heap::new();
+        let obj = heap.alloc(VmObject::String("hello".to_string()));
+        let v = VmValue::from_obj(obj);
+        assert!(v.is_object());
+        assert_eq!(v.as_obj(), Some(obj));
+        assert!(matches!(v.as_object(), Some(VmObject::String(s)) if s == "hello"));
+    }
+
+    #[test]
+    fn equality_semantics() {
+        let mut heap = Heap::new();
+        assert_eq!(VmValue::number(1.0), VmValue::number(1.0));
+        assert_ne!(VmValue::number(0.0), VmValue::FALSE);
+        assert_ne!(VmValue::NIL, VmValue::FALSE);
+        let a = VmValue::from_obj(heap.alloc(VmObject::String("x".to_string())));
+        let b = VmValue::from_obj(heap.alloc(VmObject::String("x".to_string())));
+        assert_eq!(a, b); // strings compare by content
+        let nan = VmValue::number(f64::NAN);
+        assert_ne!(nan, nan);
+    }
+
+    #[test]
+    fn display_matches_lox_formatting() {
+        let mut heap = Heap::new();
+        assert_eq!(VmValue::number(42.0).to_string(), "42");
+        assert_eq!(VmValue::number(2.5).to_string(), "2.5");
+        assert_eq!(VmValue::NIL.to_string(), "nil");
+        assert_eq!(VmValue::TRUE.to_string(), "true");
+        let s = VmValue::from_obj(heap.alloc(VmObject::String("hi".to_string())));
+        assert_eq!(s.to_string(), "hi");
+    }
+}
@@ -1,177 +1,274 @@
-use std::cell::RefCell;
+use std::cell::{Cell, RefCell};
 use std::collections::HashMap;
-use std::io::Write;
+use std::io::{BufWriter, Write};
 use std::rc::Rc;
+use std::sync::Arc;
 use std::time::{SystemTime, UNIX_EPOCH};
 
 use crate::error::{RuntimeError, StackFrame};
-use crate::vm::chunk::{Chunk, Constant, OpCode};
-
-#[derive(Debug, Clone)]
-enum VmValue {
-    Number(f64),
-    Bool(bool),
-    Nil,
-    String(Rc<String>),
-    Closure(Rc<VmClosure>),
-    NativeFunction(NativeFn),
-    Class(Rc<RefCell<VmClass>>),
-    Instance(Rc<RefCell<VmInstance>>),
-    BoundMethod(Rc<VmBoundMethod>),
-}
-
-impl VmValue {
-    fn is_falsey(&self) -> bool {
-        matches!(self, Self::Nil | Self::Bool(false))
-    }
-}
-
-impl std::fmt::Display for VmValue {
-    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
-        match self {
-            Self::Number(n) => {
-                if n.fract() == 0.0 {
-                    write!(f, "{}", *n as i64)
-                } else {
-                    write!(f, "{n}")
-                }
-            }
-            Self::Bool(b) => write!(f, "{b}"),
-            Self::Nil => write!(f, "nil"),
-            Self::String(s) => write!(f, "{s}"),
-            Self::Closure(c) => write!(f, "<fn {}>", c.function.name),
-            Self::NativeFunction(_) => write!(f, "<native fn>"),
-            Self::Class(c) => write!(f, "{}", c.borrow().name),
-            Self::Instance(i) => write!(f, "{} instance", i.borrow().class.borrow().name),
-            Self::BoundMethod(bm) => write!(f, "<fn {}>", bm.method.function.name),
-        }
-    }
-}
+use crate::vm::CompiledProgram;
+use crate::vm::chunk::{Chunk, Constant, OpCode, UNCACHED_SLOT};
+use crate::vm::heap::{GcStats, Heap};
+use crate::vm::profiler::Profiler;
+use crate::vm::value::{
+    NativeFn, ObjRef, PropertyCache, VmBoundMethod, VmClass, VmClosure, VmFunction, VmInstance,
+    VmObject, VmUpvalue, VmValue,
+};
 
-#[derive(Debug, Clone)]
-struct VmFunction {
-    name: String,
-    arity: usize,
-    #[allow(dead_code)]
-    upvalue_count: usize,
-    chunk: Chunk,
-}
-
-#[derive(Debug)]
-struct VmClosure {
-    function: Rc<VmFunction>,
-    upvalues: Vec<Rc<RefCell<VmUpvalue>>>,
+struct CallFrame {
+    /// Always a `VmObject::Closure`.
+    closure: ObjRef,
+    ip: usize,
+    slot_offset: usize,
 }
 
-impl Clone for VmClosure {
-    fn clone(&self) -> Self {
-        Self {
-            function: Rc::clone(&self.function),
-            upvalues: self.upvalues.clone(),
-        }
+impl CallFrame {
+    fn closure(&self) -> &VmClosure {
+        self.closure.get().closure()
     }
 }
 
-#[derive(Debug, Clone)]
-enum VmUpvalue {
-    Open(usize), // stack index
-    Closed(VmValue),
-}
-
-#[derive(Debug, Clone, Copy, PartialEq, Eq)]
-enum NativeFn {
-    Clock,
-    ReadLine,
-    ToNumber,
-}
-
-#[derive(Debug)]
-struct VmClass {
-    name: String,
-    methods: HashMap<String, Rc<VmClosure>>,
-}
-
-#[derive(Debug)]
-struct VmInstance {
-    class: Rc<RefCell<VmClass>>,
-    fields: HashMap<String, VmValue>,
+/// How `Vm::run` gets from an opcode byte to its handler.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub enum DispatchMode {
+    /// Decode each byte through `OpCode::try_from` and a `match`.
+    Switch,
+    /// Index a 256-entry handler table with the raw opcode byte, skipping
+    /// the range check and the central match branch entirely.
+    #[default]
+    Threaded,
 }
 
-#[derive(Debug)]
-struct VmBoundMethod {
-    receiver: VmValue,
-    method: Rc<VmClosure>,
+/// Signal from an opcode handler back to the dispatch loop.
+enum Flow {
+    Continue,
+    /// The script (outermost frame) returned; stop interpreting.
+    Halt,
 }
 
-struct CallFrame {
-    closure: Rc<VmClosure>,
-    ip: usize,
-    slot_offset: usize,
-}
+type OpHandler = fn(&mut Vm) -> Result<Flow, RuntimeError>;
+
+/// Handler table indexed by raw opcode byte; unassigned slots report an
+/// unknown opcode at runtime.
+static DISPATCH_TABLE: [OpHandler; 256] = {
+    let mut table: [OpHandler; 256] = [Vm::op_invalid; 256];
+    table[OpCode::Constant as usize] = Vm::op_constant;
+    table[OpCode::ConstantLong as usize] = Vm::op_constant_long;
+    table[OpCode::Nil as usize] = Vm::op_nil;
+    table[OpCode::True as usize] = Vm::op_true;
+    table[OpCode::False as usize] = Vm::op_false;
+    table[OpCode::Pop as usize] = Vm::op_pop;
+    table[OpCode::GetLocal as usize] = Vm::op_get_local;
+    table[OpCode::SetLocal as usize] = Vm::op_set_local;
+    table[OpCode::GetGlobal as usize] = Vm::op_get_global;
+    table[OpCode::SetGlobal as usize] = Vm::op_set_global;
+    table[OpCode::DefineGlobal as usize] = Vm::op_define_global;
+    table[OpCode::GetUpvalue as usize] = Vm::op_get_upvalue;
+    table[OpCode::SetUpvalue as usize] = Vm::op_set_upvalue;
+    table[OpCode::GetProperty as usize] = Vm::op_get_property;
+    table[OpCode::SetProperty as usize] = Vm::op_set_property;
+    table[OpCode::GetSuper as usize] = Vm::op_get_super;
+    table[OpCode::Equal as usize] = Vm::op_equal;
+    table[OpCode::Greater as usize] = Vm::op_greater;
+    table[OpCode::Less as usize] = Vm::op_less;
+    table[OpCode::Add as usize] = Vm::op_add;
+    table[OpCode::Subtract as usize] = Vm::op_subtract;
+    table[OpCode::Multiply as usize] = Vm::op_multiply;
+    table[OpCode::Divide as usize] = Vm::op_divide;
+    table[OpCode::Not as usize] = Vm::op_not;
+    table[OpCode::Negate as usize] = Vm::op_negate;
+    table[OpCode::Print as usize] = Vm::op_print;
+    table[OpCode::Jump as usize] = Vm::op_jump;
+    table[OpCode::JumpIfFalse as usize] = Vm::op_jump_if_false;
+    table[OpCode::Loop as usize] = Vm::op_loop;
+    table[OpCode::Call as usize] = Vm::op_call;
+    table[OpCode::TailCall as usize] = Vm::op_tail_call;
+    table[OpCode::Invoke as usize] = Vm::op_invoke;
+    table[OpCode::SuperInvoke as usize] = Vm::op_super_invoke;
+    table[OpCode::Closure as usize] = Vm::op_closure;
+    table[OpCode::CloseUpvalue as usize] = Vm::op_close_upvalue;
+    table[OpCode::Return as usize] = Vm::op_return;
+    table[OpCode::Class as usize] = Vm::op_class;
+    table[OpCode::Inherit as usize] = Vm::op_inherit;
+    table[OpCode::Method as usize] = Vm::op_method;
+    table[OpCode::GreaterEqual as usize] = Vm::op_greater_equal;
+    table[OpCode::LessEqual as usize] = Vm::op_less_equal;
+    table[OpCode::NotEqual as usize] = Vm::op_not_equal;
+    table[OpCode::LocalAddConstant as usize] = Vm::op_local_add_constant;
+    table[OpCode::LessJumpIfFalse as usize] = Vm::op_less_jump_if_false;
+    table[OpCode::GreaterJumpIfFalse as usize] = Vm::op_greater_jump_if_false;
+    table[OpCode::EqualJumpIfFalse as usize] = Vm::op_equal_jump_if_false;
+    table
+};
 
 pub struct Vm {
     stack: Vec<VmValue>,
     frames: Vec<CallFrame>,
-    globals: HashMap<String, VmValue>,
-    open_upvalues: Vec<Rc<RefCell<VmUpvalue>>>,
+    /// Global values indexed by slot; `None` marks a slot that has been
+    /// referenced but not yet defined.
+    globals: Vec<Option<VmValue>>,
+    /// Global names by slot, from the script chunk; kept for error messages.
+    global_names: Vec<String>,
+    /// Upvalues still pointing into the value stack, sorted by stack slot.
+    /// Closing all upvalues at or above a slot is then a pop of the tail,
+    /// and capture searches from the back, where the innermost frames live.
+    open_upvalues: Vec<ObjRef>,
+    /// Intern table: one shared heap object per distinct string content.
+    /// Interned strings compare equal by pointer. The table is weak: the
+    /// collector drops entries nothing else reaches, so runtime-produced
+    /// strings (concatenation results, input lines) are not pinned.
+    strings: HashMap<String, ObjRef>,
+    /// Object heap; all `VmObject`s are allocated here and reclaimed by
+    /// mark-sweep collection at dispatch-loop boundaries.
+    heap: Heap,
+    /// Printed lines, populated only in capture mode (`new_capturing`).
     output: Vec<String>,
     writer: Box<dyn Write>,
+    /// Capture printed lines into `output` instead of writing them out.
+    /// Opt-in (test harnesses, benchmarks): an unconditional capture would
+    /// grow without bound on long print-heavy runs.
+    capture: bool,
+    dispatch: DispatchMode,
+    /// Sampling profiler, populated by `enable_profiler` (`--profile`).
+    profiler: Option<Box<Profiler>>,
 }
 
 impl Vm {
     pub fn new() -> Self {
-        let mut globals = HashMap::new();
-        globals.insert(
-            "clock".to_string(),
-            VmValue::NativeFunction(NativeFn::Clock),
-        );
-        globals.insert(
-            "readLine".to_string(),
-            VmValue::NativeFunction(NativeFn::ReadLine),
-        );
-        globals.insert(
-            "toNumber".to_string(),
-            VmValue::NativeFunction(NativeFn::ToNumber),
-        );
+        Self::with_dispatch(DispatchMode::default())
+    }
+
+    pub fn with_dispatch(dispatch: DispatchMode) -> Self {
         Self {
             stack: Vec::with_capacity(256),
             frames: Vec::with_capacity(64),
-            globals,
+            globals: Vec::new(),
+            global_names: Vec::new(),
             open_upvalues: Vec::new(),
+            strings: HashMap::new(),
+            heap: Heap::new(),
             output: Vec::new(),
-            writer: Box::new(std::io::stdout()),
+            writer: Box::new(BufWriter::new(std::io::stdout())),
+            capture: false,
+            dispatch,
+            profiler: None,
         }
     }
 
-    #[cfg(test)]
-    fn new_capturing() -> Self {
+    /// Turn on per-opcode and per-function profiling for subsequent runs;
+    /// the collected report is available via [`Vm::profile_report`].
+    pub fn enable_profiler(&mut self) {
+        self.profiler = Some(Box::new(Profiler::new()));
+    }
+
+    /// The profiler's sorted report, or `None` if profiling is not enabled.
+    pub fn profile_report(&self) -> Option<String> {
+        self.profiler.as_ref().map(|p| p.report())
+    }
+
+    /// Create a VM that captures printed lines in [`Vm::output`] instead of
+    /// writing them to stdout (for test harnesses and benchmarks).
+    pub fn new_capturing() -> Self {
         let mut vm = Self::new();
-        vm.writer = Box::new(Vec::<u8>::new());
+        vm.writer = Box::new(std::io::sink());
+        vm.capture = true;
         vm
     }
 
+    /// Printed lines captured so far; empty unless built via `new_capturing`.
     pub fn output(&self) -> &[String] {
         &self.output
     }
 
+    /// Collector counters (pause times, objects freed) for monitoring.
+    pub fn gc_stats(&self) -> &GcStats {
+        &self.heap.stats
+    }
+
     pub fn interpret(&mut self, chunk: Chunk) -> Result<(), RuntimeError> {
+        self.interpret_program(&CompiledProgram::new(chunk))
+    }
+
+    /// Run a shared pre-compiled program. Per-run setup shrinks to interning
+    /// the precollected strings into this VM's heap and allocating the
+    /// native-function objects — the chunk itself is shared, never copied,
+    /// so one program can back a fresh VM per request across a thread pool.
+    pub fn interpret_program(&mut self, program: &CompiledProgram) -> Result<(), RuntimeError> {
+        for s in &program.strings {
+            self.intern(s.clone());
+        }
+        self.global_names = program.chunk.globals.clone();
+        self.globals = vec![None; self.global_names.len()];
+        // Pre-fill slots whose names match the built-in native functions.
+        for &(slot, native) in &program.natives {
+            let native = self.heap.alloc(VmObject::NativeFunction(native));
+            self.globals[slot] = Some(VmValue::from_obj(native));
+        }
         let function = Rc::new(VmFunction {
             name: "script".to_string(),
             arity: 0,
             upvalue_count: 0,
-            chunk,
+            chunk: Arc::clone(&program.chunk),
+            caches: RefCell::new(Vec::new()),
         });
-        let closure = Rc::new(VmClosure {
+        let closure = self.heap.alloc(VmObject::Closure(VmClosure {
             function,
-            upvalues: Vec::new(),
-        });
-        self.stack.push(VmValue::Closure(Rc::clone(&closure)));
-        self.frames.push(CallFrame {
-            closure,
-            ip: 0,
-            slot_offset: 0,
-        });
-        self.run()
+            upvalues: Box::new([]),
+        }));
+        self.stack.push(VmValue::from_obj(closure));
+        self.push_frame(closure, 0);
+        let result = self.run();
+        // One flush at exit: prints go through a BufWriter, not a syscall
+        // per line.
+        self.writer.flush().expect("flush should succeed");
+        if gc_stats_enabled() {
+            let stats = &self.heap.stats;
+            eprintln!(
+                "[gc] collections: {}, objects freed: {}, live: {}, last pause: {:?}, total pause: {:?}",
+                stats.collections,
+                stats.objects_freed,
+                self.heap.object_count(),
+                stats.last_pause,
+                stats.total_pause,
+            );
+        }
+        result
+    }
+
+    /// Get the shared handle for a string, creating it on first sight.
+    fn intern(&mut self, s: String) -> ObjRef {
+        if let Some(&obj) = self.strings.get(&s) {
+            return obj;
+        }
+        let obj = self.heap.alloc(VmObject::String(s.clone()));
+        self.strings.insert(s, obj);
+        obj
+    }
+
+    /// Run a mark-sweep collection now, rooting everything the VM can still
+    /// reach: the value stack, call frames, globals, and open upvalues. The
+    /// intern table is deliberately not a root — the heap prunes its dead
+    /// entries instead. Called from the dispatch loop at instruction
+    /// boundaries — the only points where no handler holds an unrooted
+    /// intermediate object.
+    pub fn collect_garbage(&mut self) {
+        let mut gray: Vec<ObjRef> = Vec::new();
+        gray.extend(self.stack.iter().filter_map(|v| v.as_obj()));
+        gray.extend(self.frames.iter().map(|f| f.closure));
+        gray.extend(self.globals.iter().flatten().filter_map(|v| v.as_obj()));
+        gray.extend_from_slice(&self.open_upvalues);
+        self.heap.collect(gray, &mut self.strings);
+    }
+
+    /// Turn a pool constant into a runtime value, interning strings.
+    fn constant_to_value(&mut self, constant: Constant) -> VmValue {
+        match constant {
+            Constant::Number(n) => VmValue::number(n),
+            Constant::String(s) => VmValue::from_obj(self.intern(s)),
+            Constant::Function { .. } => {
+                panic!("function constants should be handled by Closure opcode")
+            }
+        }
     }
 
     /// Build a RuntimeError with the current line number and a backtrace
@@ -182,14 +279,10 @@ impl Vm {
             .iter()
             .rev()
             .map(|frame| {
-                let func = &frame.closure.function;
+                let func = &frame.closure().function;
                 // ip points past the instruction that caused the error
                 let ip = if frame.ip > 0 { frame.ip - 1 } else { 0 };
-                let line = if ip < func.chunk.lines.len() {
-                    func.chunk.lines[ip]
-                } else {
-                    0
-                };
+                let line = func.chunk.lines.line_at(ip).unwrap_or(0);
                 let name = if func.name == "script" {
                     "<script>".to_string()
                 } else {
@@ -215,344 +308,677 @@ impl Vm {
     }
 
     fn run(&mut self) -> Result<(), RuntimeError> {
-        loop {
-            let frame_idx = self.frames.len() - 1;
-            let ip = self.frames[frame_idx].ip;
-            let chunk = &self.frames[frame_idx].closure.function.chunk;
+        match self.dispatch {
+            DispatchMode::Threaded => self.run_threaded(),
+            DispatchMode::Switch => self.run_switch(),
+        }
+    }
+
+    /// Fetch the next opcode byte, or `None` when the script chunk is done.
+    #[inline]
+    fn fetch(&mut self) -> Option<u8> {
+        let frame_idx = self.frames.len() - 1;
+        let ip = self.frames[frame_idx].ip;
+        let chunk = &self.frames[frame_idx].closure().function.chunk;
+        if ip >= chunk.code.len() {
+            return None;
+        }
+        let op = chunk.code[ip];
+        self.frames[frame_idx].ip += 1;
+        Some(op)
+    }
+
+    /// Profiler hook for the dispatch loops: count `op`, and take a clock
+    /// sample over the current frame stack when one is due.
+    #[inline]
+    fn profile_dispatch(&mut self, op: u8) {
+        if let Some(profiler) = &mut self.profiler
+            && profiler.record(op)
+        {
+            profiler.sample(
+                op,
+                self.frames
+                    .iter()
+                    .map(|f| f.closure().function.name.as_str()),
+            );
+        }
+    }
 
-            if ip >= chunk.code.len() {
-                return Ok(());
+    fn run_threaded(&mut self) -> Result<(), RuntimeError> {
+        while let Some(op) = self.fetch() {
+            if self.heap.should_collect() {
+                self.collect_garbage();
+            }
+            self.profile_dispatch(op);
+            match DISPATCH_TABLE[op as usize](self)? {
+                Flow::Continue => {}
+                Flow::Halt => return Ok(()),
             }
+        }
+        Ok(())
+    }
 
-            let op = chunk.code[ip];
-            self.frames[frame_idx].ip += 1;
+    fn run_switch(&mut self) -> Result<(), RuntimeError> {
+        while let Some(op) = self.fetch() {
+            if self.heap.should_collect() {
+                self.collect_garbage();
+            }
+            self.profile_dispatch(op);
+            let handler: OpHandler = match OpCode::try_from(op) {
+                Ok(OpCode::Constant) => Vm::op_constant,
+                Ok(OpCode::ConstantLong) => Vm::op_constant_long,
+                Ok(OpCode::Nil) => Vm::op_nil,
+                Ok(OpCode::True) => Vm::op_true,
+                Ok(OpCode::False) => Vm::op_false,
+                Ok(OpCode::Pop) => Vm::op_pop,
+                Ok(OpCode::GetLocal) => Vm::op_get_local,
+                Ok(OpCode::SetLocal) => Vm::op_set_local,
+                Ok(OpCode::GetGlobal) => Vm::op_get_global,
+                Ok(OpCode::SetGlobal) => Vm::op_set_global,
+                Ok(OpCode::DefineGlobal) => Vm::op_define_global,
+                Ok(OpCode::GetUpvalue) => Vm::op_get_upvalue,
+                Ok(OpCode::SetUpvalue) => Vm::op_set_upvalue,
+                Ok(OpCode::GetProperty) => Vm::op_get_property,
+                Ok(OpCode::SetProperty) => Vm::op_set_property,
+                Ok(OpCode::GetSuper) => Vm::op_get_super,
+                Ok(OpCode::Equal) => Vm::op_equal,
+                Ok(OpCode::Greater) => Vm::op_greater,
+                Ok(OpCode::Less) => Vm::op_less,
+                Ok(OpCode::Add) => Vm::op_add,
+                Ok(OpCode::Subtract) => Vm::op_subtract,
+                Ok(OpCode::Multiply) => Vm::op_multiply,
+                Ok(OpCode::Divide) => Vm::op_divide,
+                Ok(OpCode::Not) => Vm::op_not,
+                Ok(OpCode::Negate) => Vm::op_negate,
+                Ok(OpCode::Print) => Vm::op_print,
+                Ok(OpCode::Jump) => Vm::op_jump,
+                Ok(OpCode::JumpIfFalse) => Vm::op_jump_if_false,
+                Ok(OpCode::Loop) => Vm::op_loop,
+                Ok(OpCode::Call) => Vm::op_call,
+                Ok(OpCode::TailCall) => Vm::op_tail_call,
+                Ok(OpCode::Invoke) => Vm::op_invoke,
+                Ok(OpCode::SuperInvoke) => Vm::op_super_invoke,
+                Ok(OpCode::Closure) => Vm::op_closure,
+                Ok(OpCode::CloseUpvalue) => Vm::op_close_upvalue,
+                Ok(OpCode::Return) => Vm::op_return,
+                Ok(OpCode::Class) => Vm::op_class,
+                Ok(OpCode::Inherit) => Vm::op_inherit,
+                Ok(OpCode::Method) => Vm::op_method,
+                Ok(OpCode::GreaterEqual) => Vm::op_greater_equal,
+                Ok(OpCode::LessEqual) => Vm::op_less_equal,
+                Ok(OpCode::NotEqual) => Vm::op_not_equal,
+                Ok(OpCode::LocalAddConstant) => Vm::op_local_add_constant,
+                Ok(OpCode::LessJumpIfFalse) => Vm::op_less_jump_if_false,
+                Ok(OpCode::GreaterJumpIfFalse) => Vm::op_greater_jump_if_false,
+                Ok(OpCode::EqualJumpIfFalse) => Vm::op_equal_jump_if_false,
+                Err(_) => Vm::op_invalid,
+            };
+            match handler(self)? {
+                Flow::Continue => {}
+                Flow::Halt => return Ok(()),
+            }
+        }
+        Ok(())
+    }
 
-            match OpCode::try_from(op) {
-                Ok(OpCode::Constant) => {
-                    let idx = self.read_byte();
-                    let constant = self.current_chunk().constants[idx as usize].clone();
-                    self.stack.push(constant_to_value(constant));
-                }
-                Ok(OpCode::Nil) => self.stack.push(VmValue::Nil),
-                Ok(OpCode::True) => self.stack.push(VmValue::Bool(true)),
-                Ok(OpCode::False) => self.stack.push(VmValue::Bool(false)),
-                Ok(OpCode::Pop) => {
-                    self.stack.pop();
-                }
-                Ok(OpCode::GetLocal) => {
-                    let slot = self.read_byte() as usize;
-                    let offset = self.frames.last().expect("frame").slot_offset;
-                    let value = self.stack[offset + slot].clone();
-                    self.stack.push(value);
-                }
-                Ok(OpCode::SetLocal) => {
-                    let slot = self.read_byte() as usize;
-                    let offset = self.frames.last().expect("frame").slot_offset;
-                    let value = self.stack.last().expect("stack not empty").clone();
-                    self.stack[offset + slot] = value;
-                }
-                Ok(OpCode::GetGlobal) => {
-                    let name = self.read_string_constant();
-                    let value = self.globals.get(&name).cloned().ok_or_else(|| {
-                        self.runtime_error(format!("undefined variable '{name}'"))
-                    })?;
-                    self.stack.push(value);
-                }
-                Ok(OpCode::SetGlobal) => {
-                    let name = self.read_string_constant();
-                    if !self.globals.contains_key(&name) {
-                        return Err(self.runtime_error(format!("undefined variable '{name}'")));
-                    }
-                    let value = self.stack.last().expect("stack not empty").clone();
-                    self.globals.insert(name, value);
-                }
-                Ok(OpCode::DefineGlobal) => {
-                    let name = self.read_string_constant();
-                    let value = self.stack.pop().expect("stack not empty");
-                    self.globals.insert(name, value);
-                }
-                Ok(OpCode::GetUpvalue) => {
-                    let slot = self.read_byte() as usize;
-                    let upvalue =
-                        Rc::clone(&self.frames.last().expect("frame").closure.upvalues[slot]);
-                    let value = match &*upvalue.borrow() {
-                        VmUpvalue::Open(idx) => self.stack[*idx].clone(),
-                        VmUpvalue::Closed(v) => v.clone(),
-                    };
-                    self.stack.push(value);
-                }
-                Ok(OpCode::SetUpvalue) => {
-                    let slot = self.read_byte() as usize;
-                    let value = self.stack.last().expect("stack not empty").clone();
-                    let upvalue =
-                        Rc::clone(&self.frames.last().expect("frame").closure.upvalues[slot]);
-                    match &mut *upvalue.borrow_mut() {
-                        VmUpvalue::Open(idx) => {
-                            self.stack[*idx] = value;
-                        }
-                        VmUpvalue::Closed(v) => {
-                            *v = value;
-                        }
-                    }
-                }
-                Ok(OpCode::GetProperty) => {
-                    let name = self.read_string_constant();
-                    let instance = self.stack.pop().expect("stack");
-                    match instance {
-                        VmValue::Instance(inst) => {
-                            if let Some(val) = inst.borrow().fields.get(&name).cloned() {
-                                self.stack.push(val);
-                            } else if let Some(method) =
-                                inst.borrow().class.borrow().methods.get(&name).cloned()
-                            {
-                                let bound = VmValue::BoundMethod(Rc::new(VmBoundMethod {
-                                    receiver: VmValue::Instance(Rc::clone(&inst)),
-                                    method,
-                                }));
-                                self.stack.push(bound);
-                            } else {
-                                return Err(
-                                    self.runtime_error(format!("undefined property '{name}'"))
-                                );
-                            }
-                        }
-                        _ => {
-                            return Err(self.runtime_error("only instances have properties"));
-                        }
-                    }
-                }
-                Ok(OpCode::SetProperty) => {
-                    let name = self.read_string_constant();
-                    let value = self.stack.pop().expect("stack");
-                    let instance = self.stack.pop().expect("stack");
-                    match instance {
-                        VmValue::Instance(inst) => {
-                            inst.borrow_mut().fields.insert(name, value.clone());
-                            self.stack.push(value);
-                        }
-                        _ => {
-                            return Err(self.runtime_error("only instances have fields"));
-                        }
-                    }
-                }
-                Ok(OpCode::GetSuper) => {
-                    let name = self.read_string_constant();
-                    let superclass = self.stack.pop().expect("stack");
-                    let receiver = self.stack.pop().expect("stack");
-                    if let VmValue::Class(sc) = superclass {
-                        if let Some(method) = sc.borrow().methods.get(&name).cloned() {
-                            let bound =
-                                VmValue::BoundMethod(Rc::new(VmBoundMethod { receiver, method }));
-                            self.stack.push(bound);
-                        } else {
-                            return Err(self.runtime_error(format!("undefined property '{name}'")));
-                        }
-                    }
-                }
-                Ok(OpCode::Equal) => {
-                    let b = self.stack.pop().expect("stack");
-                    let a = self.stack.pop().expect("stack");
-                    self.stack.push(VmValue::Bool(values_equal(&a, &b)));
-                }
-                Ok(OpCode::Greater) => {
-                    self.binary_op(|a, b| VmValue::Bool(a > b))?;
-                }
-                Ok(OpCode::Less) => {
-                    self.binary_op(|a, b| VmValue::Bool(a < b))?;
-                }
-                Ok(OpCode::Add) => {
-                    let b = self.stack.pop().expect("stack");
-                    let a = self.stack.pop().expect("stack");
-                    match (&a, &b) {
-                        (VmValue::Number(x), VmValue::Number(y)) => {
-                            self.stack.push(VmValue::Number(x + y));
-                        }
-                        (VmValue::String(x), VmValue::String(y)) => {
-                            self.stack.push(VmValue::String(Rc::new(format!("{x}{y}"))));
-                        }
-                        _ => {
-                            return Err(
-                                self.runtime_error("operands must be two numbers or two strings")
-                            );
-                        }
-                    }
-                }
-                Ok(OpCode::Subtract) => {
-                    self.binary_op(|a, b| VmValue::Number(a - b))?;
-                }
-                Ok(OpCode::Multiply) => {
-                    self.binary_op(|a, b| VmValue::Number(a * b))?;
-                }
-                Ok(OpCode::Divide) => {
-                    self.binary_op(|a, b| VmValue::Number(a / b))?;
-                }
-                Ok(OpCode::Not) => {
-                    let val = self.stack.pop().expect("stack");
-                    self.stack.push(VmValue::Bool(val.is_falsey()));
-                }
-                Ok(OpCode::Negate) => {
-                    let val = self.stack.pop().expect("stack");
-                    match val {
-                        VmValue::Number(n) => self.stack.push(VmValue::Number(-n)),
-                        _ => {
-                            return Err(self.runtime_error("operand must be a number"));
-                        }
-                    }
-                }
-                Ok(OpCode::Print) => {
-                    let val = self.stack.pop().expect("stack");
-                    let text = format!("{val}");
-                    writeln!(self.writer, "{text}").expect("write should succeed");
-                    self.output.push(text);
-                }
-                Ok(OpCode::Jump) => {
-                    let offset = self.read_u16();
-                    self.frames.last_mut().expect("frame").ip += offset as usize;
-                }
-                Ok(OpCode::JumpIfFalse) => {
-                    let offset = self.read_u16();
-                    if self.stack.last().expect("stack").is_falsey() {
-                        self.frames.last_mut().expect("frame").ip += offset as usize;
-                    }
-                }
-                Ok(OpCode::Loop) => {
-                    let offset = self.read_u16();
-                    self.frames.last_mut().expect("frame").ip -= offset as usize;
-                }
-                Ok(OpCode::Call) => {
-                    let arg_count = self.read_byte() as usize;
-                    let callee_idx = self.stack.len() - 1 - arg_count;
-                    let callee = self.stack[callee_idx].clone();
-                    self.call_value(callee, arg_count)?;
-                }
-                Ok(OpCode::Invoke) => {
-                    let name = self.read_string_constant();
-                    let arg_count = self.read_byte() as usize;
-                    let receiver_idx = self.stack.len() - 1 - arg_count;
-                    let receiver = self.stack[receiver_idx].clone();
-                    if let VmValue::Instance(inst) = &receiver {
-                        if let Some(field) = inst.borrow().fields.get(&name).cloned() {
-                            self.stack[receiver_idx] = field.clone();
-                            self.call_value(field, arg_count)?;
-                        } else {
-                            let class = inst.borrow().class.clone();
-                            self.invoke_from_class(&class, &name, arg_count)?;
-                        }
-                    } else {
-                        return Err(self.runtime_error("only instances have methods"));
-                    }
-                }
-                Ok(OpCode::SuperInvoke) => {
-                    let name = self.read_string_constant();
-                    let arg_count = self.read_byte() as usize;
-                    let superclass = self.stack.pop().expect("stack");
-                    if let VmValue::Class(sc) = superclass {
-                        self.invoke_from_class(&sc, &name, arg_count)?;
-                    }
-                }
-                Ok(OpCode::Closure) => {
-                    let idx = self.read_byte();
-                    let constant = self.current_chunk().constants[idx as usize].clone();
-                    if let Constant::Function {
-                        name,
-                        arity,
-                        upvalue_count,
-                        chunk,
-                    } = constant
-                    {
-                        let function = Rc::new(VmFunction {
-                            name,
-                            arity,
-                            upvalue_count,
-                            chunk,
-                        });
-                        let mut upvalues = Vec::with_capacity(upvalue_count);
-                        for _ in 0..upvalue_count {
-                            let is_local = self.read_byte();
-                            let index = self.read_byte() as usize;
-                            if is_local == 1 {
-                                let abs_idx =
-                                    self.frames.last().expect("frame").slot_offset + index;
-                                let upvalue = self.capture_upvalue(abs_idx);
-                                upvalues.push(upvalue);
-                            } else {
-                                let upvalue = Rc::clone(
-                                    &self.frames.last().expect("frame").closure.upvalues[index],
-                                );
-                                upvalues.push(upvalue);
-                            }
-                        }
-                        let closure = Rc::new(VmClosure { function, upvalues });
-                        self.stack.push(VmValue::Closure(closure));
-                    }
-                }
-                Ok(OpCode::CloseUpvalue) => {
-                    let idx = self.stack.len() - 1;
-                    self.close_upvalues(idx);
-                    self.stack.pop();
-                }
-                Ok(OpCode::Return) => {
-                    let result = self.stack.pop().expect("stack");
-                    let frame = self.frames.pop().expect("frame");
-                    if self.frames.is_empty() {
-                        self.stack.pop(); // pop script closure
-                        return Ok(());
-                    }
-                    self.close_upvalues(frame.slot_offset);
-                    self.stack.truncate(frame.slot_offset);
-                    self.stack.push(result);
-                }
-                Ok(OpCode::Class) => {
-                    let name = self.read_string_constant();
-                    let class = Rc::new(RefCell::new(VmClass {
-                        name,
-                        methods: HashMap::new(),
-                    }));
-                    self.stack.push(VmValue::Class(class));
-                }
-                Ok(OpCode::Inherit) => {
-                    let superclass = self.stack[self.stack.len() - 2].clone();
-                    let subclass = self.stack.last().expect("stack").clone();
-                    if let (VmValue::Class(sc), VmValue::Class(sub)) = (&superclass, &subclass) {
-                        let methods = sc.borrow().methods.clone();
-                        sub.borrow_mut().methods.extend(methods);
-                        self.stack.pop(); // pop subclass, leave super as local
+    // ========== Opcode handlers ==========
+
+    fn op_invalid(&mut self) -> Result<Flow, RuntimeError> {
+        let frame = self.frames.last().expect("frame");
+        let op = frame.closure().function.chunk.code[frame.ip - 1];
+        Err(self.runtime_error(format!("unknown opcode {op}")))
+    }
+
+    fn op_constant(&mut self) -> Result<Flow, RuntimeError> {
+        let idx = self.read_byte();
+        let constant = self.current_chunk().constants[idx as usize].clone();
+        let value = self.constant_to_value(constant);
+        self.stack.push(value);
+        Ok(Flow::Continue)
+    }
+
+    fn op_constant_long(&mut self) -> Result<Flow, RuntimeError> {
+        let idx = self.read_u16();
+        let constant = self.current_chunk().constants[idx as usize].clone();
+        let value = self.constant_to_value(constant);
+        self.stack.push(value);
+        Ok(Flow::Continue)
+    }
+
+    fn op_nil(&mut self) -> Result<Flow, RuntimeError> {
+        self.stack.push(VmValue::NIL);
+        Ok(Flow::Continue)
+    }
+
+    fn op_true(&mut self) -> Result<Flow, RuntimeError> {
+        self.stack.push(VmValue::TRUE);
+        Ok(Flow::Continue)
+    }
+
+    fn op_false(&mut self) -> Result<Flow, RuntimeError> {
+        self.stack.push(VmValue::FALSE);
+        Ok(Flow::Continue)
+    }
+
+    fn op_pop(&mut self) -> Result<Flow, RuntimeError> {
+        self.stack.pop();
+        Ok(Flow::Continue)
+    }
+
+    fn op_get_local(&mut self) -> Result<Flow, RuntimeError> {
+        let slot = self.read_byte() as usize;
+        let offset = self.frames.last().expect("frame").slot_offset;
+        let value = self.stack[offset + slot];
+        self.stack.push(value);
+        Ok(Flow::Continue)
+    }
+
+    fn op_set_local(&mut self) -> Result<Flow, RuntimeError> {
+        let slot = self.read_byte() as usize;
+        let offset = self.frames.last().expect("frame").slot_offset;
+        let value = *self.stack.last().expect("stack not empty");
+        self.stack[offset + slot] = value;
+        Ok(Flow::Continue)
+    }
+
+    fn op_get_global(&mut self) -> Result<Flow, RuntimeError> {
+        let slot = self.read_u16() as usize;
+        let value = self.globals[slot].ok_or_else(|| self.undefined_variable(slot))?;
+        self.stack.push(value);
+        Ok(Flow::Continue)
+    }
+
+    fn op_set_global(&mut self) -> Result<Flow, RuntimeError> {
+        let slot = self.read_u16() as usize;
+        if self.globals[slot].is_none() {
+            return Err(self.undefined_variable(slot));
+        }
+        let value = *self.stack.last().expect("stack not empty");
+        self.globals[slot] = Some(value);
+        Ok(Flow::Continue)
+    }
+
+    fn op_define_global(&mut self) -> Result<Flow, RuntimeError> {
+        let slot = self.read_u16() as usize;
+        let value = self.stack.pop().expect("stack not empty");
+        self.globals[slot] = Some(value);
+        Ok(Flow::Continue)
+    }
+
+    fn op_get_upvalue(&mut self) -> Result<Flow, RuntimeError> {
+        let slot = self.read_byte() as usize;
+        let upvalue = self.frames.last().expect("frame").closure().upvalues[slot];
+        let value = match upvalue.get().upvalue().get() {
+            VmUpvalue::Open(idx) => self.stack[idx],
+            VmUpvalue::Closed(v) => v,
+        };
+        self.stack.push(value);
+        Ok(Flow::Continue)
+    }
+
+    fn op_set_upvalue(&mut self) -> Result<Flow, RuntimeError> {
+        let slot = self.read_byte() as usize;
+        let value = *self.stack.last().expect("stack not empty");
+        let upvalue = self.frames.last().expect("frame").closure().upvalues[slot];
+        let cell = upvalue.get().upvalue();
+        match cell.get() {
+            VmUpvalue::Open(idx) => {
+                self.stack[idx] = value;
+            }
+            VmUpvalue::Closed(_) => {
+                cell.set(VmUpvalue::Closed(value));
+            }
+        }
+        Ok(Flow::Continue)
+    }
+
+    fn op_get_property(&mut self) -> Result<Flow, RuntimeError> {
+        let name = self.read_string_constant();
+        let cache_slot = self.read_byte() as usize;
+        let instance = self.stack.pop().expect("stack");
+        match instance.as_object() {
+            Some(VmObject::Instance(inst)) => {
+                // Fields shadow methods and live in per-instance maps, so
+                // they always go through the hash lookup.
+                if let Some(val) = inst.borrow().fields.get(&name).copied() {
+                    self.stack.push(val);
+                } else {
+                    let class = inst.borrow().class;
+                    if let Some(method) = self.cached_method(cache_slot, class, &name) {
+                        let bound = self.heap.alloc(VmObject::BoundMethod(VmBoundMethod {
+                            receiver: instance,
+                            method,
+                        }));
+                        self.stack.push(VmValue::from_obj(bound));
                     } else {
-                        return Err(self.runtime_error("superclass must be a class"));
-                    }
-                }
-                Ok(OpCode::Method) => {
-                    let name = self.read_string_constant();
-                    let method = self.stack.pop().expect("stack");
-                    if let (VmValue::Closure(closure), Some(VmValue::Class(class))) =
-                        (method, self.stack.last())
-                    {
-                        class.borrow_mut().methods.insert(name, closure);
+                        return Err(self.runtime_error(format!("undefined property '{name}'")));
                     }
                 }
-                Err(_) => {
-                    return Err(self.runtime_error(format!("unknown opcode {op}")));
+                Ok(Flow::Continue)
+            }
+            _ => Err(self.runtime_error("only instances have properties")),
+        }
+    }
+
+    /// Resolve a method through the current frame's inline cache for
+    /// `cache_slot`, falling back to the class method table on a miss and
+    /// refilling the cache. Method tables are immutable once a class
+    /// declaration has executed, so cached entries never go stale.
+    fn cached_method(&self, cache_slot: usize, class: ObjRef, name: &str) -> Option<ObjRef> {
+        // Sites past the one-byte slot limit compile with the sentinel and
+        // always take the method-table lookup.
+        if cache_slot == UNCACHED_SLOT as usize {
+            return class.get().class().borrow().methods.get(name).copied();
+        }
+        let function = Rc::clone(&self.frames.last().expect("frame").closure().function);
+        if let Some(method) = function
+            .caches
+            .borrow()
+            .get(cache_slot)
+            .and_then(|cache| cache.lookup(class))
+        {
+            return Some(method);
+        }
+        let method = class.get().class().borrow().methods.get(name).copied()?;
+        let mut caches = function.caches.borrow_mut();
+        if caches.len() <= cache_slot {
+            caches.resize_with(cache_slot + 1, PropertyCache::default);
+        }
+        caches[cache_slot].fill(class, method);
+        Some(method)
+    }
+
+    fn op_set_property(&mut self) -> Result<Flow, RuntimeError> {
+        let name = self.read_string_constant();
+        let value = self.stack.pop().expect("stack");
+        let instance = self.stack.pop().expect("stack");
+        match instance.as_object() {
+            Some(VmObject::Instance(inst)) => {
+                inst.borrow_mut().fields.insert(name, value);
+                self.stack.push(value);
+                Ok(Flow::Continue)
+            }
+            _ => Err(self.runtime_error("only instances have fields")),
+        }
+    }
+
+    fn op_get_super(&mut self) -> Result<Flow, RuntimeError> {
+        let name = self.read_string_constant();
+        let superclass = self.stack.pop().expect("stack");
+        let receiver = self.stack.pop().expect("stack");
+        if let Some(VmObject::Class(sc)) = superclass.as_object() {
+            if let Some(method) = sc.borrow().methods.get(&name).copied() {
+                let bound = self
+                    .heap
+                    .alloc(VmObject::BoundMethod(VmBoundMethod { receiver, method }));
+                self.stack.push(VmValue::from_obj(bound));
+            } else {
+                return Err(self.runtime_error(format!("undefined property '{name}'")));
+            }
+        }
+        Ok(Flow::Continue)
+    }
+
+    fn op_equal(&mut self) -> Result<Flow, RuntimeError> {
+        let b = self.stack.pop().expect("stack");
+        let a = self.stack.pop().expect("stack");
+        self.stack.push(VmValue::from_bool(a == b));
+        Ok(Flow::Continue)
+    }
+
+    fn op_greater(&mut self) -> Result<Flow, RuntimeError> {
+        self.binary_op(|a, b| VmValue::from_bool(a > b))?;
+        Ok(Flow::Continue)
+    }
+
+    fn op_less(&mut self) -> Result<Flow, RuntimeError> {
+        self.binary_op(|a, b| VmValue::from_bool(a < b))?;
+        Ok(Flow::Continue)
+    }
+
+    fn op_add(&mut self) -> Result<Flow, RuntimeError> {
+        let b = self.stack.pop().expect("stack");
+        let a = self.stack.pop().expect("stack");
+        self.push_sum(a, b)?;
+        Ok(Flow::Continue)
+    }
+
+    /// Add two values with Lox `+` semantics and push the result.
+    fn push_sum(&mut self, a: VmValue, b: VmValue) -> Result<(), RuntimeError> {
+        if let (Some(x), Some(y)) = (a.as_number(), b.as_number()) {
+            self.stack.push(VmValue::number(x + y));
+        } else if let (Some(VmObject::String(x)), Some(VmObject::String(y))) =
+            (a.as_object(), b.as_object())
+        {
+            let interned = self.intern(format!("{x}{y}"));
+            self.stack.push(VmValue::from_obj(interned));
+        } else {
+            return Err(self.runtime_error("operands must be two numbers or two strings"));
+        }
+        Ok(())
+    }
+
+    fn op_greater_equal(&mut self) -> Result<Flow, RuntimeError> {
+        self.binary_op(|a, b| VmValue::from_bool(a >= b))?;
+        Ok(Flow::Continue)
+    }
+
+    fn op_less_equal(&mut self) -> Result<Flow, RuntimeError> {
+        self.binary_op(|a, b| VmValue::from_bool(a <= b))?;
+        Ok(Flow::Continue)
+    }
+
+    fn op_not_equal(&mut self) -> Result<Flow, RuntimeError> {
+        let b = self.stack.pop().expect("stack");
+        let a = self.stack.pop().expect("stack");
+        self.stack.push(VmValue::from_bool(a != b));
+        Ok(Flow::Continue)
+    }
+
+    fn op_local_add_constant(&mut self) -> Result<Flow, RuntimeError> {
+        let slot = self.read_byte() as usize;
+        let idx = self.read_byte();
+        let slot_offset = self.frames.last().expect("frame").slot_offset;
+        let a = self.stack[slot_offset + slot];
+        let constant = self.current_chunk().constants[idx as usize].clone();
+        let b = self.constant_to_value(constant);
+        self.push_sum(a, b)?;
+        Ok(Flow::Continue)
+    }
+
+    fn op_less_jump_if_false(&mut self) -> Result<Flow, RuntimeError> {
+        self.binary_op(|a, b| VmValue::from_bool(a < b))?;
+        self.jump_if_top_falsey();
+        Ok(Flow::Continue)
+    }
+
+    fn op_greater_jump_if_false(&mut self) -> Result<Flow, RuntimeError> {
+        self.binary_op(|a, b| VmValue::from_bool(a > b))?;
+        self.jump_if_top_falsey();
+        Ok(Flow::Continue)
+    }
+
+    fn op_equal_jump_if_false(&mut self) -> Result<Flow, RuntimeError> {
+        let b = self.stack.pop().expect("stack");
+        let a = self.stack.pop().expect("stack");
+        self.stack.push(VmValue::from_bool(a == b));
+        self.jump_if_top_falsey();
+        Ok(Flow::Continue)
+    }
+
+    /// Shared tail of the fused compare-and-branch opcodes: read the jump
+    /// offset and take it when the just-pushed comparison result is falsey.
+    /// The result stays on the stack, exactly like `jump_if_false`.
+    fn jump_if_top_falsey(&mut self) {
+        let offset = self.read_u16();
+        if self.stack.last().expect("stack").is_falsey() {
+            self.frames.last_mut().expect("frame").ip += offset as usize;
+        }
+    }
+
+    fn op_subtract(&mut self) -> Result<Flow, RuntimeError> {
+        self.binary_op(|a, b| VmValue::number(a - b))?;
+        Ok(Flow::Continue)
+    }
+
+    fn op_multiply(&mut self) -> Result<Flow, RuntimeError> {
+        self.binary_op(|a, b| VmValue::number(a * b))?;
+        Ok(Flow::Continue)
+    }
+
+    fn op_divide(&mut self) -> Result<Flow, RuntimeError> {
+        self.binary_op(|a, b| VmValue::number(a / b))?;
+        Ok(Flow::Continue)
+    }
+
+    fn op_not(&mut self) -> Result<Flow, RuntimeError> {
+        let val = self.stack.pop().expect("stack");
+        self.stack.push(VmValue::from_bool(val.is_falsey()));
+        Ok(Flow::Continue)
+    }
+
+    fn op_negate(&mut self) -> Result<Flow, RuntimeError> {
+        let val = self.stack.pop().expect("stack");
+        match val.as_number() {
+            Some(n) => {
+                self.stack.push(VmValue::number(-n));
+                Ok(Flow::Continue)
+            }
+            None => Err(self.runtime_error("operand must be a number")),
+        }
+    }
+
+    fn op_print(&mut self) -> Result<Flow, RuntimeError> {
+        let val = self.stack.pop().expect("stack");
+        if self.capture {
+            self.output.push(format!("{val}"));
+        } else {
+            writeln!(self.writer, "{val}").expect("write should succeed");
+        }
+        Ok(Flow::Continue)
+    }
+
+    fn op_jump(&mut self) -> Result<Flow, RuntimeError> {
+        let offset = self.read_u16();
+        self.frames.last_mut().expect("frame").ip += offset as usize;
+        Ok(Flow::Continue)
+    }
+
+    fn op_jump_if_false(&mut self) -> Result<Flow, RuntimeError> {
+        let offset = self.read_u16();
+        if self.stack.last().expect("stack").is_falsey() {
+            self.frames.last_mut().expect("frame").ip += offset as usize;
+        }
+        Ok(Flow::Continue)
+    }
+
+    fn op_loop(&mut self) -> Result<Flow, RuntimeError> {
+        let offset = self.read_u16();
+        self.frames.last_mut().expect("frame").ip -= offset as usize;
+        Ok(Flow::Continue)
+    }
+
+    fn op_call(&mut self) -> Result<Flow, RuntimeError> {
+        let arg_count = self.read_byte() as usize;
+        let callee_idx = self.stack.len() - 1 - arg_count;
+        let callee = self.stack[callee_idx];
+        self.call_value(callee, arg_count)?;
+        Ok(Flow::Continue)
+    }
+
+    /// Like `op_call`, but for calls in tail position: a plain closure
+    /// callee reuses the current frame — upvalues over the departing
+    /// frame's slots are closed, the callee and arguments slide down to
+    /// the frame base, and execution restarts at the callee's entry — so
+    /// tail recursion runs in constant frame space. Any other callee
+    /// (native, class, bound method) falls back to an ordinary call; the
+    /// `Return` compiled right after this opcode then returns its result.
+    fn op_tail_call(&mut self) -> Result<Flow, RuntimeError> {
+        let arg_count = self.read_byte() as usize;
+        let callee_idx = self.stack.len() - 1 - arg_count;
+        let callee = self.stack[callee_idx];
+        let closure_obj = callee
+            .as_obj()
+            .filter(|o| matches!(o.get(), VmObject::Closure(_)));
+        let Some(obj) = closure_obj else {
+            self.call_value(callee, arg_count)?;
+            return Ok(Flow::Continue);
+        };
+        let arity = obj.get().closure().function.arity;
+        if arg_count != arity {
+            return Err(
+                self.runtime_error(format!("expected {arity} arguments but got {arg_count}"))
+            );
+        }
+        if let Some(profiler) = &mut self.profiler {
+            profiler.record_call(&obj.get().closure().function.name);
+        }
+        let base = self.frames.last().expect("frame").slot_offset;
+        self.close_upvalues(base);
+        for i in 0..=arg_count {
+            self.stack[base + i] = self.stack[callee_idx + i];
+        }
+        self.stack.truncate(base + arg_count + 1);
+        let frame = self.frames.last_mut().expect("frame");
+        frame.closure = obj;
+        frame.ip = 0;
+        Ok(Flow::Continue)
+    }
+
+    fn op_invoke(&mut self) -> Result<Flow, RuntimeError> {
+        let name = self.read_string_constant();
+        let arg_count = self.read_byte() as usize;
+        let receiver_idx = self.stack.len() - 1 - arg_count;
+        let receiver = self.stack[receiver_idx];
+        if let Some(VmObject::Instance(inst)) = receiver.as_object() {
+            if let Some(field) = inst.borrow().fields.get(&name).copied() {
+                self.stack[receiver_idx] = field;
+                self.call_value(field, arg_count)?;
+            } else {
+                let class = inst.borrow().class;
+                self.invoke_from_class(class, &name, arg_count)?;
+            }
+            Ok(Flow::Continue)
+        } else {
+            Err(self.runtime_error("only instances have methods"))
+        }
+    }
+
+    fn op_super_invoke(&mut self) -> Result<Flow, RuntimeError> {
+        let name = self.read_string_constant();
+        let arg_count = self.read_byte() as usize;
+        let superclass = self.stack.pop().expect("stack");
+        if let Some(sc) = superclass.as_obj() {
+            self.invoke_from_class(sc, &name, arg_count)?;
+        }
+        Ok(Flow::Continue)
+    }
+
+    fn op_closure(&mut self) -> Result<Flow, RuntimeError> {
+        let idx = self.read_u16();
+        let constant = self.current_chunk().constants[idx as usize].clone();
+        if let Constant::Function {
+            name,
+            arity,
+            upvalue_count,
+            chunk,
+        } = constant
+        {
+            let function = Rc::new(VmFunction {
+                name,
+                arity,
+                upvalue_count,
+                chunk: Arc::new(chunk),
+                caches: RefCell::new(Vec::new()),
+            });
+            let mut upvalues = Vec::with_capacity(upvalue_count);
+            for _ in 0..upvalue_count {
+                let is_local = self.read_byte();
+                let index = self.read_byte() as usize;
+                if is_local == 1 {
+                    let abs_idx = self.frames.last().expect("frame").slot_offset + index;
+                    let upvalue = self.capture_upvalue(abs_idx);
+                    upvalues.push(upvalue);
+                } else {
+                    let upvalue = self.frames.last().expect("frame").closure().upvalues[index];
+                    upvalues.push(upvalue);
                 }
             }
+            let closure = self.heap.alloc(VmObject::Closure(VmClosure {
+                function,
+                upvalues: upvalues.into_boxed_slice(),
+            }));
+            self.stack.push(VmValue::from_obj(closure));
+        }
+        Ok(Flow::Continue)
+    }
+
+    fn op_close_upvalue(&mut self) -> Result<Flow, RuntimeError> {
+        let idx = self.stack.len() - 1;
+        self.close_upvalues(idx);
+        self.stack.pop();
+        Ok(Flow::Continue)
+    }
+
+    fn op_return(&mut self) -> Result<Flow, RuntimeError> {
+        let result = self.stack.pop().expect("stack");
+        let frame = self.frames.pop().expect("frame");
+        if self.frames.is_empty() {
+            self.stack.pop(); // pop script closure
+            return Ok(Flow::Halt);
+        }
+        self.close_upvalues(frame.slot_offset);
+        self.stack.truncate(frame.slot_offset);
+        self.stack.push(result);
+        Ok(Flow::Continue)
+    }
+
+    fn op_class(&mut self) -> Result<Flow, RuntimeError> {
+        let name = self.read_string_constant();
+        let class = self.heap.alloc(VmObject::Class(RefCell::new(VmClass {
+            name,
+            methods: HashMap::new(),
+        })));
+        self.stack.push(VmValue::from_obj(class));
+        Ok(Flow::Continue)
+    }
+
+    fn op_inherit(&mut self) -> Result<Flow, RuntimeError> {
+        let superclass = self.stack[self.stack.len() - 2];
+        let subclass = *self.stack.last().expect("stack");
+        if let (Some(VmObject::Class(sc)), Some(VmObject::Class(sub))) =
+            (superclass.as_object(), subclass.as_object())
+        {
+            let methods = sc.borrow().methods.clone();
+            sub.borrow_mut().methods.extend(methods);
+            self.stack.pop(); // pop subclass, leave super as local
+            Ok(Flow::Continue)
+        } else {
+            Err(self.runtime_error("superclass must be a class"))
+        }
+    }
+
+    fn op_method(&mut self) -> Result<Flow, RuntimeError> {
+        let name = self.read_string_constant();
+        let method = self.stack.pop().expect("stack");
+        if let Some(m) = method.as_obj()
+            && matches!(m.get(), VmObject::Closure(_))
+            && let Some(VmObject::Class(class)) = self.stack.last().and_then(|v| v.as_object())
+        {
+            class.borrow_mut().methods.insert(name, m);
         }
+        Ok(Flow::Continue)
     }
 
     fn read_byte(&mut self) -> u8 {
         let frame = self.frames.last_mut().expect("frame");
-        let byte = frame.closure.function.chunk.code[frame.ip];
+        let byte = frame.closure.get().closure().function.chunk.code[frame.ip];
         frame.ip += 1;
         byte
     }
 
     fn read_u16(&mut self) -> u16 {
         let frame = self.frames.last_mut().expect("frame");
-        let value = frame.closure.function.chunk.read_u16(frame.ip);
+        let value = frame
+            .closure
+            .get()
+            .closure()
+            .function
+            .chunk
+            .read_u16(frame.ip);
         frame.ip += 2;
         value
     }
 
+    fn undefined_variable(&self, slot: usize) -> RuntimeError {
+        self.runtime_error(format!("undefined variable '{}'", self.global_names[slot]))
+    }
+
+    /// Read the 16-bit constant-pool operand of a naming opcode and return
+    /// its string. Naming operands are wide so generated code with many
+    /// distinct literals cannot push a name past a single-byte index.
     fn read_string_constant(&mut self) -> String {
-        let idx = self.read_byte();
+        let idx = self.read_u16();
         let constant = &self.current_chunk().constants[idx as usize];
         match constant {
             Constant::String(s) => s.clone(),
@@ -561,24 +987,39 @@ impl Vm {
     }
 
     fn current_chunk(&self) -> &Chunk {
-        &self.frames.last().expect("frame").closure.function.chunk
+        &self.frames.last().expect("frame").closure().function.chunk
     }
 
     fn binary_op(&mut self, op: fn(f64, f64) -> VmValue) -> Result<(), RuntimeError> {
         let b = self.stack.pop().expect("stack");
         let a = self.stack.pop().expect("stack");
-        match (&a, &b) {
-            (VmValue::Number(x), VmValue::Number(y)) => {
-                self.stack.push(op(*x, *y));
+        match (a.as_number(), b.as_number()) {
+            (Some(x), Some(y)) => {
+                self.stack.push(op(x, y));
                 Ok(())
             }
             _ => Err(self.runtime_error("operands must be numbers")),
         }
     }
 
+    /// Push a call frame for `closure`, counting the call when profiling.
+    fn push_frame(&mut self, closure: ObjRef, slot_offset: usize) {
+        if let Some(profiler) = &mut self.profiler {
+            profiler.record_call(&closure.get().closure().function.name);
+        }
+        self.frames.push(CallFrame {
+            closure,
+            ip: 0,
+            slot_offset,
+        });
+    }
+
     fn call_value(&mut self, callee: VmValue, arg_count: usize) -> Result<(), RuntimeError> {
-        match callee {
-            VmValue::Closure(closure) => {
+        let Some(obj) = callee.as_obj() else {
+            return Err(self.runtime_error("can only call functions and classes"));
+        };
+        match obj.get() {
+            VmObject::Closure(closure) => {
                 if arg_count != closure.function.arity {
                     return Err(self.runtime_error(format!(
                         "expected {} arguments but got {arg_count}",
@@ -586,14 +1027,10 @@ impl Vm {
                     )));
                 }
                 let slot_offset = self.stack.len() - arg_count - 1;
-                self.frames.push(CallFrame {
-                    closure,
-                    ip: 0,
-                    slot_offset,
-                });
+                self.push_frame(obj, slot_offset);
                 Ok(())
             }
-            VmValue::NativeFunction(native) => {
+            VmObject::NativeFunction(native) => {
                 // Check arity for each native function.
                 let expected_arity = match native {
                     NativeFn::Clock | NativeFn::ReadLine => 0,
@@ -610,24 +1047,26 @@ impl Vm {
                             .duration_since(UNIX_EPOCH)
                             .expect("system clock should be after unix epoch")
                             .as_secs_f64();
-                        VmValue::Number(secs)
+                        VmValue::number(secs)
                     }
                     NativeFn::ReadLine => {
                         match crate::stdlib::read_line_from(&mut std::io::stdin().lock()) {
-                            None => VmValue::Nil,
-                            Some(s) => VmValue::String(Rc::new(s)),
+                            None => VmValue::NIL,
+                            Some(s) => VmValue::from_obj(self.intern(s)),
                         }
                     }
                     NativeFn::ToNumber => {
                         // arg_count == 1 is guaranteed by the arity check above
-                        let arg = self.stack[self.stack.len() - 1].clone();
-                        match arg {
-                            VmValue::Number(_) => arg,
-                            VmValue::String(s) => match crate::stdlib::parse_lox_number(&s) {
-                                Some(n) => VmValue::Number(n),
-                                None => VmValue::Nil,
-                            },
-                            _ => VmValue::Nil,
+                        let arg = self.stack[self.stack.len() - 1];
+                        if arg.is_number() {
+                            arg
+                        } else if let Some(VmObject::String(s)) = arg.as_object() {
+                            match crate::stdlib::parse_lox_number(s) {
+                                Some(n) => VmValue::number(n),
+                                None => VmValue::NIL,
+                            }
+                        } else {
+                            VmValue::NIL
                         }
                     }
                 };
@@ -637,26 +1076,22 @@ impl Vm {
                 self.stack.push(result);
                 Ok(())
             }
-            VmValue::Class(class) => {
-                let instance = Rc::new(RefCell::new(VmInstance {
-                    class: Rc::clone(&class),
+            VmObject::Class(class) => {
+                let instance = self.heap.alloc(VmObject::Instance(RefCell::new(VmInstance {
+                    class: obj,
                     fields: HashMap::new(),
-                }));
+                })));
                 let slot_offset = self.stack.len() - arg_count - 1;
-                self.stack[slot_offset] = VmValue::Instance(Rc::clone(&instance));
+                self.stack[slot_offset] = VmValue::from_obj(instance);
 
-                if let Some(init) = class.borrow().methods.get("init").cloned() {
-                    if arg_count != init.function.arity {
+                if let Some(init) = class.borrow().methods.get("init").copied() {
+                    if arg_count != init.get().closure().function.arity {
                         return Err(self.runtime_error(format!(
                             "expected {} arguments but got {arg_count}",
-                            init.function.arity
+                            init.get().closure().function.arity
                         )));
                     }
-                    self.frames.push(CallFrame {
-                        closure: init,
-                        ip: 0,
-                        slot_offset,
-                    });
+                    self.push_frame(init, slot_offset);
                 } else if arg_count != 0 {
                     return Err(
                         self.runtime_error(format!("expected 0 arguments but got {arg_count}"))
@@ -664,20 +1099,16 @@ impl Vm {
                 }
                 Ok(())
             }
-            VmValue::BoundMethod(bm) => {
+            VmObject::BoundMethod(bm) => {
                 let slot_offset = self.stack.len() - arg_count - 1;
-                self.stack[slot_offset] = bm.receiver.clone();
-                if arg_count != bm.method.function.arity {
+                self.stack[slot_offset] = bm.receiver;
+                if arg_count != bm.method.get().closure().function.arity {
                     return Err(self.runtime_error(format!(
                         "expected {} arguments but got {arg_count}",
-                        bm.method.function.arity
+                        bm.method.get().closure().function.arity
                     )));
                 }
-                self.frames.push(CallFrame {
-                    closure: Rc::clone(&bm.method),
-                    ip: 0,
-                    slot_offset,
-                });
+                self.push_frame(bm.method, slot_offset);
                 Ok(())
             }
             _ => Err(self.runtime_error("can only call functions and classes")),
@@ -686,90 +1117,82 @@ impl Vm {
 
     fn invoke_from_class(
         &mut self,
-        class: &Rc<RefCell<VmClass>>,
+        class: ObjRef,
         name: &str,
         arg_count: usize,
     ) -> Result<(), RuntimeError> {
         let method = class
+            .get()
+            .class()
             .borrow()
             .methods
             .get(name)
-            .cloned()
+            .copied()
             .ok_or_else(|| self.runtime_error(format!("undefined property '{name}'")))?;
         let slot_offset = self.stack.len() - arg_count - 1;
-        self.frames.push(CallFrame {
-            closure: method,
-            ip: 0,
-            slot_offset,
-        });
+        self.push_frame(method, slot_offset);
         Ok(())
     }
 
-    fn capture_upvalue(&mut self, stack_idx: usize) -> Rc<RefCell<VmUpvalue>> {
-        for uv in &self.open_upvalues {
-            if let VmUpvalue::Open(idx) = &*uv.borrow()
-                && *idx == stack_idx
-            {
-                return Rc::clone(uv);
+    /// Find or create the open upvalue for a stack slot, keeping
+    /// `open_upvalues` sorted by slot. The scan runs from the back and stops
+    /// at the first slot below the target: captures almost always hit the
+    /// innermost frames, so this touches a handful of entries regardless of
+    /// how many outer closures are still open.
+    fn capture_upvalue(&mut self, stack_idx: usize) -> ObjRef {
+        let mut insert_at = 0;
+        for (i, &uv) in self.open_upvalues.iter().enumerate().rev() {
+            let slot = open_slot(uv);
+            if slot == stack_idx {
+                return uv;
+            }
+            if slot < stack_idx {
+                insert_at = i + 1;
+                break;
             }
         }
-        let upvalue = Rc::new(RefCell::new(VmUpvalue::Open(stack_idx)));
-        self.open_upvalues.push(Rc::clone(&upvalue));
+        let upvalue = self
+            .heap
+            .alloc(VmObject::Upvalue(Cell::new(VmUpvalue::Open(stack_idx))));
+        self.open_upvalues.insert(insert_at, upvalue);
         upvalue
     }
 
+    /// Close every open upvalue at or above stack slot `last`. The list is
+    /// sorted by slot, so the affected entries are exactly its tail and the
+    /// whole operation is a suffix pop — no mid-list removals.
     fn close_upvalues(&mut self, last: usize) {
-        let mut i = 0;
-        while i < self.open_upvalues.len() {
-            let should_close = {
-                let uv = self.open_upvalues[i].borrow();
-                if let VmUpvalue::Open(idx) = &*uv {
-                    *idx >= last
-                } else {
-                    false
-                }
-            };
-            if should_close {
-                let uv = self.open_upvalues.remove(i);
-                let value = {
-                    let borrowed = uv.borrow();
-                    if let VmUpvalue::Open(idx) = &*borrowed {
-                        self.stack[*idx].clone()
-                    } else {
-                        unreachable!()
-                    }
-                };
-                *uv.borrow_mut() = VmUpvalue::Closed(value);
-            } else {
-                i += 1;
+        while let Some(&uv) = self.open_upvalues.last() {
+            let cell = uv.get().upvalue();
+            let idx = open_slot(uv);
+            if idx < last {
+                break;
             }
+            cell.set(VmUpvalue::Closed(self.stack[idx]));
+            self.open_upvalues.pop();
         }
     }
 }
 
-impl Default for Vm {
-    fn default() -> Self {
-        Self::new()
+/// Stack slot of an entry on the open-upvalue list. Entries are always in
+/// the `Open` state: `close_upvalues` pops an upvalue in the same step that
+/// closes it.
+fn open_slot(uv: ObjRef) -> usize {
+    match uv.get().upvalue().get() {
+        VmUpvalue::Open(idx) => idx,
+        VmUpvalue::Closed(_) => unreachable!("closed upvalue on the open list"),
     }
 }
 
-fn constant_to_value(constant: Constant) -> VmValue {
-    match constant {
-        Constant::Number(n) => VmValue::Number(n),
-        Constant::String(s) => VmValue::String(Rc::new(s)),
-        Constant::Function { .. } => {
-            panic!("function constants should be handled by Closure opcode")
-        }
-    }
+/// Returns true if the user has opted into GC stats on stderr via the
+/// LOX_GC_STATS env var.
+fn gc_stats_enabled() -> bool {
+    matches!(std::env::var("LOX_GC_STATS").as_deref(), Ok("1"))
 }
 
-fn values_equal(a: &VmValue, b: &VmValue) -> bool {
-    match (a, b) {
-        (VmValue::Nil, VmValue::Nil) => true,
-        (VmValue::Bool(a), VmValue::Bool(b)) => a == b,
-        (VmValue::Number(a), VmValue::Number(b)) => a == b,
-        (VmValue::String(a), VmValue::String(b)) => a == b,
-        _ => false,
+impl Default for Vm {
+    fn default() -> Self {
+        Self::new()
     }
 }
 
@@ -891,6 +1314,198 @@ mod tests {
         );
     }
 
+    #[test]
+    fn vm_dispatch_modes_agree() {
+        let source =
+            "fun fib(n) { if (n <= 1) return n; return fib(n - 1) + fib(n - 2); } print fib(10);";
+        let tokens = scanner::scan(source).expect("scan");
+        let program = Parser::new(tokens).parse().expect("parse");
+        let chunk = Compiler::new().compile(&program).expect("compile");
+        let mut switch_vm = Vm::with_dispatch(DispatchMode::Switch);
+        switch_vm.writer = Box::new(std::io::sink());
+        switch_vm.capture = true;
+        switch_vm.interpret(chunk).expect("interpret");
+        assert_eq!(switch_vm.output, run_vm(source));
+    }
+
+    #[test]
+    fn vm_does_not_capture_output_by_default() {
+        let source = "print 1 + 2;";
+        let tokens = scanner::scan(source).expect("scan");
+        let program = Parser::new(tokens).parse().expect("parse");
+        let chunk = Compiler::new().compile(&program).expect("compile");
+        let mut vm = Vm::new();
+        vm.writer = Box::new(std::io::sink());
+        vm.interpret(chunk).expect("interpret");
+        assert!(vm.output().is_empty());
+    }
+
+    // ========== Shared Programs ==========
+
+    #[test]
+    fn vm_shared_program_runs_in_many_vms() {
+        let program = CompiledProgram::from_source(
+            r#"
+            fun counter() {
+                var n = 0;
+                fun inc() { n = n + 1; return n; }
+                return inc;
+            }
+            var c = counter();
+            print c();
+            print "total: " + "done";
+        "#,
+        )
+        .expect("compile");
+        for _ in 0..2 {
+            let mut vm = Vm::new_capturing();
+            vm.interpret_program(&program).expect("interpret");
+            assert_eq!(vm.output, vec!["1", "total: done"]);
+        }
+    }
+
+    #[test]
+    fn vm_shared_program_runs_across_threads() {
+        let program = Arc::new(
+            CompiledProgram::from_source(
+                "fun fib(n) { if (n <= 1) return n; return fib(n - 1) + fib(n - 2); } print fib(12);",
+            )
+            .expect("compile"),
+        );
+        std::thread::scope(|scope| {
+            for _ in 0..4 {
+                let program = Arc::clone(&program);
+                scope.spawn(move || {
+                    let mut vm = Vm::new_capturing();
+                    vm.interpret_program(&program).expect("interpret");
+                    assert_eq!(vm.output, vec!["144"]);
+                });
+            }
+        });
+    }
+
+    #[test]
+    fn vm_string_interning_collapses_duplicates() {
+        let source = r#"var a = "he" + "llo"; var b = "hello";"#;
+        let tokens = scanner::scan(source).expect("scan");
+        let program = Parser::new(tokens).parse().expect("parse");
+        let chunk = Compiler::new().compile(&program).expect("compile");
+        let mut vm = Vm::new_capturing();
+        vm.interpret(chunk).expect("interpret");
+        // The concat result and the literal share one interned object:
+        // globals a and b both hold the handle from the intern table.
+        let interned = *vm.strings.get("hello").expect("interned");
+        let global = |name: &str| {
+            let slot = vm
+                .global_names
+                .iter()
+                .position(|n| n == name)
+                .expect("global slot");
+            vm.globals[slot].expect("defined").as_obj().expect("object")
+        };
+        assert_eq!(global("a"), interned);
+        assert_eq!(global("b"), interned);
+    }
+
+    #[test]
+    fn vm_gc_collects_unreachable_cycles() {
+        // Each iteration builds a self-referential instance that reference
+        // counting could never reclaim, then drops every handle to it.
+        let source = r#"
+            class Node {}
+            fun make() { var n = Node(); n.self = n; }
+            for (var i = 0; i < 10; i = i + 1) { make(); }
+        "#;
+        let tokens = scanner::scan(source).expect("scan");
+        let program = Parser::new(tokens).parse().expect("parse");
+        let chunk = Compiler::new().compile(&program).expect("compile");
+        let mut vm = Vm::new_capturing();
+        vm.interpret(chunk).expect("interpret");
+
+        vm.collect_garbage();
+        let stats = vm.gc_stats();
+        assert!(stats.collections >= 1);
+        assert!(
+            stats.objects_freed >= 10,
+            "cyclic instances should be freed, got {}",
+            stats.objects_freed
+        );
+        assert!(stats.total_pause >= stats.last_pause);
+    }
+
+    #[test]
+    fn vm_property_sites_past_cache_limit() {
+        // The 301st access site carries the uncached sentinel; the method
+        // lookup there must still resolve through the class table.
+        let mut source =
+            String::from("class C { m() { return 7; } } var o = C(); o.f = 1; var t = 0;");
+        for _ in 0..300 {
+            source.push_str("t = t + o.f;");
+        }
+        source.push_str("print t + o.m();");
+        let output = run_vm(&source);
+        assert_eq!(output.last().map(String::as_str), Some("307"));
+    }
+
+    #[test]
+    fn vm_gc_frees_intermediate_strings() {
+        // Growing a string in a loop leaves every intermediate result in the
+        // intern table; the weak table lets collection reclaim all but the
+        // final value instead of pinning quadratic memory.
+        let source = r#"
+            var s = "";
+            for (var i = 0; i < 50; i = i + 1) { s = s + "x"; }
+        "#;
+        let tokens = scanner::scan(source).expect("scan");
+        let program = Parser::new(tokens).parse().expect("parse");
+        let chunk = Compiler::new().compile(&program).expect("compile");
+        let mut vm = Vm::new_capturing();
+        vm.interpret(chunk).expect("interpret");
+
+        let before = vm.strings.len();
+        vm.collect_garbage();
+        assert!(vm.strings.len() < before);
+        assert!(vm.strings.contains_key(&"x".repeat(50)));
+        assert!(!vm.strings.contains_key("xxx"), "dead intermediate pinned");
+    }
+
+    #[test]
+    fn vm_wide_constant_pool() {
+        // Past 256 distinct constants the compiler switches to constant_long.
+        let source: String = (0..300).map(|i| format!("print {i}.5;")).collect();
+        let expected: Vec<String> = (0..300).map(|i| format!("{i}.5")).collect();
+        assert_eq!(run_vm(&source), expected);
+    }
+
+    #[test]
+    fn vm_wide_pool_name_constants_still_resolve() {
+        // 300 literals push every name constant past a single-byte index;
+        // the wide naming operands must round-trip through the VM.
+        let mut source: String = (0..300).map(|i| format!("print {i}.5;")).collect();
+        source.push_str(
+            r#"
+            fun f() { return 1; }
+            class A { m() { return 10; } }
+            class B < A { m() { return super.m() + f(); } }
+            var b = B();
+            b.x = 2;
+            print b.m() + b.x;
+        "#,
+        );
+        let output = run_vm(&source);
+        assert_eq!(output.last().map(String::as_str), Some("13"));
+    }
+
+    #[test]
+    fn vm_globals_past_byte_slot_resolve() {
+        // More than 256 top-level variables; the wide slot operands must
+        // read and write the right entries in the global table.
+        let mut source: String = (0..300).map(|i| format!("var g{i} = {i};")).collect();
+        source.push_str("g299 = g299 + g42; print g299;");
+        let output = run_vm(&source);
+        assert_eq!(output.last().map(String::as_str), Some("341"));
+    }
+
     #[test]
     fn vm_undefined_variable() {
         let err = run_vm_err("print x;");
@@ -1103,6 +1718,54 @@ mod tests {
         );
     }
 
+    #[test]
+    fn vm_captures_out_of_slot_order() {
+        // `inner` references b before a, so capture order runs against
+        // slot order — the open list must stay sorted regardless.
+        assert_eq!(
+            run_vm(
+                r#"
+                fun outer() {
+                    var a = 1;
+                    var b = 10;
+                    fun inner() { b = b + 1; return b + a; }
+                    return inner;
+                }
+                var f = outer();
+                print f();
+                print f();
+            "#
+            ),
+            vec!["12", "13"]
+        );
+    }
+
+    #[test]
+    fn vm_closes_inner_scope_but_keeps_outer_open() {
+        // Returning from inner() closes only its upvalue; x stays open and
+        // shared, so mutations through either closure remain visible.
+        assert_eq!(
+            run_vm(
+                r#"
+                fun outer() {
+                    var x = 0;
+                    fun inner() {
+                        var y = 100;
+                        fun grab() { return y; }
+                        x = x + 1;
+                        return grab;
+                    }
+                    var g = inner();
+                    print g();
+                    print x;
+                }
+                outer();
+            "#
+            ),
+            vec!["100", "1"]
+        );
+    }
+
     // ========== Classes ==========
 
     #[test]
@@ -1173,6 +1836,26 @@ mod tests {
         );
     }
 
+    #[test]
+    fn vm_polymorphic_call_site() {
+        // One property site sees several receiver classes in turn; the
+        // inline cache must refill rather than serve a stale method.
+        assert_eq!(
+            run_vm(
+                r#"
+                class A { name() { return "a"; } }
+                class B { name() { return "b"; } }
+                fun describe(obj) { return obj.name(); }
+                for (var i = 0; i < 3; i = i + 1) {
+                    print describe(A());
+                    print describe(B());
+                }
+            "#
+            ),
+            vec!["a", "b", "a", "b", "a", "b"]
+        );
+    }
+
     #[test]
     fn vm_class_super_call() {
         assert_eq!(
@@ -1190,6 +1873,65 @@ mod tests {
         );
     }
 
+    // ========== Tail Calls ==========
+
+    #[test]
+    fn vm_tail_recursion_reuses_frame() {
+        let source = "fun sum(n, acc) { if (n == 0) return acc; return sum(n - 1, acc + n); } print sum(100000, 0);";
+        let tokens = scanner::scan(source).expect("scan");
+        let program = Parser::new(tokens).parse().expect("parse");
+        let chunk = Compiler::new().compile(&program).expect("compile");
+        let mut vm = Vm::new_capturing();
+        vm.interpret(chunk).expect("interpret");
+        assert_eq!(vm.output, vec!["5000050000"]);
+        // 100k recursive calls ran in the one reused frame: the frame stack
+        // never grew past its initial allocation.
+        assert!(vm.frames.capacity() <= 64);
+    }
+
+    #[test]
+    fn vm_mutual_tail_recursion() {
+        assert_eq!(
+            run_vm(
+                "fun isEven(n) { if (n == 0) return true; return isOdd(n - 1); } fun isOdd(n) { if (n == 0) return false; return isEven(n - 1); } print isEven(100001);"
+            ),
+            vec!["false"]
+        );
+    }
+
+    #[test]
+    fn vm_tail_call_closes_departing_upvalues() {
+        // `make`'s frame is reused by `use`, so the upvalue over `x` must be
+        // closed before the slot is overwritten.
+        assert_eq!(
+            run_vm(
+                r#"
+                fun use(g) { return g(); }
+                fun make(n) {
+                    var x = n;
+                    fun get() { return x; }
+                    return use(get);
+                }
+                print make(7);
+            "#
+            ),
+            vec!["7"]
+        );
+    }
+
+    #[test]
+    fn vm_tail_call_falls_back_for_native() {
+        let output = run_vm("fun now() { return clock(); } print now();");
+        assert_eq!(output.len(), 1);
+        assert!(output[0].parse::<f64>().is_ok());
+    }
+
+    #[test]
+    fn vm_tail_call_wrong_arity() {
+        let err = run_vm_err("fun f(a) { return a; } fun g() { return f(1, 2); } g();");
+        assert!(err.to_string().contains("expected 1"));
+    }
+
     // ========== Error Cases ==========
 
     #[test]
@@ -0,0 +1,109 @@
+use std::path::{Path, PathBuf};
+use std::process::Command;
+
+use vibe_lox::vm::blox;
+
+/// Set up a batch directory under `tmp/` containing copies of the given
+/// fixtures, with the last one placed in a nested subdirectory to cover the
+/// recursive walk.
+fn setup_batch_dir(name: &str, fixtures: &[&str]) -> PathBuf {
+    let project_root = PathBuf::from(env!("CARGO_MANIFEST_DIR"));
+    let batch_dir = project_root.join("tmp").join(name);
+    let _ = std::fs::remove_dir_all(&batch_dir);
+    let nested = batch_dir.join("nested");
+    std::fs::create_dir_all(&nested).expect("create batch dir");
+
+    for (i, fixture) in fixtures.iter().enumerate() {
+        let src = project_root.join("fixtures").join(fixture);
+        let dst_dir = if i == fixtures.len() - 1 {
+            &nested
+        } else {
+            &batch_dir
+        };
+        std::fs::copy(&src, dst_dir.join(fixture)).expect("copy fixture into batch dir");
+    }
+    batch_dir
+}
+
+fn run_batch_compile(batch_dir: &Path) -> std::process::Output {
+    Command::new(env!("CARGO_BIN_EXE_vibe-lox"))
+        .args(["--compile-bytecode", "--batch", batch_dir.to_str().unwrap()])
+        .output()
+        .expect("run vibe-lox --compile-bytecode --batch")
+}
+
+#[test]
+fn batch_compiles_every_lox_file_recursively() {
+    let batch_dir = setup_batch_dir("batch_ok", &["hello.lox", "arithmetic.lox", "fib.lox"]);
+
+    let output = run_batch_compile(&batch_dir);
+    assert!(
+        output.status.success(),
+        "batch compile failed: {}",
+        String::from_utf8_lossy(&output.stderr)
+    );
+    let stdout = String::from_utf8_lossy(&output.stdout);
+    assert!(
+        stdout.contains("Compiled 3 of 3 files"),
+        "unexpected summary: {stdout}"
+    );
+
+    for blox_path in [
+        batch_dir.join("hello.blox"),
+        batch_dir.join("arithmetic.blox"),
+        batch_dir.join("nested/fib.blox"),
+    ] {
+        assert!(
+            blox::is_bytecode_file(&blox_path).expect("stat batch output"),
+            "missing or invalid bytecode file {}",
+            blox_path.display()
+        );
+    }
+
+    let _ = std::fs::remove_dir_all(&batch_dir);
+}
+
+#[test]
+fn batch_reports_failures_but_compiles_the_rest() {
+    let batch_dir = setup_batch_dir("batch_err", &["error_missing_semicolon.lox", "hello.lox"]);
+
+    let output = run_batch_compile(&batch_dir);
+    assert!(
+        !output.status.success(),
+        "expected batch with a broken file to fail"
+    );
+    let stderr = String::from_utf8_lossy(&output.stderr);
+    assert!(
+        stderr.contains("error_missing_semicolon.lox"),
+        "failure report should name the broken file: {stderr}"
+    );
+    assert!(
+        stderr.contains("1 of 2 files failed"),
+        "unexpected failure summary: {stderr}"
+    );
+    // The good file still compiled.
+    assert!(
+        blox::is_bytecode_file(&batch_dir.join("nested/hello.blox")).expect("stat batch output"),
+        "good file should compile despite the broken sibling"
+    );
+
+    let _ = std::fs::remove_dir_all(&batch_dir);
+}
+
+#[test]
+fn batch_requires_a_compile_mode() {
+    let batch_dir = setup_batch_dir("batch_no_mode", &["hello.lox"]);
+
+    let output = Command::new(env!("CARGO_BIN_EXE_vibe-lox"))
+        .args(["--batch", batch_dir.to_str().unwrap()])
+        .output()
+        .expect("run vibe-lox --batch");
+    assert!(!output.status.success());
+    let stderr = String::from_utf8_lossy(&output.stderr);
+    assert!(
+        stderr.contains("--batch requires --compile-bytecode or --compile-llvm"),
+        "unexpected error: {stderr}"
+    );
+
+    let _ = std::fs::remove_dir_all(&batch_dir);
+}
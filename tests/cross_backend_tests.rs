@@ -14,7 +14,7 @@ fn run_interpreter(source: &str) -> Vec<String> {
     let locals = Resolver::new()
         .resolve(&program)
         .expect("resolve should succeed");
-    let mut interp = Interpreter::new();
+    let mut interp = Interpreter::new_capturing();
     interp
         .interpret(&program, locals)
         .expect("interpret should succeed");
@@ -13,7 +13,7 @@ fn run_fixture(source: &str) -> Vec<String> {
     let locals = Resolver::new()
         .resolve(&program)
         .expect("resolve should succeed");
-    let mut interp = Interpreter::new();
+    let mut interp = Interpreter::new_capturing();
     interp
         .interpret(&program, locals)
         .expect("interpret should succeed");
@@ -26,7 +26,7 @@ fn run_fixture_err(source: &str) -> RuntimeError {
     let locals = Resolver::new()
         .resolve(&program)
         .expect("resolve should succeed");
-    let mut interp = Interpreter::new();
+    let mut interp = Interpreter::new_capturing();
     interp.set_source(source);
     interp.interpret(&program, locals).unwrap_err()
 }
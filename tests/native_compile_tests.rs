@@ -121,6 +121,48 @@ fn native_error_fixture(#[case] fixture: &str) {
     assert_eq!(stderr, expected);
 }
 
+#[rstest]
+#[case("0")]
+#[case("1")]
+#[case("2")]
+fn native_opt_levels_agree(#[case] level: &str) {
+    let project_root = PathBuf::from(env!("CARGO_MANIFEST_DIR"));
+    let lox_file = project_root.join("fixtures/fib.lox");
+    let tmp_dir = project_root.join("tmp");
+    std::fs::create_dir_all(&tmp_dir).expect("create tmp dir");
+    let exe_path = tmp_dir.join(format!("fib_o{level}"));
+
+    let compile_output = Command::new(env!("CARGO_BIN_EXE_vibe-lox"))
+        .args([
+            "--compile",
+            "-O",
+            level,
+            lox_file.to_str().unwrap(),
+            "-o",
+            exe_path.to_str().unwrap(),
+        ])
+        .output()
+        .expect("run vibe-lox --compile -O");
+    assert!(
+        compile_output.status.success(),
+        "compile at -O{level} failed: {}",
+        String::from_utf8_lossy(&compile_output.stderr)
+    );
+
+    let run_output = Command::new(&exe_path)
+        .output()
+        .expect("run native executable");
+    let _ = std::fs::remove_file(&exe_path);
+    assert!(run_output.status.success());
+
+    let expected = std::fs::read_to_string(project_root.join("fixtures/fib.expected"))
+        .expect("read fib.expected");
+    assert_eq!(
+        String::from_utf8(run_output.stdout).expect("output is valid UTF-8"),
+        expected
+    );
+}
+
 #[test]
 fn native_compile_rejects_blox() {
     let project_root = PathBuf::from(env!("CARGO_MANIFEST_DIR"));
@@ -8,7 +8,7 @@ use vibe_lox::vm::vm::Vm;
 
 fn run_vm_fixture(source: &str) -> Vec<String> {
     let compiled = compile_to_chunk(source).expect("compile should succeed");
-    let mut vm = Vm::new();
+    let mut vm = Vm::new_capturing();
     vm.interpret(compiled).expect("interpret should succeed");
     vm.output().to_vec()
 }
@@ -17,14 +17,14 @@ fn run_vm_roundtrip(source: &str) -> Vec<String> {
     let compiled = compile_to_chunk(source).expect("compile should succeed");
     let bytes = rmp_serde::to_vec(&compiled).expect("serialize should succeed");
     let loaded: chunk::Chunk = rmp_serde::from_slice(&bytes).expect("deserialize should succeed");
-    let mut vm = Vm::new();
+    let mut vm = Vm::new_capturing();
     vm.interpret(loaded).expect("interpret should succeed");
     vm.output().to_vec()
 }
 
 fn run_vm_err(source: &str) -> RuntimeError {
     let compiled = compile_to_chunk(source).expect("compile should succeed");
-    let mut vm = Vm::new();
+    let mut vm = Vm::new_capturing();
     vm.interpret(compiled).unwrap_err()
 }
 
@@ -107,7 +107,19 @@ fn vm_bytecode_roundtrip_with_magic_header() {
 
     let loaded: chunk::Chunk =
         rmp_serde::from_slice(&bytes[4..]).expect("deserialize should succeed");
-    let mut vm = Vm::new();
+    let mut vm = Vm::new_capturing();
+    vm.interpret(loaded).expect("interpret should succeed");
+    assert_eq!(vm.output(), &["3"]);
+}
+
+#[test]
+fn vm_blox_v3_roundtrip() {
+    let compiled = compile_to_chunk("print 1 + 2;").expect("compile should succeed");
+    let bytes = vibe_lox::vm::blox::to_bytes(&compiled);
+    assert_eq!(&bytes[..4], b"blx2", "v3 file should start with its magic");
+
+    let loaded = vibe_lox::vm::blox::from_bytes(&bytes).expect("decode should succeed");
+    let mut vm = Vm::new_capturing();
     vm.interpret(loaded).expect("interpret should succeed");
     assert_eq!(vm.output(), &["3"]);
 }
@@ -116,7 +128,7 @@ fn vm_bytecode_roundtrip_with_magic_header() {
 
 fn run_vm_source(source: &str) -> Vec<String> {
     let compiled = compile_to_chunk(source).expect("compile should succeed");
-    let mut vm = Vm::new();
+    let mut vm = Vm::new_capturing();
     vm.interpret(compiled).expect("interpret should succeed");
     vm.output().to_vec()
 }
@@ -181,15 +193,8 @@ fn run_vm_subprocess(fixture: &str, stdin_data: &[u8]) -> String {
         std::fs::read_to_string(&fixture_path).unwrap_or_else(|_| panic!("read fixture {fixture}"));
     let compiled =
         compile_to_chunk(&source).unwrap_or_else(|_| panic!("compile fixture {fixture}"));
-    let blox_bytes = {
-        let payload = rmp_serde::to_vec(&compiled).expect("serialize");
-        let mut b = Vec::with_capacity(4 + payload.len());
-        b.extend_from_slice(b"blox");
-        b.extend_from_slice(&payload);
-        b
-    };
     let blox_path = std::env::temp_dir().join(fixture.replace(".lox", ".blox"));
-    std::fs::write(&blox_path, &blox_bytes).expect("write blox temp file");
+    vibe_lox::vm::blox::save(&compiled, &blox_path).expect("write blox temp file");
 
     let mut child = Command::new(env!("CARGO_BIN_EXE_vibe-lox"))
         .arg("-q")